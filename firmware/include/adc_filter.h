@@ -0,0 +1,31 @@
+/**
+ * adc_filter.h - Robust filter for blocks of ADC samples
+ *
+ * Plain C++ with no Arduino or ESP-IDF dependencies, so recorded
+ * sample traces can be run through it on a PC.
+ */
+
+#ifndef ADC_FILTER_H
+#define ADC_FILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct AdcFilterResult {
+    float value;            // Mean of the middle half of the samples
+    float noise;            // Robust standard deviation (1.4826 x MAD)
+    uint16_t median;
+    uint16_t count;         // Samples the result was computed from
+};
+
+namespace AdcFilter {
+    /**
+     * Median-plus-mean filter. Spikes and ADC glitches land in the
+     * outer quartiles and are dropped; the middle half is averaged
+     * for resolution below one ADC step.
+     * 'samples' is used as scratch space and is overwritten.
+     */
+    AdcFilterResult apply(uint16_t* samples, size_t count);
+}
+
+#endif // ADC_FILTER_H
@@ -0,0 +1,63 @@
+/**
+ * alloc_counter.h - Heap allocation counts
+ *
+ * Built with ALLOC_COUNTER and the linker wrapping malloc, calloc and
+ * realloc (-Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc), every
+ * heap allocation is counted, including those made by String and the
+ * libraries. Without it the counts stay 0; on the board only the
+ * esp32dev_alloc, esp32dev_trace and esp32dev_bench envs count.
+ *
+ * Only calls that go through malloc, calloc and realloc are seen.
+ * ESP-IDF code that calls heap_caps_malloc() and friends directly
+ * (the WiFi driver, lwIP, mbedTLS, task stacks) is not counted, so the
+ * counts cover the firmware and the Arduino libraries, not the whole
+ * heap; free_heap and largest_block still see everything.
+ *
+ * ALLOC_TRACE additionally attributes allocations to the code that
+ * made them: the return address of the malloc/calloc/realloc call
+ * (operator new on the host), in a table of ALLOC_TRACE_SITES
+ * entries. Decode addresses with addr2line against firmware.elf; on
+ * the board, String and operator new show up as their library
+ * functions.
+ */
+
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <Arduino.h>
+
+/**
+ * Allocations made from one call site since boot.
+ */
+struct AllocSite {
+    uintptr_t address;          // 0: sites that did not fit the table
+    unsigned long count;
+    unsigned long bytes;
+};
+
+namespace AllocCounter {
+    /**
+     * True if allocations are being counted.
+     */
+    bool enabled();
+
+    /**
+     * Allocations since boot, and the bytes requested by them.
+     */
+    unsigned long count();
+    unsigned long bytes();
+
+    /**
+     * True if call sites are traced (ALLOC_TRACE).
+     */
+    bool tracing();
+
+    /**
+     * Copy the call sites that allocated the most bytes into 'sites',
+     * largest first. Returns number of sites copied (0 without
+     * ALLOC_TRACE).
+     */
+    unsigned int topSites(AllocSite* sites, unsigned int maxSites);
+}
+
+#endif // ALLOC_COUNTER_H
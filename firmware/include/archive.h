@@ -0,0 +1,95 @@
+/**
+ * archive.h - Compressed daily archive of all readings
+ *
+ * Readings are kept by local date in <dir>/YYYY-MM-DD.arc (readings
+ * without a synced clock go to unknown.arc), as a sequence of
+ * compressed blocks (see archive_codec.h).
+ *
+ * The block being filled is also appended raw to <dir>/open.rec, one
+ * 32-byte record per reading, so a reset loses nothing: begin() loads
+ * it back. The block is sealed into the day file when it is full or
+ * the date changes, and open.rec is then removed.
+ *
+ * Each sealed block also gets an entry in <day>.idx (time range and
+ * byte offset), so a time range query reads only the index and the
+ * blocks that overlap the range.
+ *
+ * Day files are capped at SD_MAX_FILE_SIZE and continue in numbered
+ * parts (YYYY-MM-DD.1.arc, ...). The total size and the oldest day
+ * are kept in <dir>/archive.meta for retention.
+ *
+ * unknown.arc holds readings taken before the first NTP sync of a
+ * boot that were stored before the clock was set, so they have only
+ * an uptime stamp. They are never re-dated: query() and replay do not
+ * see them, only tools/records.py on the card does. Retention deletes
+ * them before any dated day, unless they are the block being written.
+ *
+ * Works on any fs::FS, like the buffer log.
+ */
+
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "config.h"
+#include "reading_record.h"
+#include "sd_path.h"
+
+namespace Archive {
+    /**
+     * Use 'dir' on 'fs' for the archive and reload the open block.
+     * Returns true if the archive is ready for use (false if 'dir' is
+     * longer than SD_DIR_MAX allows).
+     */
+    bool begin(fs::FS& fs, const char* dir);
+
+    /**
+     * Add one reading. Seals the open block first if the reading
+     * belongs to another day, and afterwards if the block is full.
+     * Returns true if the reading was stored.
+     */
+    bool append(const ReadingRecord& record);
+
+    /**
+     * Pass readings with start <= epoch <= end to the callback, oldest
+     * first, including the open block. At most 'maxCount' readings;
+     * stops early if the callback returns false. Only readings with a
+     * synced clock are searched.
+     * Returns number of readings passed to the callback.
+     */
+    unsigned int query(uint32_t start, uint32_t end,
+                       bool (*callback)(const ReadingRecord& record),
+                       unsigned int maxCount);
+
+    /**
+     * Day file that 'record' belongs to.
+     */
+    SDPath dayPath(const ReadingRecord& record);
+
+    /**
+     * Delete unknown.arc if there is one, else the oldest day (all
+     * parts and indexes). Never deletes the day being written or
+     * today. Looks at no more than a month of dates per call.
+     * Returns true if a day was deleted.
+     */
+    bool removeOldestDay();
+
+    /**
+     * Bytes used by day and index files.
+     */
+    unsigned long bytes();
+
+    /**
+     * Readings in the open (not yet compressed) block.
+     */
+    unsigned int openCount();
+
+    /**
+     * Bytes written to the card since boot, open block and metadata
+     * included.
+     */
+    unsigned long bytesWritten();
+}
+
+#endif // ARCHIVE_H
@@ -0,0 +1,78 @@
+/**
+ * archive_codec.h - Compressed blocks of reading records
+ *
+ * The daily archive stores readings in blocks of up to
+ * ARCHIVE_BLOCK_RECORDS. Inside a block the records are split into
+ * columns (epoch, reading number, boot, flags, one per channel) and
+ * each column is bit-packed on its own:
+ *
+ *   epoch, reading   delta-of-delta
+ *   everything else  delta from the previous record
+ *
+ * Each delta goes into one of the variable-length buckets Gorilla
+ * uses for timestamps (MSB first):
+ *
+ *   0                      delta is 0
+ *   10   + 7 bits          -64 .. 63
+ *   110  + 9 bits          -256 .. 255
+ *   1110 + 12 bits         -2048 .. 2047
+ *   1111 + 32 bits         anything else (modulo 2^32)
+ *
+ * A reading every 60 s with slowly drifting values costs a few bits
+ * per column instead of 32 bytes per record.
+ *
+ * Every block starts with a header giving its time range and length,
+ * so a reader can skip from block to block without decoding them.
+ * The CRC covers the header and the packed data.
+ *
+ * tools/records.py implements the same format for use on a PC.
+ */
+
+#ifndef ARCHIVE_CODEC_H
+#define ARCHIVE_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "reading_record.h"
+
+#define ARCHIVE_BLOCK_MAGIC   0x4B4C4241UL  // "ABLK"
+#define ARCHIVE_COLUMNS       10
+
+// Packed size of 'n' records if every value needs the 36-bit bucket
+#define ARCHIVE_MAX_BYTES(n)  (((n) * ARCHIVE_COLUMNS * 36 + 7) / 8)
+
+struct __attribute__((packed)) ArchiveBlockHeader {
+    uint32_t magic;
+    uint16_t count;         // Readings in the block
+    uint16_t length;        // Packed bytes following the header
+    uint32_t firstEpoch;
+    uint32_t lastEpoch;
+    uint32_t crc;           // CRC32 of the fields above, then the packed data
+};
+
+static_assert(sizeof(ArchiveBlockHeader) == 20, "ArchiveBlockHeader must be 20 bytes");
+
+namespace ArchiveCodec {
+    /**
+     * Pack 'count' records into 'out' and fill in 'header'. Record CRCs are not stored; the block CRC
+     * replaces them.
+     * Returns the packed length, or 0 if 'capacity' is too small.
+     */
+    size_t encode(const ReadingRecord* records, uint16_t count,
+                  uint8_t* out, size_t capacity, ArchiveBlockHeader& header);
+
+    /**
+     * Check the magic and the length of a block header.
+     */
+    bool isHeader(const ArchiveBlockHeader& header);
+
+    /**
+     * Unpack a block into 'records' (room for 'maxCount') and re-seal
+     * each record's CRC.
+     * Returns the number of records, or 0 if the CRC does not match.
+     */
+    uint16_t decode(const ArchiveBlockHeader& header, const uint8_t* data,
+                    ReadingRecord* records, uint16_t maxCount);
+}
+
+#endif // ARCHIVE_CODEC_H
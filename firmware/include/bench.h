@@ -0,0 +1,62 @@
+/**
+ * bench.h - Benchmarks of the data path
+ *
+ * Built with BENCHMARK, setup() runs the benchmarks instead of the
+ * monitor (see [env:native_bench] and [env:esp32dev_bench] in
+ * platformio.ini). Each case is timed BENCH_SAMPLES times:
+ *
+ *   build_payload   Payload::writeReading() of one reading
+ *   convert_channels  Channels::convert() of BENCH_CONVERT_REPEAT
+ *                   readings (validity mask and fixed-point values)
+ *   write_reading   SDManager::writeReading() (buffer + archive)
+ *   remove_oldest   SDManager::removeOldestBuffered()
+ *   flush_buffer    SDManager::flushBuffer() of SD_FLUSH_BATCH
+ *                   readings, each formatted as a payload
+ *   init            SDManager::init() as at boot, reopening the
+ *                   buffer log and archive (BENCH_INITS samples)
+ *   init_rebuild    the same with both buffer log metadata slots
+ *                   corrupted, so the cursor is rebuilt from the
+ *                   segment files
+ *   drain_backlog   one batch message of SD_FLUSH_MAX_BATCH readings
+ *                   while emptying a BENCH_DRAIN_BACKLOG buffer
+ *                   (stress test: the heap must stay constant)
+ *   query_range     SDManager::queryRange() of BENCH_QUERY_WINDOW
+ *                   seconds from a day of archive (through the index)
+ *   query_scan      decoding that whole day and filtering the same
+ *                   window, i.e. the lookup without the index
+ *   mqtt_publish    MQTTManager::publishBatch() of SD_FLUSH_BATCH
+ *                   readings
+ *   mqtt_puback     publishBatch() until its PUBACK arrives
+ *   drain_rate      Outbox::service() sending a BENCH_DRAIN_RATE_BACKLOG
+ *                   buffer to the broker, until the next readings
+ *                   are acknowledged; also reports readings_per_s
+ *   mqtt_connect_full  reconnect to the broker with a full TLS
+ *                   handshake (BENCH_RECONNECTS samples)
+ *   mqtt_reconnect  reconnect resuming the cached TLS session
+ *
+ * The SD cases run at each backlog in BENCH_BACKLOGS (readings in
+ * the buffer); the MQTT cases are skipped if the broker cannot be
+ * reached (on the host: a local mosquitto on port 1883). The buffer is emptied first and the archive grows: use a
+ * spare card.
+ *
+ * Results (latency percentiles in microseconds, heap allocations
+ * and bytes per operation) are printed and saved as JSON to
+ * BENCH_RESULTS_DIR/<FIRMWARE_VERSION>.json. tools/bench.py compares
+ * two result files.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <Arduino.h>
+
+namespace Bench {
+    /**
+     * Run all benchmarks and save the results. Needs the SD card
+     * initialized; brings up WiFi, time and MQTT itself. Exits on the
+     * host; returns on the board.
+     */
+    void run();
+}
+
+#endif // BENCH_H
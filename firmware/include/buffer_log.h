@@ -0,0 +1,98 @@
+/**
+ * buffer_log.h - Segmented append-only ring log for buffered readings
+ *
+ * Readings are appended to fixed-size segment files in a directory
+ * (00000001.rec, 00000002.rec, ...). A small metadata file records
+ * the read position (head) and the segment being written (tail).
+ *
+ * Enqueue appends to the tail segment. Dequeue only advances the head
+ * cursor; a segment is deleted once every reading in it is consumed.
+ * Both are O(1) amortized, so draining a large backlog costs one
+ * sequential read per reading instead of a full-file rewrite.
+ *
+ * Count, size and oldest/newest timestamps are kept in a checksummed
+ * metadata block, so opening the log does not scan the backlog.
+ *
+ * The log works on any fs::FS (SD on the ESP32, a directory-backed
+ * filesystem on the host).
+ */
+
+#ifndef BUFFER_LOG_H
+#define BUFFER_LOG_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "reading_record.h"
+
+namespace BufferLog {
+    /**
+     * Open the log stored in 'dir' on 'fs', creating it if needed.
+     * Restores the cursor from the previous session.
+     * Returns true if the log is ready for use.
+     */
+    bool begin(fs::FS& fs, const char* dir);
+
+    /**
+     * Append one reading to the tail segment.
+     * Returns true if write succeeded.
+     */
+    bool append(const ReadingRecord& record);
+
+    /**
+     * Read the oldest reading without removing it.
+     * Returns false if the log is empty or the record is corrupted.
+     */
+    bool peek(ReadingRecord& record);
+
+    /**
+     * Remove the oldest reading.
+     * Returns true if a reading was removed.
+     */
+    bool pop();
+
+    /**
+     * Read up to 'maxCount' readings, oldest first, without removing
+     * them, starting 'skip' readings after the oldest. Corrupted
+     * records are copied as-is; check them with RecordCodec::isValid().
+     * Returns number of records read.
+     */
+    unsigned int peekBatch(ReadingRecord* records, unsigned int maxCount, unsigned long skip = 0);
+
+    /**
+     * Remove the 'count' oldest readings and save the cursor once.
+     * Returns number of readings removed.
+     */
+    unsigned int popBatch(unsigned int count);
+
+    /**
+     * Pass up to 'maxCount' readings, oldest first, to the callback.
+     * Stops at the first callback failure. Consumed readings are
+     * removed and the cursor is saved once at the end.
+     * Returns number of readings consumed.
+     */
+    unsigned int drain(bool (*callback)(const ReadingRecord& record), unsigned int maxCount);
+
+    /**
+     * Number of readings in the log.
+     */
+    unsigned long count();
+
+    /**
+     * Bytes of SD space used by the readings in the log.
+     */
+    unsigned long bytes();
+
+    /**
+     * Timestamps of the oldest and newest readings in the log.
+     * 0 if the log is empty or the timestamp is unknown.
+     */
+    uint32_t oldestEpoch();
+    uint32_t newestEpoch();
+
+    /**
+     * Bytes written to the card since boot, metadata included.
+     */
+    unsigned long bytesWritten();
+}
+
+#endif // BUFFER_LOG_H
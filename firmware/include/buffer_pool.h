@@ -0,0 +1,69 @@
+/**
+ * buffer_pool.h - Fixed pool of transient buffers
+ *
+ * Payloads, batch messages and record batches on the publish path
+ * come from here instead of the heap or one static buffer per call
+ * site. The pool has two slab classes sized in config.h:
+ * POOL_SMALL_SLOTS x POOL_SMALL_BYTES and POOL_LARGE_SLOTS x
+ * POOL_LARGE_BYTES, so peak memory is fixed at compile time and does
+ * not depend on the backlog.
+ *
+ * When every slot of a class is taken, acquire() returns nothing and
+ * the caller skips the work for now (readings stay on SD); the miss
+ * is counted and reported in the status message.
+ */
+
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <Arduino.h>
+
+namespace BufferPool {
+    /**
+     * Take a free slot of the smallest class holding 'size' bytes.
+     * Thread-safe. Returns nullptr if there is none.
+     */
+    void* acquire(size_t size);
+
+    /**
+     * Return a slot taken with acquire().
+     */
+    void release(void* buffer);
+
+    /**
+     * Slots taken now, most taken at once since boot, and failed
+     * acquire() calls since boot.
+     */
+    unsigned int inUse();
+    unsigned int peak();
+    unsigned long misses();
+}
+
+/**
+ * A pool slot held until the end of the scope. Check it before use.
+ */
+class PoolBuffer {
+public:
+    explicit PoolBuffer(size_t size)
+        : buffer((char*)BufferPool::acquire(size)), length(buffer ? size : 0) {}
+    ~PoolBuffer() { if (buffer) BufferPool::release(buffer); }
+
+    char* data() const { return buffer; }
+    size_t size() const { return length; }
+    explicit operator bool() const { return buffer != nullptr; }
+
+    /**
+     * The slot as an array of T (slots are 4-byte aligned).
+     */
+    template <typename T>
+    T* as() const { return (T*)buffer; }
+
+private:
+    char* buffer;
+    size_t length;
+
+    PoolBuffer(const PoolBuffer&);
+    PoolBuffer& operator=(const PoolBuffer&);
+};
+
+#endif // BUFFER_POOL_H
@@ -0,0 +1,20 @@
+/**
+ * checksum.h - CRC32 for records stored on the SD card (and other
+ * data that must survive a reset)
+ */
+
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Checksum {
+    /**
+     * CRC-32 (IEEE 802.3, same as zlib).
+     * Pass the previous result as 'crc' to checksum data in pieces.
+     */
+    uint32_t crc32(const void* data, size_t length, uint32_t crc = 0);
+}
+
+#endif // CHECKSUM_H
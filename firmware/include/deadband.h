@@ -0,0 +1,31 @@
+/**
+ * deadband.h - Report-by-exception filter for published readings
+ *
+ * A reading is published only if one of its values moved by more than
+ * that channel's deadband since the last published reading, a sensor
+ * became valid or invalid, or DEADBAND_HEARTBEAT has passed. Readings
+ * that are held back are still archived on the SD card.
+ */
+
+#ifndef DEADBAND_H
+#define DEADBAND_H
+
+#include <Arduino.h>
+#include "reading_record.h"
+
+namespace Deadband {
+    /**
+     * Decide whether 'record' should be published, and remember it as
+     * the reference for the next reading if so.
+     * Always true when DEADBAND_ENABLED is false.
+     */
+    bool shouldPublish(const ReadingRecord& record);
+
+    /**
+     * Readings checked and readings held back since boot.
+     */
+    unsigned long getChecked();
+    unsigned long getSuppressed();
+}
+
+#endif // DEADBAND_H
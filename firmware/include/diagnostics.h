@@ -0,0 +1,57 @@
+/**
+ * diagnostics.h - Heap and stack telemetry
+ *
+ * free_heap alone does not show fragmentation or a slow leak, so the
+ * status message also reports the largest free heap block, the lowest
+ * free heap since boot, heap allocations per network loop and each
+ * task's unused stack. {"cmd":"diag"} on the command topic asks for
+ * a fuller report on the diag topic:
+ *
+ *   {"device":"LEPAA-GH-01","uptime_sec":86400,
+ *    "heap":{"free":172340,"min_free":151208,"largest_block":110580,
+ *            "fragmentation":35.8,"allocs":51220,"alloc_bytes":2310544,
+ *            "loop_allocs_max":12,"loop_allocs_mean":0.4},
+ *    "stack_free":{"sensor":2112,"storage":3016,"network":4820},
+ *    "alloc_sites":[["0x400d5e2c",10211,734592],...]}
+ *
+ * The allocation fields are only present in builds that count
+ * allocations (esp32dev_alloc and the envs extending it), and they do
+ * not include ESP-IDF allocations made through heap_caps_malloc()
+ * (see alloc_counter.h). 'alloc_sites' (call site, allocations, bytes
+ * since boot) is only filled in ALLOC_TRACE builds.
+ */
+
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+namespace Diagnostics {
+    /**
+     * Report the stack of 'task' under 'name'.
+     */
+    void addTask(const char* name, TaskHandle_t task);
+
+    /**
+     * Mark the start and end of a network loop, to count the heap
+     * allocations made meanwhile (by all tasks).
+     */
+    void beginLoop();
+    void endLoop();
+
+    /**
+     * Add "heap" and "stack_free" to the status message. Resets the
+     * per-loop allocation figures.
+     */
+    void addStatus(JsonDocument& doc);
+
+    /**
+     * Publish the full report to the diag topic.
+     */
+    void publishReport();
+}
+
+#endif // DIAGNOSTICS_H
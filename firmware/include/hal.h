@@ -0,0 +1,71 @@
+/**
+ * hal.h - Hardware abstraction for the board and host builds
+ *
+ * The modules reach hardware only through these seams, so the same
+ * sources build for the ESP32 (env:esp32dev) and for Linux
+ * (env:native):
+ *
+ *   clock        millis()/delay() of the Arduino core
+ *   filesystem   Hal::storage(): the SD card, or a directory
+ *   I2C sensors  SCD30 and BH1750 drivers (simulated on the host)
+ *   ADC          SoilSampler (simulated on the host)
+ *   network      WiFiManager for the link, Hal::networkClient() for
+ *                the broker: TLS on the board, plain TCP on the host
+ *
+ * hal_esp32.cpp implements the functions below for the board and
+ * src/native/ for the host, where lib/native_core provides the
+ * Arduino core API.
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include <FS.h>
+
+/**
+ * Cost of the last broker connection and counts since boot.
+ */
+struct TLSStats {
+    unsigned long handshakeMs;      // TCP connect + TLS handshake
+    unsigned long heapPeak;         // Most heap in use during it (bytes)
+    bool resumed;                   // Last handshake resumed a session
+    unsigned long fullHandshakes;
+    unsigned long resumedHandshakes;
+};
+
+namespace Hal {
+    /**
+     * Mount the card (SPI + SD on the board, NATIVE_SD_DIR on the
+     * host). Prints the reason if it fails.
+     * Returns true if storage() can be used.
+     */
+    bool mountStorage();
+
+    fs::FS& storage();
+
+    /**
+     * Card type for the log ("SDHC", "host", ...).
+     */
+    const char* storageType();
+
+    uint64_t storageTotalBytes();
+    uint64_t storageUsedBytes();
+
+    /**
+     * Client for the broker connection. The CA certificate (PEM)
+     * verifies the broker; the host build ignores it.
+     */
+    Client& networkClient();
+    void setRootCA(const char* rootCA);
+    const TLSStats& networkStats();
+
+    /**
+     * Forget the cached TLS session, so the next connect does a full
+     * handshake (benchmarks). Nothing to forget on the host.
+     */
+    void clearNetworkSession();
+}
+
+#endif // HAL_H
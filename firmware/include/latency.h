@@ -0,0 +1,73 @@
+/**
+ * latency.h - Per-stage latency histograms
+ *
+ * Each stage of the tasks (I2C polling, SD writes, WiFi/MQTT upkeep,
+ * ...) is timed with a LatencyProbe and counted into a log-scale
+ * histogram: four buckets per power of two of microseconds. A
+ * percentile is the upper edge of its bucket: never below the true
+ * value and at most 25% above it (exact below 8 us, the maximum from
+ * 16.8 s on). Histograms are in
+ * static memory and counted with atomics, so any task may record and
+ * the network task can take them for the status message. A probe
+ * costs two micros() calls and an increment.
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <Arduino.h>
+
+enum LatencyStage {
+    STAGE_SENSOR_POLL,      // SensorManager::poll() (I2C)
+    STAGE_SENSOR_READ,      // SensorManager::read()
+    STAGE_SD_WRITE,         // SDManager::writeReading()
+    STAGE_PAYLOAD,          // Payload::writeReading()
+    STAGE_WIFI,             // WiFiManager::maintain()
+    STAGE_MQTT,             // MQTTManager::maintain() (connects over TLS)
+    STAGE_NTP,              // TimeManager::maintain()
+    STAGE_OUTBOX,           // Outbox::service() (SD reads, batch publishes)
+    STAGE_REPLAY,           // Replay::service()
+    STAGE_RETENTION,        // Retention::service()
+    STAGE_NETWORK_LOOP,     // Whole network task loop
+    STAGE_COUNT
+};
+
+/**
+ * Percentiles of one stage since it was last taken (microseconds).
+ */
+struct LatencySummary {
+    uint32_t count;
+    uint32_t p50;
+    uint32_t p99;
+    uint32_t max;
+};
+
+namespace Latency {
+    /**
+     * Count one run of 'stage' that took 'us' microseconds.
+     */
+    void record(LatencyStage stage, uint32_t us);
+
+    /**
+     * Percentiles of 'stage' since the last call; clears it.
+     */
+    LatencySummary take(LatencyStage stage);
+
+    /**
+     * Short name for the status payload ("sd_write", ...).
+     */
+    const char* name(LatencyStage stage);
+}
+
+/**
+ * Records the time until the end of the scope.
+ */
+struct LatencyProbe {
+    LatencyStage stage;
+    unsigned long start;
+
+    explicit LatencyProbe(LatencyStage stage) : stage(stage), start(micros()) {}
+    ~LatencyProbe() { Latency::record(stage, micros() - start); }
+};
+
+#endif // LATENCY_H
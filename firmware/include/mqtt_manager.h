@@ -6,11 +6,12 @@
 #define MQTT_MANAGER_H
 
 #include <Arduino.h>
+#include "hal.h"
 
 namespace MQTTManager {
     /**
      * Initialize MQTT client with TLS.
-     * Must be called after WiFi is connected.
+     * Does not connect; maintain() connects once WiFi is up.
      */
     void init();
 
@@ -22,10 +23,42 @@ namespace MQTTManager {
     bool maintain();
 
     /**
-     * Publish sensor data as JSON to the data topic.
-     * Returns true if publish succeeded.
+     * Publish sensor data as JSON to the data topic (QoS 1).
+     * Returns true if the message was sent; the broker's ack is
+     * not tracked.
+     */
+    bool publishData(const char* payload, size_t length);
+
+    /**
+     * Publish reading-interval statistics to the stats topic (QoS 1,
+     * ack not tracked). May exceed MQTT_BUFFER_SIZE.
+     */
+    bool publishStats(const char* payload, size_t length);
+
+    /**
+     * Publish a JSON array of readings to the data topic as one QoS 1
+     * message. May exceed MQTT_BUFFER_SIZE (streamed to the socket).
+     * Returns the packet ID, or 0 if the message could not be sent.
+     */
+    uint16_t publishBatch(const char* payload, size_t length);
+
+    /**
+     * Publish archive replay progress to the replay topic (QoS 1,
+     * ack not tracked).
+     */
+    bool publishReplay(const char* payload, size_t length);
+
+    /**
+     * Register a function called with the packet ID of each PUBACK
+     * received from the broker.
+     */
+    void setAckCallback(void (*callback)(uint16_t packetId));
+
+    /**
+     * Register a function called with each message received on the
+     * command topic (not NUL-terminated). Runs inside maintain().
      */
-    bool publishData(const String& payload);
+    void setCommandCallback(void (*callback)(const char* payload, size_t length));
 
     /**
      * Publish device status to the status topic.
@@ -38,10 +71,32 @@ namespace MQTTManager {
      */
     bool publishError(const String& errorMsg);
 
+    /**
+     * Publish a diagnostic report to the diag topic.
+     */
+    bool publishDiagnostics(const String& payload);
+
+    /**
+     * Close the connection cleanly (the broker keeps the session and
+     * drops the will). maintain() connects again.
+     */
+    void disconnect();
+
     /**
      * Check connection status.
      */
     bool isConnected();
+
+    /**
+     * True if the broker still had our session from a previous
+     * connection (CONNACK session-present flag).
+     */
+    bool isSessionPresent();
+
+    /**
+     * Handshake time and heap use of the last TLS connect.
+     */
+    const TLSStats& getTLSStats();
 }
 
 #endif // MQTT_MANAGER_H
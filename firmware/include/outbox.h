@@ -0,0 +1,48 @@
+/**
+ * outbox.h - Acknowledged delivery of buffered readings
+ *
+ * Sends the SD buffer to the broker as QoS 1 batch messages with up
+ * to MQTT_INFLIGHT_WINDOW batches in flight, so the link is not idle
+ * while waiting for each PUBACK. Each batch covers the next run of
+ * buffered readings; they are removed from SD only once that batch
+ * and every batch before it is acknowledged.
+ *
+ * If the oldest batch is not acknowledged within MQTT_ACK_TIMEOUT, or
+ * the connection drops, the whole window is sent again (readings are
+ * delivered at least once; msg_id identifies duplicates).
+ */
+
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include <Arduino.h>
+#include "reading_record.h"
+
+namespace Outbox {
+    /**
+     * Publishes readings as one message. Returns how many of
+     * 'records' it covered (0 on failure) and sets 'packetId' to the
+     * message's packet ID (0 if nothing needed sending). May adjust
+     * the records (they are a copy of the SD buffer).
+     */
+    typedef unsigned int (*SendBatch)(ReadingRecord* records, unsigned int count, uint16_t& packetId);
+
+    /**
+     * Retire acknowledged batches, re-send timed out ones and fill
+     * the window with new batches. Call this in the main loop.
+     * Returns false if a batch failed to send or timed out.
+     */
+    bool service(SendBatch sendBatch);
+
+    /**
+     * Record a PUBACK from the broker.
+     */
+    void onAck(uint16_t packetId);
+
+    /**
+     * Number of buffered readings sent but not yet acknowledged.
+     */
+    unsigned long pending();
+}
+
+#endif // OUTBOX_H
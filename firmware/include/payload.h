@@ -0,0 +1,65 @@
+/**
+ * payload.h - JSON payloads for sensor readings
+ *
+ * Writes the MQTT data payload straight into a caller-provided buffer.
+ * Values are formatted from the record's fixed-point fields, so no
+ * floats, Strings or JsonDocuments are involved and nothing is
+ * allocated on the heap. Window statistics are rounded to the same
+ * fixed-point scales first.
+ *
+ * Example output (one line):
+ * {
+ *   "device": "LEPAA-GH-01",
+ *   "msg_id": "A1B2C3D4-0012-00142",
+ *   "timestamp": "2026-03-15T14:30:00+02:00",
+ *   "reading": 142,
+ *   "sensors": {
+ *     "co2": 485.2,
+ *     "temperature": 22.15,
+ *     "humidity": 65.3,
+ *     "light": 12450.0,
+ *     "soil_moisture": 42.5,
+ *     "soil_raw": 2150
+ *   },
+ *   "valid": {
+ *     "scd30": true,
+ *     "bh1750": true,
+ *     "soil": true
+ *   }
+ * }
+ */
+
+#ifndef PAYLOAD_H
+#define PAYLOAD_H
+
+#include <Arduino.h>
+#include "reading_record.h"
+
+namespace Payload {
+    /**
+     * Write the JSON object for one reading into 'buffer'
+     * (NUL-terminated).
+     * Returns the length, or 0 if it does not fit in 'size'.
+     */
+    size_t writeReading(char* buffer, size_t size, const ReadingRecord& record);
+
+    /**
+     * Write a JSON array of readings into 'buffer', adding readings
+     * until the next one does not fit. Corrupted records are left out
+     * but still counted in 'taken'.
+     * Returns the length, or 0 if no reading was written.
+     */
+    size_t writeBatch(char* buffer, size_t size, const ReadingRecord* records,
+                      unsigned int count, unsigned int& taken);
+
+    /**
+     * Write the statistics of one reading interval (count, mean, min,
+     * max and standard deviation per channel), stamped with the
+     * reading they were averaged into.
+     * Returns the length, or 0 if it does not fit in 'size'.
+     */
+    size_t writeStats(char* buffer, size_t size, const ReadingRecord& record,
+                      const WindowSummary& summary);
+}
+
+#endif // PAYLOAD_H
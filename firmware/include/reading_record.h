@@ -0,0 +1,94 @@
+/**
+ * reading_record.h - Compact binary record for SD storage
+ *
+ * One sensor reading in a fixed 32-byte layout (little-endian).
+ * Used for both the buffer log and the daily archive; JSON is only
+ * built from it at publish time (or on the host by tools/records.py).
+ *
+ * Offset  Size  Field
+ *      0     1  version (RECORD_VERSION)
+ *      1     1  flags (RECORD_FLAG_*)
+ *      2     2  boot count
+ *      4     4  epoch (Unix seconds, UTC; uptime seconds if
+ *               RECORD_FLAG_UPTIME)
+ *      8     4  reading number
+ *     12     4  CO2, ppm x10
+ *     16     2  temperature, C x100 (signed)
+ *     18     2  humidity, %RH x10
+ *     20     4  light, lux x10
+ *     24     2  soil moisture, % x10 (signed)
+ *     26     2  soil raw ADC value
+ *     28     4  CRC32 of bytes 0-27
+ */
+
+#ifndef READING_RECORD_H
+#define READING_RECORD_H
+
+#include <Arduino.h>
+#include "sensor_manager.h"
+
+#define RECORD_VERSION        1
+
+#define RECORD_FLAG_SCD30     0x01  // CO2/temperature/humidity valid
+#define RECORD_FLAG_BH1750    0x02  // Light valid
+#define RECORD_FLAG_SOIL      0x04  // Soil moisture valid
+#define RECORD_FLAG_TIME      0x08  // Epoch came from a synced clock
+#define RECORD_FLAG_UPTIME    0x10  // Epoch is seconds since boot (clock not set yet)
+
+struct __attribute__((packed)) ReadingRecord {
+    uint8_t  version;
+    uint8_t  flags;
+    uint16_t boot;
+    uint32_t epoch;
+    uint32_t reading;
+    uint32_t co2;
+    int16_t  temperature;
+    uint16_t humidity;
+    uint32_t light;
+    int16_t  soilMoisture;
+    uint16_t soilRaw;
+    uint32_t crc;
+};
+
+static_assert(sizeof(ReadingRecord) == 32, "ReadingRecord must be 32 bytes");
+
+namespace RecordCodec {
+    /**
+     * Build a record from a sensor reading and seal it with a CRC.
+     * 'clock' tells what 'epoch' holds: RECORD_FLAG_TIME (Unix time),
+     * RECORD_FLAG_UPTIME (seconds since boot) or 0 (unknown).
+     */
+    ReadingRecord encode(const SensorData& data, uint32_t epoch, uint8_t clock,
+                         uint16_t boot, uint32_t reading);
+
+    /**
+     * Convert an uptime-stamped record from boot 'boot' to Unix time,
+     * given the Unix time of that boot. Re-seals the CRC.
+     * Returns true if the record was converted.
+     */
+    bool resolveUptime(ReadingRecord& record, uint16_t boot, uint32_t bootEpoch);
+
+    /**
+     * Recompute the CRC after the fields were filled in directly.
+     */
+    void seal(ReadingRecord& record);
+
+    /**
+     * Convert a record back to sensor values.
+     */
+    SensorData decode(const ReadingRecord& record);
+
+    /**
+     * Check version and CRC. Returns false for torn or corrupted records.
+     */
+    bool isValid(const ReadingRecord& record);
+
+    /**
+     * Parse a JSON reading in the published format (used to migrate
+     * JSONL buffers written by older firmware).
+     * Returns false if the line is not a valid reading.
+     */
+    bool fromJSON(const String& json, ReadingRecord& record);
+}
+
+#endif // READING_RECORD_H
@@ -0,0 +1,47 @@
+/**
+ * replay.h - Re-send archived readings on request
+ *
+ * When the server has lost data, it can ask the device to send a time
+ * range from the SD archive again by publishing to the command topic:
+ *
+ *   {"cmd":"replay","from":1772503200,"to":1772510400,"id":"gap-42"}
+ *   {"cmd":"cancel"}
+ *
+ * 'from' and 'to' are Unix times (inclusive); 'id' is optional and
+ * echoed back. The readings go to the data topic as batch messages,
+ * in the same format as the buffered backlog, at most one batch per
+ * REPLAY_INTERVAL and only while no live readings are waiting.
+ * Progress goes to the replay topic:
+ *
+ *   {"device":"LEPAA-GH-01","id":"gap-42","state":"running",
+ *    "from":1772503200,"to":1772510400,"position":1772506800,"sent":48}
+ *
+ * 'state' is "started", "running", "done", "cancelled", "rejected"
+ * (bad range, no SD card, or another replay running) or "failed".
+ * Replaying a range twice is harmless: msg_id identifies duplicates.
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <Arduino.h>
+
+namespace Replay {
+    /**
+     * Handle a message from the command topic.
+     */
+    void onCommand(const char* payload, size_t length);
+
+    /**
+     * Send the next batch of a running replay when it is due.
+     * Call in the network loop while MQTT is connected.
+     */
+    void service();
+
+    /**
+     * True while a replay is running.
+     */
+    bool isActive();
+}
+
+#endif // REPLAY_H
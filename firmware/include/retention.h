@@ -0,0 +1,43 @@
+/**
+ * retention.h - Keeps the SD card from filling up
+ *
+ * Every SD_RETENTION_INTERVAL the archive and buffer are checked
+ * against their budgets and the card against the free space
+ * watermark:
+ *
+ *   archive over SD_ARCHIVE_MAX_BYTES, or card low   delete the undated
+ *                                                    readings, else the
+ *                                                    oldest day
+ *   buffer over SD_BUFFER_MAX_BYTES, or card low     drop the oldest
+ *                                                    segment of unsent
+ *                                                    readings
+ *
+ * At most one of these runs per check, so the cost per call is
+ * bounded (a free space estimate plus one deletion). Sizes come from
+ * metadata the archive and buffer keep anyway; there is no directory
+ * walk. Dropped unsent readings are still in the archive and can be
+ * replayed.
+ */
+
+#ifndef RETENTION_H
+#define RETENTION_H
+
+#include <Arduino.h>
+
+namespace Retention {
+    /**
+     * Run the check when it is due. Pass 'bufferIdle' true only when
+     * no buffered readings are awaiting a PUBACK (Outbox::pending() is
+     * 0); the outbox would otherwise remove the wrong readings when
+     * the acks arrive.
+     */
+    void service(bool bufferIdle);
+
+    /**
+     * Archive days deleted and unsent readings dropped since boot.
+     */
+    unsigned long getDeletedDays();
+    unsigned long getDroppedReadings();
+}
+
+#endif // RETENTION_H
@@ -0,0 +1,30 @@
+/**
+ * running_stats.h - Single-pass mean, variance, min and max
+ *
+ * Welford's algorithm: constant memory however many samples are
+ * added, and no loss of precision from subtracting large sums.
+ * Plain C++ with no Arduino dependencies.
+ */
+
+#ifndef RUNNING_STATS_H
+#define RUNNING_STATS_H
+
+#include <stdint.h>
+
+struct RunningStats {
+    uint32_t count;
+    float mean;
+    float m2;               // Sum of squared deviations from the mean
+    float min;
+    float max;
+
+    void reset();
+    void add(float x);
+
+    /**
+     * Sample standard deviation; 0 for fewer than two samples.
+     */
+    float stddev() const;
+};
+
+#endif // RUNNING_STATS_H
@@ -10,6 +10,7 @@
 #define SD_MANAGER_H
 
 #include <Arduino.h>
+#include "reading_record.h"
 
 namespace SDManager {
     /**
@@ -19,22 +20,34 @@ namespace SDManager {
     bool init();
 
     /**
-     * Write a sensor reading to the buffer file (JSONL format).
-     * Each line is one complete JSON object.
-     * Returns true if write succeeded.
+     * Write a sensor reading to the buffer log and the daily archive.
+     * With 'publish' false the reading is only archived, not queued
+     * for sending.
+     * Returns true if the buffer write (or, unpublished, the archive
+     * write) succeeded.
      */
-    bool writeReading(const String& jsonPayload);
+    bool writeReading(const ReadingRecord& record, bool publish = true);
 
     /**
      * Get number of buffered (unpublished) readings.
      */
     unsigned long getBufferCount();
 
+    /**
+     * Get SD bytes used by buffered readings.
+     */
+    unsigned long getBufferBytes();
+
+    /**
+     * Get timestamp of the oldest buffered reading (0 if none).
+     */
+    unsigned long getOldestBufferedEpoch();
+
     /**
      * Read the next buffered reading without removing it.
-     * Returns empty string if buffer is empty.
+     * Returns false if buffer is empty or the record is corrupted.
      */
-    String peekNextBuffered();
+    bool peekNextBuffered(ReadingRecord& record);
 
     /**
      * Remove the oldest buffered reading after successful publish.
@@ -47,7 +60,56 @@ namespace SDManager {
      * The callback should attempt MQTT publish and return true on success.
      * Returns number of readings successfully flushed.
      */
-    unsigned int flushBuffer(bool (*publishCallback)(const String& payload), unsigned int batchSize);
+    unsigned int flushBuffer(bool (*publishCallback)(const ReadingRecord& record), unsigned int batchSize);
+
+    /**
+     * Read up to 'maxCount' buffered readings, oldest first, starting
+     * 'skip' readings after the oldest. Nothing is removed.
+     * Returns number of readings read.
+     */
+    unsigned int peekBuffered(ReadingRecord* records, unsigned int maxCount, unsigned long skip = 0);
+
+    /**
+     * Remove the 'count' oldest buffered readings (once delivered).
+     * Returns number of readings removed.
+     */
+    unsigned int removeBuffered(unsigned int count);
+
+    /**
+     * Pass archived readings with start <= epoch <= end (Unix time)
+     * to the callback, oldest first, up to 'maxCount'. Stops early if
+     * the callback returns false. Reads only the archive blocks that
+     * overlap the range; holds the SD card meanwhile, so keep
+     * 'maxCount' small and continue from the last epoch returned.
+     * Returns number of readings passed to the callback.
+     */
+    unsigned int queryRange(uint32_t start, uint32_t end,
+                            bool (*callback)(const ReadingRecord& record),
+                            unsigned int maxCount);
+
+    /**
+     * Bytes used by the daily archive.
+     */
+    unsigned long getArchiveBytes();
+
+    /**
+     * Delete the oldest archived day (see Archive::removeOldestDay()).
+     * Returns true if a day was deleted.
+     */
+    bool removeOldestArchiveDay();
+
+    /**
+     * Bytes written to the card since boot by the buffer log and the
+     * archive.
+     */
+    unsigned long getBytesWritten();
+
+    /**
+     * Free space on the card in bytes. Counted on the card every
+     * SD_FREE_REFRESH_INTERVAL and estimated from the bytes written
+     * and removed in between.
+     */
+    uint64_t getFreeBytes();
 
     /**
      * Get SD card status info.
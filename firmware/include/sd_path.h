@@ -0,0 +1,42 @@
+/**
+ * sd_path.h - File paths built on the stack
+ *
+ * The buffer log and the archive build a path for every file
+ * operation; an SDPath holds it without touching the heap. Their
+ * directories are limited to SD_DIR_MAX, which leaves room for the
+ * longest file name below them. A path that still does not fit comes
+ * out empty instead of truncated, so it never names another file.
+ */
+
+#ifndef SD_PATH_H
+#define SD_PATH_H
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "config.h"
+
+struct SDPath {
+    char path[SD_PATH_MAX];
+
+    const char* c_str() const { return path; }
+    bool operator==(const SDPath& other) const { return strcmp(path, other.path) == 0; }
+    bool operator!=(const SDPath& other) const { return !(*this == other); }
+
+    /**
+     * Set the path printf-style.
+     * Returns false, leaving the path empty, if it does not fit.
+     */
+    __attribute__((format(printf, 2, 3)))
+    bool format(const char* fmt, ...) {
+        va_list args;
+        va_start(args, fmt);
+        int length = vsnprintf(path, sizeof(path), fmt, args);
+        va_end(args);
+        if (length >= 0 && length < (int)sizeof(path)) return true;
+        path[0] = '\0';
+        return false;
+    }
+};
+
+#endif // SD_PATH_H
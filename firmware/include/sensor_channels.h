@@ -0,0 +1,94 @@
+/**
+ * sensor_channels.h - Validation and fixed-point conversion table
+ *
+ * One descriptor per measured quantity: valid range, calibration
+ * offset, fixed-point scale and printed decimals. The sensor checks,
+ * the SD record and the JSON payload all take their numbers from
+ * here. Plain C++ with no Arduino dependencies.
+ */
+
+#ifndef SENSOR_CHANNELS_H
+#define SENSOR_CHANNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum ChannelId : uint8_t {
+    CH_CO2,
+    CH_TEMPERATURE,
+    CH_HUMIDITY,
+    CH_LIGHT,
+    CH_SOIL_MOISTURE,
+    CH_SOIL_RAW,
+    CH_COUNT
+};
+
+struct ChannelSpec {
+    float min;              // Valid range, after the offset
+    float max;
+    float offset;           // Calibration offset added to the sensor value
+    int32_t scale;          // Fixed-point units per engineering unit
+    uint8_t decimals;       // Digits after the point (scale = 10^decimals)
+};
+
+constexpr ChannelSpec CHANNELS[CH_COUNT] = {
+    //   min       max    offset  scale  decimals
+    {    0.0f, 10000.0f,  0.0f,    10,   1 },   // CO2, ppm
+    {  -40.0f,    80.0f,  0.0f,   100,   2 },   // Temperature, C
+    {    0.0f,   100.0f,  0.0f,    10,   1 },   // Humidity, %RH
+    {    0.0f, 65535.0f,  0.0f,    10,   1 },   // Light, lux
+    {   -1.0f,   100.0f,  0.0f,    10,   1 },   // Soil moisture, % (-1: outside calibration)
+    {    1.0f,  4094.0f,  0.0f,     1,   0 },   // Soil raw ADC (0 or 4095: wiring fault)
+};
+
+constexpr uint32_t channelBit(ChannelId ch) {
+    return 1u << ch;
+}
+
+// Channels that must all be in range for a sensor to count as valid
+constexpr uint32_t SCD30_CHANNELS = channelBit(CH_CO2) | channelBit(CH_TEMPERATURE) |
+                                    channelBit(CH_HUMIDITY);
+constexpr uint32_t BH1750_CHANNELS = channelBit(CH_LIGHT);
+constexpr uint32_t SOIL_CHANNELS = channelBit(CH_SOIL_RAW);
+
+constexpr int32_t pow10i(uint8_t n) {
+    return n == 0 ? 1 : 10 * pow10i(n - 1);
+}
+
+constexpr bool channelsConsistent(size_t i = 0) {
+    return i == CH_COUNT ||
+           (CHANNELS[i].min < CHANNELS[i].max &&
+            pow10i(CHANNELS[i].decimals) == CHANNELS[i].scale &&
+            channelsConsistent(i + 1));
+}
+
+static_assert(channelsConsistent(), "CHANNELS: min must be below max and scale = 10^decimals");
+
+namespace Channels {
+    /**
+     * True if 'value' (before the offset) is in the channel's range.
+     * NaN is never in range.
+     */
+    constexpr bool inRange(ChannelId ch, float value) {
+        return value + CHANNELS[ch].offset >= CHANNELS[ch].min &&
+               value + CHANNELS[ch].offset <= CHANNELS[ch].max;
+    }
+
+    /**
+     * 'value' in the channel's fixed-point units, rounded to nearest
+     * (for thresholds from config.h; no offset, no range check).
+     */
+    constexpr int32_t toFixed(ChannelId ch, double value) {
+        return (int32_t)(value * CHANNELS[ch].scale + (value < 0 ? -0.5 : 0.5));
+    }
+
+    /**
+     * Convert one value per channel to fixed-point in one pass: apply
+     * the offset, scale and round to nearest. Out-of-range values are
+     * still converted (saturated to int32); NaN becomes 0.
+     * Returns a bitmask of the channels that were in range.
+     */
+    uint32_t convert(const float values[CH_COUNT], int32_t fixed[CH_COUNT]);
+}
+
+#endif // SENSOR_CHANNELS_H
@@ -3,12 +3,18 @@
  * 
  * Handles SCD30 (CO2/Temp/RH), BH1750 (Light), 
  * and capacitive soil moisture sensor.
+ * 
+ * Sensors are read in the background by poll(), each at its own
+ * rate; read() returns the averages since the last read() without
+ * touching the bus.
  */
 
 #ifndef SENSOR_MANAGER_H
 #define SENSOR_MANAGER_H
 
 #include <Arduino.h>
+#include "running_stats.h"
+#include "sensor_channels.h"
 
 // Sensor reading structure
 struct SensorData {
@@ -17,10 +23,23 @@ struct SensorData {
     float humidity;         // %RH
     float light;            // lux
     float soilMoisture;     // percentage (0-100%)
-    int   soilRaw;          // raw ADC value
+    int   soilRaw;          // raw ADC value (filtered)
+    float soilNoise;        // ADC noise, standard deviation in raw counts
     bool  scd30Valid;       // SCD30 reading valid
     bool  bh1750Valid;      // BH1750 reading valid
     bool  soilValid;        // Soil reading valid
+    uint32_t scd30Age;      // ms since each value was measured
+    uint32_t bh1750Age;
+    uint32_t soilAge;
+};
+
+/**
+ * Statistics of all valid samples taken during one reading interval,
+ * per channel (indexed by ChannelId).
+ */
+struct WindowSummary {
+    RunningStats channels[CH_COUNT];
+    uint32_t durationMs;
 };
 
 namespace SensorManager {
@@ -31,16 +50,32 @@ namespace SensorManager {
     bool init();
 
     /**
-     * Read all sensors and return data.
+     * Advance each sensor's acquisition by at most one step.
+     * Never blocks; call every SENSOR_POLL_INTERVAL from the same
+     * task that calls read().
      */
-    SensorData read();
+    void poll();
 
     /**
-     * Check if individual sensors are responding.
+     * Close the current window and return the mean of every sample
+     * taken since the previous call, with the age of the newest.
+     * A sensor with no valid sample in the window is marked invalid.
+     * If 'summary' is given, it receives the window's statistics.
+     */
+    SensorData read(WindowSummary* summary = nullptr);
+
+    /**
+     * Check if individual sensors are responding (have delivered a
+     * value within SENSOR_MAX_AGE).
      */
     bool isSCD30Ready();
     bool isBH1750Ready();
 
+    /**
+     * ADC noise of the last soil value (standard deviation, raw counts).
+     */
+    float getSoilNoise();
+
     /**
      * Get sensor status as JSON string for diagnostics.
      */
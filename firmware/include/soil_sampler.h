@@ -0,0 +1,37 @@
+/**
+ * soil_sampler.h - Background ADC sampling for the soil sensor
+ *
+ * The ADC runs continuously at SOIL_ADC_SAMPLE_RATE through the I2S
+ * peripheral's built-in ADC mode, and DMA fills the buffers without
+ * the CPU. Readings are corrected with the chip's eFuse calibration.
+ * If the driver cannot be started, falls back to analogRead().
+ */
+
+#ifndef SOIL_SAMPLER_H
+#define SOIL_SAMPLER_H
+
+#include <Arduino.h>
+
+namespace SoilSampler {
+    /**
+     * Configure the ADC channel for SOIL_PIN and start sampling.
+     * Returns true if DMA sampling is running.
+     */
+    bool begin();
+
+    /**
+     * Copy up to 'maxCount' raw 12-bit samples into 'samples'.
+     * Never blocks; returns the number copied (may be 0).
+     */
+    size_t collect(uint16_t* samples, size_t maxCount);
+
+    /**
+     * Convert a raw ADC value to millivolts using the eFuse
+     * calibration (or the nominal curve if the chip has none).
+     */
+    float toMillivolts(float raw);
+
+    bool isDMA();
+}
+
+#endif // SOIL_SAMPLER_H
@@ -7,10 +7,13 @@
 
 #include <Arduino.h>
 
+// "2026-03-15T14:30:00+02:00" plus terminator
+#define ISO8601_BUFFER_SIZE 26
+
 namespace TimeManager {
     /**
-     * Initialize NTP time sync for Europe/Helsinki timezone.
-     * Must be called after WiFi is connected.
+     * Start NTP time sync for Europe/Helsinki timezone.
+     * Does not wait; maintain() detects when the clock is set.
      */
     void init();
 
@@ -26,6 +29,14 @@ namespace TimeManager {
      */
     String getISO8601();
 
+    /**
+     * Format a Unix timestamp as local ISO 8601 time into 'buffer'
+     * (at least ISO8601_BUFFER_SIZE bytes). Writes the 1970
+     * placeholder if 'valid' is false.
+     * Returns the length written, or 0 if it does not fit.
+     */
+    size_t formatISO8601(char* buffer, size_t size, unsigned long epoch, bool valid = true);
+
     /**
      * Get Unix timestamp (seconds since epoch).
      */
@@ -36,6 +47,17 @@ namespace TimeManager {
      */
     bool isSynced();
 
+    /**
+     * Unix time at boot, derived from the first NTP sync.
+     * 0 until synced.
+     */
+    unsigned long getBootEpoch();
+
+    /**
+     * Milliseconds from init() to the first NTP sync (0 until synced).
+     */
+    unsigned long getFirstSyncTime();
+
     /**
      * Get uptime in seconds since boot.
      */
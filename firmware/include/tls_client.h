@@ -0,0 +1,79 @@
+/**
+ * tls_client.h - TLS client with session resumption
+ *
+ * Drop-in replacement for WiFiClientSecure. After the first full
+ * handshake the TLS session (ID or ticket) is kept and offered on the
+ * next connect, so a reconnect costs an abbreviated handshake instead
+ * of certificate verification and a key exchange. The session is also
+ * kept in RTC memory, so it survives a software restart or deep sleep.
+ */
+
+#ifndef TLS_CLIENT_H
+#define TLS_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include "hal.h"
+#include <mbedtls/ssl.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/x509_crt.h>
+
+class TLSClient : public Client {
+public:
+    TLSClient();
+    ~TLSClient();
+
+    /**
+     * Set the CA certificate (PEM) used to verify the server.
+     * The string must stay valid; it is parsed on the first connect.
+     */
+    void setCACert(const char* rootCA);
+
+    /**
+     * Forget the cached session so the next connect does a full
+     * handshake.
+     */
+    void clearSession();
+
+    const TLSStats& getStats() const { return stats; }
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    void flush() override;
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return connected(); }
+
+private:
+    WiFiClient tcp;
+    const char* caCert = nullptr;
+    bool configured = false;
+    bool open = false;
+    bool haveSession = false;
+    int peeked = -1;
+    TLSStats stats = {};
+
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_config conf;
+    mbedtls_ssl_session session;
+    mbedtls_ctr_drbg_context drbg;
+    mbedtls_entropy_context entropy;
+    mbedtls_x509_crt ca;
+    mbedtls_net_context net;
+
+    bool configure();
+    bool handshake(const char* host);
+    void saveSession();
+    void restoreSession();
+    void fail(const char* what, int ret);
+};
+
+#endif // TLS_CLIENT_H
@@ -9,15 +9,15 @@
 
 namespace WiFiManager {
     /**
-     * Initialize WiFi in station mode and connect.
-     * Blocks until connected or max retries reached.
-     * Reboots ESP32 if connection fails after max retries.
+     * Initialize WiFi in station mode and start connecting.
+     * Does not wait for the connection; maintain() completes it.
      */
     void init();
 
     /**
-     * Check connection and reconnect if needed.
+     * Check connection and reconnect if needed. Never blocks.
      * Call this in the main loop.
+     * Reboots ESP32 after WIFI_MAX_RETRIES failed attempts in a row.
      * Returns true if connected, false if reconnecting.
      */
     bool maintain();
@@ -29,6 +29,13 @@ namespace WiFiManager {
     int getRSSI();
     String getIP();
     String getMAC();
+
+    /**
+     * Milliseconds from losing the link (or boot) until the last
+     * connection came up, and number of reconnects since boot.
+     */
+    unsigned long getLastConnectTime();
+    unsigned long getReconnectCount();
 }
 
 #endif // WIFI_MANAGER_H
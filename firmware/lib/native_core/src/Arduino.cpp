@@ -0,0 +1,195 @@
+/**
+ * Arduino.cpp - Arduino core API on the host (env:native)
+ */
+
+#include "Arduino.h"
+#include <malloc.h>
+#include <stdarg.h>
+#include <atomic>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+char** nativeArgv = nullptr;
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+}
+
+unsigned long micros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+}
+
+void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield() {
+    std::this_thread::yield();
+}
+
+long random(long howbig) {
+    return howbig > 0 ? ::random() % howbig : 0;
+}
+
+long random(long howsmall, long howbig) {
+    return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed) {
+    if (seed) srandom(seed);
+}
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec,
+                const char* server1, const char* server2, const char* server3) {
+    (void)server1; (void)server2; (void)server3;
+
+    // POSIX offsets are west of UTC, hence the signs
+    char tz[32];
+    long standard = -gmtOffsetSec;
+    int n = snprintf(tz, sizeof(tz), "UTC%ld:%02ld", standard / 3600, labs(standard % 3600) / 60);
+    if (daylightOffsetSec) {
+        long summer = standard - daylightOffsetSec;
+        snprintf(tz + n, sizeof(tz) - n, "DST%ld:%02ld", summer / 3600, labs(summer % 3600) / 60);
+    }
+    setenv("TZ", tz, 1);
+    tzset();
+}
+
+bool getLocalTime(struct tm* info, uint32_t ms) {
+    (void)ms;
+    time_t now = time(nullptr);
+    localtime_r(&now, info);
+    return info->tm_year > (2016 - 1900);
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+        if (!write(*buffer++)) break;
+        n++;
+    }
+    return n;
+}
+
+size_t Print::printf(const char* format, ...) {
+    char local[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(local, sizeof(local), format, args);
+    va_end(args);
+    if (length < 0) return 0;
+    if ((size_t)length < sizeof(local)) return write((const uint8_t*)local, length);
+
+    char* buffer = (char*)malloc(length + 1);
+    if (!buffer) return 0;
+    va_start(args, format);
+    vsnprintf(buffer, length + 1, format, args);
+    va_end(args);
+    size_t n = write((const uint8_t*)buffer, length);
+    free(buffer);
+    return n;
+}
+
+int Stream::timedRead() {
+    unsigned long start = millis();
+    do {
+        int c = read();
+        if (c >= 0) return c;
+        yield();
+    } while (millis() - start < timeout);
+    return -1;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int c = timedRead();
+        if (c < 0) break;
+        *buffer++ = (char)c;
+        count++;
+    }
+    return count;
+}
+
+String Stream::readStringUntil(char terminator) {
+    String ret;
+    int c = timedRead();
+    while (c >= 0 && c != terminator) {
+        ret += (char)c;
+        c = timedRead();
+    }
+    return ret;
+}
+
+bool IPAddress::operator==(const IPAddress& other) const {
+    return memcmp(address, other.address, sizeof(address)) == 0;
+}
+
+String IPAddress::toString() const {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", address[0], address[1], address[2], address[3]);
+    return String(buf);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return fputc(c, stdout) == EOF ? 0 : 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    return fwrite(buffer, 1, size, stdout);
+}
+
+void HardwareSerial::flush() {
+    fflush(stdout);
+}
+
+void EspClass::restart() {
+    Serial.println("[Host] Restart");
+    fflush(stdout);
+    if (nativeArgv) execv("/proc/self/exe", nativeArgv);
+    exit(1);
+}
+
+static std::atomic<uint32_t> minFreeHeap(UINT32_MAX);
+
+uint32_t EspClass::getFreeHeap() {
+    // Free bytes held by the allocator; the host has no fixed heap
+    struct mallinfo2 info = mallinfo2();
+    uint32_t free = (uint32_t)std::min(info.fordblks, (size_t)UINT32_MAX);
+
+    uint32_t low = minFreeHeap;
+    while (free < low && !minFreeHeap.compare_exchange_weak(low, free)) {}
+    return free;
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+    // Lowest value getFreeHeap() has seen
+    getFreeHeap();
+    return minFreeHeap;
+}
+
+uint32_t EspClass::getMaxAllocHeap() {
+    // glibc can always extend the heap: all free bytes count as one block
+    return getFreeHeap();
+}
+
+uint64_t EspClass::getEfuseMac() {
+    return (uint64_t)gethostid();
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    nativeArgv = argv;
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    srandom((unsigned)time(nullptr) ^ (unsigned)getpid());
+
+    setup();
+    for (;;) loop();
+}
@@ -0,0 +1,92 @@
+/**
+ * Arduino.h - Arduino core API on the host (env:native)
+ *
+ * The subset of the ESP32 Arduino core the firmware uses: clock,
+ * Serial (stdout), String, random numbers, SNTP-style time setup and
+ * the ESP object. main() runs setup() and then loop() like the core.
+ */
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "IPAddress.h"
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define PROGMEM
+#define F(str) (str)
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+using std::min;
+using std::max;
+
+// Clock: milliseconds and microseconds since the program started
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+/**
+ * Set the time zone the way the ESP32 core does; the host clock is
+ * already synchronized, so the servers are not used.
+ */
+void configTime(long gmtOffsetSec, int daylightOffsetSec,
+                const char* server1, const char* server2 = nullptr, const char* server3 = nullptr);
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
+
+/**
+ * Serial port: output goes to stdout.
+ */
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override;
+};
+
+extern HardwareSerial Serial;
+
+/**
+ * Chip functions. restart() starts the program again, like a reset.
+ */
+class EspClass {
+public:
+    void restart();
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+    uint64_t getEfuseMac();
+};
+
+extern EspClass ESP;
+
+// Command line, kept by main() for ESP.restart()
+extern char** nativeArgv;
+
+void setup();
+void loop();
+
+#endif // ARDUINO_H
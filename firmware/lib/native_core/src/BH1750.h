@@ -0,0 +1,36 @@
+/**
+ * BH1750.h - Simulated BH1750 light sensor (env:native)
+ *
+ * Same interface as the claws/BH1750 driver. Continuous modes have a
+ * new value every 120 ms (16 ms in low resolution).
+ */
+
+#ifndef BH1750_H
+#define BH1750_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+class BH1750 {
+public:
+    enum Mode {
+        UNCONFIGURED = 0,
+        CONTINUOUS_HIGH_RES_MODE = 0x10,
+        CONTINUOUS_HIGH_RES_MODE_2 = 0x11,
+        CONTINUOUS_LOW_RES_MODE = 0x13,
+        ONE_TIME_HIGH_RES_MODE = 0x20,
+        ONE_TIME_HIGH_RES_MODE_2 = 0x21,
+        ONE_TIME_LOW_RES_MODE = 0x23
+    };
+
+    explicit BH1750(byte addr = 0x23) { (void)addr; }
+    bool begin(Mode mode = CONTINUOUS_HIGH_RES_MODE, byte addr = 0x23, TwoWire* i2c = nullptr);
+    bool measurementReady(bool maxWait = false);
+    float readLightLevel();
+
+private:
+    Mode mode = UNCONFIGURED;
+    unsigned long lastRead = 0;
+};
+
+#endif // BH1750_H
@@ -0,0 +1,193 @@
+/**
+ * FS.cpp - Arduino fs::FS on the host (env:native)
+ */
+
+#include "FS.h"
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs {
+
+/**
+ * An open file (stdio stream) or directory (readdir handle).
+ */
+class FileImpl {
+public:
+    FileImpl(const std::string& path, const std::string& hostPath, FILE* file, DIR* dir,
+             std::shared_ptr<long> budget)
+        : path(path), hostPath(hostPath), file(file), dir(dir), budget(budget) {}
+    ~FileImpl() { close(); }
+
+    void close() {
+        if (file) fclose(file);
+        if (dir) closedir(dir);
+        file = nullptr;
+        dir = nullptr;
+    }
+
+    std::string path;
+    std::string hostPath;
+    FILE* file;
+    DIR* dir;
+    std::shared_ptr<long> budget;   // Write budget of the FS (-1: unlimited)
+};
+
+size_t File::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t* buf, size_t size) {
+    if (!impl || !impl->file) return 0;
+    long& budget = *impl->budget;
+    if (budget >= 0) {
+        if ((long)size > budget) size = budget;
+        budget -= size;
+    }
+    return size ? fwrite(buf, 1, size, impl->file) : 0;
+}
+
+int File::available() {
+    if (!impl || !impl->file) return 0;
+    return (int)(size() - position());
+}
+
+int File::read() {
+    if (!impl || !impl->file) return -1;
+    return fgetc(impl->file);
+}
+
+size_t File::read(uint8_t* buf, size_t size) {
+    if (!impl || !impl->file) return 0;
+    return fread(buf, 1, size, impl->file);
+}
+
+int File::peek() {
+    if (!impl || !impl->file) return -1;
+    int c = fgetc(impl->file);
+    if (c != EOF) ungetc(c, impl->file);
+    return c;
+}
+
+void File::flush() {
+    if (impl && impl->file) fflush(impl->file);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    if (!impl || !impl->file) return false;
+    int whence = mode == SeekCur ? SEEK_CUR : (mode == SeekEnd ? SEEK_END : SEEK_SET);
+    return fseek(impl->file, pos, whence) == 0;
+}
+
+size_t File::position() const {
+    if (!impl || !impl->file) return 0;
+    long pos = ftell(impl->file);
+    return pos < 0 ? 0 : pos;
+}
+
+size_t File::size() const {
+    if (!impl || !impl->file) return 0;
+    fflush(impl->file);
+    struct stat st;
+    return fstat(fileno(impl->file), &st) == 0 ? st.st_size : 0;
+}
+
+void File::close() {
+    if (impl) impl->close();
+    impl.reset();
+}
+
+const char* File::path() const {
+    return impl ? impl->path.c_str() : nullptr;
+}
+
+const char* File::name() const {
+    if (!impl) return nullptr;
+    const char* slash = strrchr(impl->path.c_str(), '/');
+    return slash ? slash + 1 : impl->path.c_str();
+}
+
+bool File::isDirectory() const {
+    return impl && impl->dir;
+}
+
+File File::openNextFile(const char* mode) {
+    if (!impl || !impl->dir) return File();
+
+    struct dirent* entry;
+    while ((entry = readdir(impl->dir)) != nullptr) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+
+        std::string path = impl->path;
+        if (path.empty() || path[path.size() - 1] != '/') path += '/';
+        path += entry->d_name;
+        std::string hostPath = impl->hostPath + '/' + entry->d_name;
+
+        struct stat st;
+        if (stat(hostPath.c_str(), &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            DIR* dir = opendir(hostPath.c_str());
+            if (dir) return File(std::make_shared<FileImpl>(path, hostPath, nullptr, dir, impl->budget));
+        } else {
+            FILE* file = fopen(hostPath.c_str(), strcmp(mode, FILE_READ) == 0 ? "rb" : "r+b");
+            if (file) return File(std::make_shared<FileImpl>(path, hostPath, file, nullptr, impl->budget));
+        }
+    }
+    return File();
+}
+
+std::string FS::hostPath(const char* path) const {
+    if (!path || !*path) return root;
+    return path[0] == '/' ? root + path : root + '/' + path;
+}
+
+File FS::open(const char* path, const char* mode, bool create) {
+    (void)create;
+    std::string host = hostPath(path);
+
+    struct stat st;
+    if (stat(host.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        DIR* dir = opendir(host.c_str());
+        return dir ? File(std::make_shared<FileImpl>(path, host, nullptr, dir, budget)) : File();
+    }
+    if (powerLost() && strcmp(mode, FILE_READ) != 0) return File();
+
+    // Same meaning as on the ESP32 VFS: "w" truncates, "a" appends
+    const char* hostMode = "rb";
+    if (strcmp(mode, FILE_WRITE) == 0) hostMode = "wb";
+    else if (strcmp(mode, FILE_APPEND) == 0) hostMode = "ab";
+    else if (strcmp(mode, "r+") == 0) hostMode = "r+b";
+    else if (strcmp(mode, "w+") == 0) hostMode = "w+b";
+    else if (strcmp(mode, "a+") == 0) hostMode = "a+b";
+
+    FILE* file = fopen(host.c_str(), hostMode);
+    if (!file) return File();
+    return File(std::make_shared<FileImpl>(path, host, file, nullptr, budget));
+}
+
+bool FS::exists(const char* path) {
+    struct stat st;
+    return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char* path) {
+    if (powerLost()) return false;
+    return unlink(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char* from, const char* to) {
+    if (powerLost()) return false;
+    return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+    if (powerLost()) return false;
+    return ::mkdir(hostPath(path).c_str(), 0755) == 0;
+}
+
+bool FS::rmdir(const char* path) {
+    if (powerLost()) return false;
+    return ::rmdir(hostPath(path).c_str()) == 0;
+}
+
+} // namespace fs
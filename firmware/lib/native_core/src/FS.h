@@ -0,0 +1,107 @@
+/**
+ * FS.h - Arduino fs::FS on the host (env:native)
+ *
+ * A directory stands in for the mounted filesystem: paths are taken
+ * relative to the root given to the constructor. File behaves like
+ * the ESP32 core's (name() is the last path component).
+ *
+ * For power-loss tests a write budget can be set: once it is used up,
+ * writes are cut short and nothing else changes on disk.
+ */
+
+#ifndef FS_H
+#define FS_H
+
+#include <stdio.h>
+#include <memory>
+#include <string>
+#include "Stream.h"
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class FileImpl;
+
+class File : public Stream {
+public:
+    File() {}
+    explicit File(std::shared_ptr<FileImpl> impl) : impl(impl) {}
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    size_t read(uint8_t* buf, size_t size);
+    int peek() override;
+    void flush() override;
+    bool seek(uint32_t pos, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    void close();
+    operator bool() const { return impl != nullptr; }
+
+    const char* path() const;
+    const char* name() const;
+    bool isDirectory() const;
+    File openNextFile(const char* mode = FILE_READ);
+
+private:
+    std::shared_ptr<FileImpl> impl;
+};
+
+class FS {
+public:
+    explicit FS(const char* root) : root(root), budget(std::make_shared<long>(-1)) {}
+
+    File open(const char* path, const char* mode = FILE_READ, bool create = false);
+    File open(const String& path, const char* mode = FILE_READ, bool create = false) {
+        return open(path.c_str(), mode, create);
+    }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rename(const char* from, const char* to);
+    bool rename(const String& from, const String& to) { return rename(from.c_str(), to.c_str()); }
+    bool mkdir(const char* path);
+    bool mkdir(const String& path) { return mkdir(path.c_str()); }
+    bool rmdir(const char* path);
+    bool rmdir(const String& path) { return rmdir(path.c_str()); }
+
+    const char* rootPath() const { return root.c_str(); }
+
+    /**
+     * Let 'bytes' more bytes be written, then cut the power: later
+     * writes are short, and opening for writing, removing, renaming
+     * and creating fail. -1 lifts the limit (the default).
+     */
+    void setWriteBudget(long bytes) { *budget = bytes; }
+
+    /**
+     * Bytes left to write before the cut (-1 if unlimited).
+     */
+    long writeBudget() const { return *budget; }
+
+private:
+    std::string root;
+    std::shared_ptr<long> budget;   // Shared with the open files
+    bool powerLost() const { return *budget == 0; }
+    std::string hostPath(const char* path) const;
+};
+
+} // namespace fs
+
+using fs::FS;
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+#endif // FS_H
@@ -0,0 +1,25 @@
+/**
+ * IPAddress.h - Arduino IPAddress on the host (env:native)
+ */
+
+#ifndef IPADDRESS_H
+#define IPADDRESS_H
+
+#include <stdint.h>
+#include "WString.h"
+
+class IPAddress {
+public:
+    IPAddress() : address{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : address{a, b, c, d} {}
+
+    uint8_t operator[](int index) const { return address[index]; }
+    uint8_t& operator[](int index) { return address[index]; }
+    bool operator==(const IPAddress& other) const;
+    String toString() const;
+
+private:
+    uint8_t address[4];
+};
+
+#endif // IPADDRESS_H
@@ -0,0 +1,69 @@
+/**
+ * Preferences.cpp - ESP32 NVS preferences on the host (env:native)
+ */
+
+#include "Preferences.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define NVS_DIR "nvs"
+
+bool Preferences::begin(const char* name, bool readOnly, const char* partition) {
+    (void)partition;
+    if (!name || !*name) return false;
+    mkdir(NVS_DIR, 0755);
+    dir = std::string(NVS_DIR "/") + name;
+    mkdir(dir.c_str(), 0755);
+    this->readOnly = readOnly;
+    started = true;
+    return true;
+}
+
+void Preferences::end() {
+    started = false;
+}
+
+bool Preferences::clear() {
+    if (!started || readOnly) return false;
+    DIR* d = opendir(dir.c_str());
+    if (!d) return false;
+    struct dirent* entry;
+    while ((entry = readdir(d)) != nullptr) {
+        if (entry->d_name[0] != '.') unlink(keyPath(entry->d_name).c_str());
+    }
+    closedir(d);
+    return true;
+}
+
+bool Preferences::remove(const char* key) {
+    if (!started || readOnly) return false;
+    return unlink(keyPath(key).c_str()) == 0;
+}
+
+bool Preferences::isKey(const char* key) {
+    struct stat st;
+    return started && stat(keyPath(key).c_str(), &st) == 0;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+    if (!started || readOnly) return 0;
+    FILE* f = fopen(keyPath(key).c_str(), "wb");
+    if (!f) return 0;
+    size_t written = fwrite(value, 1, length, f);
+    fclose(f);
+    return written;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLength) {
+    if (!started) return 0;
+    FILE* f = fopen(keyPath(key).c_str(), "rb");
+    if (!f) return 0;
+    size_t length = fread(buf, 1, maxLength, f);
+    // Like NVS: a value larger than the buffer is not returned
+    bool tooLong = fgetc(f) != EOF;
+    fclose(f);
+    return tooLong ? 0 : length;
+}
@@ -0,0 +1,88 @@
+/**
+ * Simulation.cpp - Greenhouse model behind the simulated sensors
+ * (env:native)
+ */
+
+#include "Simulation.h"
+#include "SparkFun_SCD30_Arduino_Library.h"
+#include "BH1750.h"
+
+TwoWire Wire;
+TwoWire Wire1;
+
+/**
+ * Sun elevation as 0 (night) to 1 (noon), 06:00 to 18:00 local time.
+ */
+static float sun() {
+    time_t now = time(nullptr);
+    struct tm local;
+    localtime_r(&now, &local);
+    float hour = local.tm_hour + local.tm_min / 60.0f + local.tm_sec / 3600.0f;
+    float s = sinf((float)M_PI * (hour - 6.0f) / 12.0f);
+    return s > 0 ? s : 0;
+}
+
+/**
+ * Roughly normal noise with the given standard deviation.
+ */
+static float noise(float sd) {
+    float sum = 0;
+    for (int i = 0; i < 4; i++) sum += random(-1000, 1001) / 1000.0f;
+    return sum * 0.866f * sd;       // Sum of 4 uniforms has sd 1.155
+}
+
+float Simulation::light()       { return 30000.0f * sun() + 5.0f + noise(20.0f); }
+float Simulation::co2()         { return 800.0f - 350.0f * sun() + noise(5.0f); }
+float Simulation::temperature() { return 18.0f + 8.0f * sun() + noise(0.05f); }
+float Simulation::humidity()    { return 75.0f - 20.0f * sun() + noise(0.3f); }
+float Simulation::soilRaw()     { return 2200.0f + 30.0f * sun() + noise(15.0f); }
+
+bool SCD30::begin(TwoWire& wirePort, bool autoCalibrate, bool measBegin) {
+    (void)wirePort; (void)autoCalibrate; (void)measBegin;
+    lastRead = millis();
+    return true;
+}
+
+bool SCD30::setMeasurementInterval(uint16_t interval) {
+    if (interval < 2 || interval > 1800) return false;
+    intervalMs = interval * 1000UL;
+    return true;
+}
+
+bool SCD30::setAutoSelfCalibration(bool enable) {
+    (void)enable;
+    return true;
+}
+
+bool SCD30::dataAvailable() {
+    return millis() - lastRead >= intervalMs;
+}
+
+bool SCD30::readMeasurement() {
+    if (!dataAvailable()) return false;
+    lastRead = millis();
+    co2 = (uint16_t)(Simulation::co2() + 0.5f);
+    temperature = Simulation::temperature();
+    humidity = Simulation::humidity();
+    return true;
+}
+
+bool BH1750::begin(Mode mode, byte addr, TwoWire* i2c) {
+    (void)addr; (void)i2c;
+    this->mode = mode;
+    lastRead = millis();
+    return true;
+}
+
+bool BH1750::measurementReady(bool maxWait) {
+    (void)maxWait;
+    unsigned long time = mode == CONTINUOUS_LOW_RES_MODE || mode == ONE_TIME_LOW_RES_MODE ? 16 : 120;
+    return millis() - lastRead >= time;
+}
+
+float BH1750::readLightLevel() {
+    if (mode == UNCONFIGURED) return -2.0f;
+    lastRead = millis();
+    float lux = Simulation::light();
+    return lux > 0 ? lux : 0;
+}
@@ -0,0 +1,21 @@
+/**
+ * Simulation.h - Greenhouse model behind the simulated sensors
+ * (env:native)
+ *
+ * Values follow the sun through the local day: light peaks at noon,
+ * warming the air and lowering humidity, while the plants draw CO2
+ * down. Each call adds a little measurement noise.
+ */
+
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+namespace Simulation {
+    float light();          // lux
+    float co2();            // ppm
+    float temperature();    // C
+    float humidity();       // %RH
+    float soilRaw();        // 12-bit ADC value of the capacitive probe
+}
+
+#endif // SIMULATION_H
@@ -0,0 +1,104 @@
+/**
+ * SocketClient.cpp - TCP client over a POSIX socket (env:native)
+ */
+
+#include "SocketClient.h"
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+int SocketClient::connect(IPAddress ip, uint16_t port) {
+    return connect(ip.toString().c_str(), port);
+}
+
+int SocketClient::connect(const char* host, uint16_t port) {
+    stop();
+
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    if (getaddrinfo(host, service, &hints, &result) != 0) return 0;
+
+    for (struct addrinfo* a = result; a; a = a->ai_next) {
+        int s = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (s < 0) continue;
+        if (::connect(s, a->ai_addr, a->ai_addrlen) == 0) {
+            fd = s;
+            break;
+        }
+        close(s);
+    }
+    freeaddrinfo(result);
+    if (fd < 0) return 0;
+
+    // MQTT packets are small; send each one at once
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return 1;
+}
+
+size_t SocketClient::write(const uint8_t* buf, size_t size) {
+    if (fd < 0) return 0;
+    size_t sent = 0;
+    while (sent < size) {
+        ssize_t n = send(fd, buf + sent, size - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            stop();
+            break;
+        }
+        sent += n;
+    }
+    return sent;
+}
+
+int SocketClient::available() {
+    if (fd < 0) return 0;
+    int n = 0;
+    return ioctl(fd, FIONREAD, &n) == 0 ? n : 0;
+}
+
+int SocketClient::read() {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+int SocketClient::read(uint8_t* buf, size_t size) {
+    if (fd < 0) return -1;
+    ssize_t n = recv(fd, buf, size, MSG_DONTWAIT);
+    if (n == 0) {
+        stop();         // Closed by the peer
+        return -1;
+    }
+    return n < 0 ? -1 : (int)n;
+}
+
+int SocketClient::peek() {
+    if (fd < 0) return -1;
+    uint8_t b;
+    return recv(fd, &b, 1, MSG_DONTWAIT | MSG_PEEK) == 1 ? b : -1;
+}
+
+void SocketClient::stop() {
+    if (fd >= 0) close(fd);
+    fd = -1;
+}
+
+uint8_t SocketClient::connected() {
+    if (fd < 0) return 0;
+    uint8_t b;
+    ssize_t n = recv(fd, &b, 1, MSG_DONTWAIT | MSG_PEEK);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        stop();
+        return 0;
+    }
+    return 1;
+}
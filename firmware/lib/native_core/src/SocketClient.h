@@ -0,0 +1,34 @@
+/**
+ * SocketClient.h - TCP client over a POSIX socket (env:native)
+ *
+ * Stands in for WiFiClient on the host. connect() blocks until the
+ * connection is up or fails; reads never block.
+ */
+
+#ifndef SOCKET_CLIENT_H
+#define SOCKET_CLIENT_H
+
+#include "Client.h"
+
+class SocketClient : public Client {
+public:
+    ~SocketClient() { stop(); }
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t* buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    void flush() override {}
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return connected(); }
+
+private:
+    int fd = -1;
+};
+
+#endif // SOCKET_CLIENT_H
@@ -0,0 +1,35 @@
+/**
+ * SparkFun_SCD30_Arduino_Library.h - Simulated SCD30 (env:native)
+ *
+ * Same interface as the SparkFun driver. A new measurement is ready
+ * every measurement interval; values follow a day/night cycle in
+ * local time with a little noise (see Simulation.h).
+ */
+
+#ifndef SPARKFUN_SCD30_ARDUINO_LIBRARY_H
+#define SPARKFUN_SCD30_ARDUINO_LIBRARY_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+class SCD30 {
+public:
+    bool begin(TwoWire& wirePort = Wire, bool autoCalibrate = false, bool measBegin = true);
+    bool setMeasurementInterval(uint16_t interval);
+    bool setAutoSelfCalibration(bool enable);
+
+    bool dataAvailable();
+    bool readMeasurement();
+    uint16_t getCO2() { return co2; }
+    float getTemperature() { return temperature; }
+    float getHumidity() { return humidity; }
+
+private:
+    unsigned long intervalMs = 2000;
+    unsigned long lastRead = 0;
+    uint16_t co2 = 0;
+    float temperature = 0;
+    float humidity = 0;
+};
+
+#endif // SPARKFUN_SCD30_ARDUINO_LIBRARY_H
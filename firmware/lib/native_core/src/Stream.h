@@ -0,0 +1,26 @@
+/**
+ * Stream.h - Arduino Stream on the host (env:native)
+ */
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "Print.h"
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long ms) { timeout = ms; }
+    size_t readBytes(char* buffer, size_t length);
+    size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+    String readStringUntil(char terminator);
+
+protected:
+    unsigned long timeout = 1000;
+    int timedRead();
+};
+
+#endif // STREAM_H
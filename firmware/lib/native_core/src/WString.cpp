@@ -0,0 +1,88 @@
+/**
+ * WString.cpp - Arduino String on the host (env:native)
+ */
+
+#include "WString.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <utility>
+
+static std::string toBase(unsigned long long value, unsigned char base, bool negative) {
+    if (base < 2 || base > 36) base = 10;
+    char buf[66];
+    char* p = buf + sizeof(buf);
+    *--p = 0;
+    do {
+        int digit = value % base;
+        *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        value /= base;
+    } while (value);
+    if (negative) *--p = '-';
+    return p;
+}
+
+static std::string toDecimals(double value, unsigned int decimals) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimals, value);
+    return buf;
+}
+
+String::String(int value, unsigned char base)
+    : s(base == 10 ? toBase(value < 0 ? -(long long)value : value, 10, value < 0) : toBase((unsigned int)value, base, false)) {}
+String::String(unsigned int value, unsigned char base) : s(toBase(value, base, false)) {}
+String::String(long value, unsigned char base)
+    : s(base == 10 ? toBase(value < 0 ? -(long long)value : value, 10, value < 0) : toBase((unsigned long)value, base, false)) {}
+String::String(unsigned long value, unsigned char base) : s(toBase(value, base, false)) {}
+String::String(long long value, unsigned char base)
+    : s(base == 10 ? toBase(value < 0 ? 0ULL - (unsigned long long)value : value, 10, value < 0)
+                   : toBase((unsigned long long)value, base, false)) {}
+String::String(unsigned long long value, unsigned char base) : s(toBase(value, base, false)) {}
+String::String(float value, unsigned int decimals) : s(toDecimals(value, decimals)) {}
+String::String(double value, unsigned int decimals) : s(toDecimals(value, decimals)) {}
+
+bool String::endsWith(const String& suffix) const {
+    return s.size() >= suffix.s.size() &&
+           s.compare(s.size() - suffix.s.size(), suffix.s.size(), suffix.s) == 0;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+    size_t pos = s.find(c, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String& str, unsigned int from) const {
+    size_t pos = s.find(str.s, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char c) const {
+    size_t pos = s.rfind(c);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int from) const {
+    return substring(from, s.size());
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) std::swap(from, to);
+    if (from >= s.size()) return String();
+    if (to > s.size()) to = s.size();
+    return String(s.substr(from, to - from).c_str());
+}
+
+void String::trim() {
+    size_t start = 0, end = s.size();
+    while (start < end && isspace((unsigned char)s[start])) start++;
+    while (end > start && isspace((unsigned char)s[end - 1])) end--;
+    s = s.substr(start, end - start);
+}
+
+long String::toInt() const {
+    return strtol(s.c_str(), nullptr, 10);
+}
+
+float String::toFloat() const {
+    return strtof(s.c_str(), nullptr);
+}
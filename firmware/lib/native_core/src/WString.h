@@ -0,0 +1,113 @@
+/**
+ * WString.h - Arduino String on the host (env:native)
+ *
+ * Same interface as the Arduino core's String for the parts the
+ * firmware and its libraries use, backed by std::string.
+ */
+
+#ifndef WSTRING_H
+#define WSTRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+class StringSumHelper;
+
+class String {
+public:
+    String() {}
+    String(const char* s) : s(s ? s : "") {}
+    String(const String& other) : s(other.s) {}
+    explicit String(char c) : s(1, c) {}
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimals = 2);
+    explicit String(double value, unsigned int decimals = 2);
+
+    String& operator=(const String& other) { s = other.s; return *this; }
+    String& operator=(const char* other) { s = other ? other : ""; return *this; }
+
+    bool reserve(unsigned int size) { s.reserve(size); return true; }
+    unsigned int length() const { return s.size(); }
+    bool isEmpty() const { return s.empty(); }
+    const char* c_str() const { return s.c_str(); }
+
+    bool concat(const String& other) { s += other.s; return true; }
+    bool concat(const char* other) { if (!other) return false; s += other; return true; }
+    bool concat(const char* other, unsigned int length) { if (!other) return false; s.append(other, length); return true; }
+    bool concat(char c) { s += c; return true; }
+
+    String& operator+=(const String& other) { concat(other); return *this; }
+    String& operator+=(const char* other) { concat(other); return *this; }
+    String& operator+=(char c) { concat(c); return *this; }
+
+    friend StringSumHelper& operator+(const StringSumHelper& lhs, const String& rhs);
+    friend StringSumHelper& operator+(const StringSumHelper& lhs, const char* rhs);
+    friend StringSumHelper& operator+(const StringSumHelper& lhs, char c);
+
+    bool equals(const String& other) const { return s == other.s; }
+    bool equals(const char* other) const { return other && s == other; }
+    bool operator==(const String& other) const { return equals(other); }
+    bool operator==(const char* other) const { return equals(other); }
+    bool operator!=(const String& other) const { return !equals(other); }
+    bool operator!=(const char* other) const { return !equals(other); }
+    bool startsWith(const String& prefix) const { return s.compare(0, prefix.s.size(), prefix.s) == 0; }
+    bool endsWith(const String& suffix) const;
+
+    char charAt(unsigned int index) const { return index < s.size() ? s[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    int indexOf(char c, unsigned int from = 0) const;
+    int indexOf(const String& str, unsigned int from = 0) const;
+    int lastIndexOf(char c) const;
+    String substring(unsigned int from) const;
+    String substring(unsigned int from, unsigned int to) const;
+
+    void trim();
+    long toInt() const;
+    float toFloat() const;
+
+private:
+    std::string s;
+};
+
+/**
+ * Result of '+' on Strings, as in the Arduino core, so chains like
+ * "a" + String(x) + "b" append to one temporary.
+ */
+class StringSumHelper : public String {
+public:
+    StringSumHelper(const String& s) : String(s) {}
+    StringSumHelper(const char* p) : String(p) {}
+    StringSumHelper(char c) : String(c) {}
+    StringSumHelper(int num) : String(num) {}
+    StringSumHelper(unsigned int num) : String(num) {}
+    StringSumHelper(long num) : String(num) {}
+    StringSumHelper(unsigned long num) : String(num) {}
+    StringSumHelper(float num) : String(num) {}
+    StringSumHelper(double num) : String(num) {}
+};
+
+inline StringSumHelper& operator+(const StringSumHelper& lhs, const String& rhs) {
+    StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+    a.concat(rhs);
+    return a;
+}
+
+inline StringSumHelper& operator+(const StringSumHelper& lhs, const char* rhs) {
+    StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+    a.concat(rhs);
+    return a;
+}
+
+inline StringSumHelper& operator+(const StringSumHelper& lhs, char c) {
+    StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+    a.concat(c);
+    return a;
+}
+
+#endif // WSTRING_H
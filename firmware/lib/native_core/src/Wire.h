@@ -0,0 +1,25 @@
+/**
+ * Wire.h - Arduino I2C on the host (env:native)
+ *
+ * There is no bus on the host; the sensor drivers are simulated
+ * (see SparkFun_SCD30_Arduino_Library.h and BH1750.h).
+ */
+
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <stdint.h>
+
+class TwoWire {
+public:
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) {
+        (void)sda; (void)scl; (void)frequency;
+        return true;
+    }
+    bool setClock(uint32_t frequency) { (void)frequency; return true; }
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
+
+#endif // WIRE_H
@@ -0,0 +1,20 @@
+/**
+ * esp_task_wdt.h - ESP-IDF task watchdog on the host (env:native)
+ *
+ * The host has no watchdog; the calls do nothing.
+ */
+
+#ifndef ESP_TASK_WDT_H
+#define ESP_TASK_WDT_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+
+typedef int esp_err_t;
+#define ESP_OK 0
+
+inline esp_err_t esp_task_wdt_init(uint32_t timeoutSec, bool panic) { (void)timeoutSec; (void)panic; return ESP_OK; }
+inline esp_err_t esp_task_wdt_add(TaskHandle_t task) { (void)task; return ESP_OK; }
+inline esp_err_t esp_task_wdt_reset() { return ESP_OK; }
+
+#endif // ESP_TASK_WDT_H
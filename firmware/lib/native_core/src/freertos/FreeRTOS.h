@@ -0,0 +1,34 @@
+/**
+ * FreeRTOS.h - FreeRTOS API on the host (env:native)
+ *
+ * Tasks are threads, queues and mutexes are built on std::mutex and
+ * std::condition_variable. One tick is one millisecond. Priorities
+ * and core affinity are accepted and ignored.
+ */
+
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+struct NativeTask;
+struct NativeQueue;
+typedef NativeTask* TaskHandle_t;
+typedef NativeQueue* QueueHandle_t;
+typedef NativeQueue* SemaphoreHandle_t;
+
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdPASS              pdTRUE
+#define pdFAIL              pdFALSE
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFFUL)
+#define configTICK_RATE_HZ  1000
+#define portTICK_PERIOD_MS  1
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+#define tskNO_AFFINITY      0x7FFFFFFF
+
+#endif // FREERTOS_H
@@ -0,0 +1,171 @@
+/**
+ * freertos.cpp - FreeRTOS API on the host (env:native)
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include <Arduino.h>
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct NativeTask {
+    TaskFunction_t code;
+    void* parameters;
+    const char* name;
+    uint32_t stackDepth;
+};
+
+struct NativeQueue {
+    std::mutex lock;
+    std::condition_variable changed;
+    std::vector<uint8_t> items;     // Ring of length * itemSize bytes
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+static thread_local NativeTask* currentTask = nullptr;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char* name, uint32_t stackDepth,
+                                   void* parameters, UBaseType_t priority,
+                                   TaskHandle_t* createdTask, BaseType_t coreId) {
+    (void)priority; (void)coreId;
+    NativeTask* task = new NativeTask{code, parameters, name, stackDepth};
+    std::thread([task]() {
+        currentTask = task;
+        task->code(task->parameters);
+    }).detach();
+    if (createdTask) *createdTask = task;
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char* name, uint32_t stackDepth,
+                       void* parameters, UBaseType_t priority, TaskHandle_t* createdTask) {
+    return xTaskCreatePinnedToCore(code, name, stackDepth, parameters, priority,
+                                   createdTask, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task && task != currentTask) return;
+    for (;;) std::this_thread::sleep_for(std::chrono::hours(1));
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+void vTaskDelayUntil(TickType_t* previousWakeTime, TickType_t increment) {
+    *previousWakeTime += increment;
+    int32_t wait = (int32_t)(*previousWakeTime - xTaskGetTickCount());
+    if (wait > 0) vTaskDelay(wait);
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)millis();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return currentTask;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    NativeTask* native = task ? task : currentTask;
+    return native ? native->stackDepth : 0;
+}
+
+/**
+ * Wait on the queue's condition until 'ready' holds or the ticks run
+ * out. Called with the lock held.
+ */
+template <typename Predicate>
+static bool waitFor(NativeQueue* q, std::unique_lock<std::mutex>& held,
+                    TickType_t ticksToWait, Predicate ready) {
+    if (ticksToWait == portMAX_DELAY) {
+        q->changed.wait(held, ready);
+        return true;
+    }
+    return q->changed.wait_for(held, std::chrono::milliseconds(ticksToWait), ready);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    if (length == 0) return nullptr;
+    NativeQueue* q = new NativeQueue();
+    q->items.resize((size_t)length * itemSize);
+    q->length = length;
+    q->itemSize = itemSize;
+    q->head = 0;
+    q->count = 0;
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t ticksToWait) {
+    std::unique_lock<std::mutex> held(q->lock);
+    if (!waitFor(q, held, ticksToWait, [q]() { return q->count < q->length; })) return pdFALSE;
+    UBaseType_t slot = (q->head + q->count) % q->length;
+    if (q->itemSize) memcpy(&q->items[(size_t)slot * q->itemSize], item, q->itemSize);
+    q->count++;
+    q->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t q, const void* item, TickType_t ticksToWait) {
+    return xQueueSend(q, item, ticksToWait);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t q, const void* item) {
+    std::unique_lock<std::mutex> held(q->lock);
+    if (q->count == q->length) {
+        q->head = (q->head + 1) % q->length;
+        q->count--;
+    }
+    UBaseType_t slot = (q->head + q->count) % q->length;
+    if (q->itemSize) memcpy(&q->items[(size_t)slot * q->itemSize], item, q->itemSize);
+    q->count++;
+    q->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void* buffer, TickType_t ticksToWait) {
+    std::unique_lock<std::mutex> held(q->lock);
+    if (!waitFor(q, held, ticksToWait, [q]() { return q->count > 0; })) return pdFALSE;
+    if (q->itemSize) memcpy(buffer, &q->items[(size_t)q->head * q->itemSize], q->itemSize);
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+    q->changed.notify_all();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+    std::lock_guard<std::mutex> held(q->lock);
+    return q->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q) {
+    std::lock_guard<std::mutex> held(q->lock);
+    return q->length - q->count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    SemaphoreHandle_t mutex = xQueueCreate(1, 0);
+    xQueueSend(mutex, nullptr, 0);
+    return mutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait) {
+    return xQueueReceive(semaphore, nullptr, ticksToWait);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    return xQueueSend(semaphore, nullptr, 0);
+}
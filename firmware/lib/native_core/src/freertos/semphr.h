@@ -0,0 +1,17 @@
+/**
+ * semphr.h - FreeRTOS mutexes on the host (env:native)
+ *
+ * As in FreeRTOS, a mutex is a queue of one empty item: taking it
+ * receives the item, giving it back sends it.
+ */
+
+#ifndef FREERTOS_SEMPHR_H
+#define FREERTOS_SEMPHR_H
+
+#include "queue.h"
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+
+#endif // FREERTOS_SEMPHR_H
@@ -0,0 +1,33 @@
+/**
+ * adc_filter.cpp - Robust filter for blocks of ADC samples
+ */
+
+#include "adc_filter.h"
+#include <algorithm>
+
+AdcFilterResult AdcFilter::apply(uint16_t* samples, size_t count) {
+    AdcFilterResult result = {0.0f, 0.0f, 0, 0};
+    if (count == 0) return result;
+
+    std::sort(samples, samples + count);
+    uint16_t median = samples[count / 2];
+
+    // Interquartile mean; keeps at least one sample for tiny blocks
+    size_t lo = count / 4;
+    size_t hi = count - count / 4;
+    uint32_t sum = 0;
+    for (size_t i = lo; i < hi; i++) sum += samples[i];
+
+    // Median absolute deviation, computed in place
+    for (size_t i = 0; i < count; i++) {
+        samples[i] = samples[i] > median ? samples[i] - median : median - samples[i];
+    }
+    std::nth_element(samples, samples + count / 2, samples + count);
+    uint16_t mad = samples[count / 2];
+
+    result.value = (float)sum / (hi - lo);
+    result.noise = 1.4826f * mad;
+    result.median = median;
+    result.count = count;
+    return result;
+}
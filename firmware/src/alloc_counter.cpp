@@ -0,0 +1,179 @@
+/**
+ * alloc_counter.cpp - Heap allocation counts
+ *
+ * The __wrap_ functions replace malloc, calloc and realloc for all
+ * code in the link; __real_ reaches the allocator. On the host the
+ * C++ runtime is a shared library the wrap does not reach, so
+ * operator new is counted here too.
+ *
+ * Any task (and the WiFi stack) may allocate at any time, so the
+ * counters and the trace table are lock-free atomics, and nothing
+ * here allocates.
+ */
+
+#include "alloc_counter.h"
+#include "config.h"
+#include <atomic>
+#include <new>
+
+#ifdef ALLOC_COUNTER
+
+static std::atomic<unsigned long> allocations(0);
+static std::atomic<unsigned long> allocatedBytes(0);
+
+#ifdef ALLOC_TRACE
+struct TraceEntry {
+    std::atomic<uintptr_t> address;
+    std::atomic<unsigned long> count;
+    std::atomic<unsigned long> bytes;
+};
+
+// Open addressing on the call site; a slot is claimed once and kept
+static TraceEntry traceTable[ALLOC_TRACE_SITES];
+static TraceEntry traceOverflow;
+
+static void trace(size_t size, void* site) {
+    uintptr_t address = (uintptr_t)site;
+    unsigned int start = (address >> 2) % ALLOC_TRACE_SITES;
+
+    for (unsigned int i = 0; i < ALLOC_TRACE_SITES; i++) {
+        TraceEntry& entry = traceTable[(start + i) % ALLOC_TRACE_SITES];
+        uintptr_t current = entry.address.load(std::memory_order_relaxed);
+        if (current == 0 && entry.address.compare_exchange_strong(current, address)) {
+            current = address;
+        }
+        if (current == address) {
+            entry.count++;
+            entry.bytes += size;
+            return;
+        }
+    }
+    traceOverflow.count++;
+    traceOverflow.bytes += size;
+}
+#endif
+
+static inline void countAllocation(size_t size, void* site) {
+    allocations++;
+    allocatedBytes += size;
+#ifdef ALLOC_TRACE
+    trace(size, site);
+#else
+    (void)site;
+#endif
+}
+
+extern "C" {
+    void* __real_malloc(size_t size);
+    void* __real_calloc(size_t count, size_t size);
+    void* __real_realloc(void* ptr, size_t size);
+
+    void* __wrap_malloc(size_t size) {
+        countAllocation(size, __builtin_return_address(0));
+        return __real_malloc(size);
+    }
+
+    void* __wrap_calloc(size_t count, size_t size) {
+        countAllocation(count * size, __builtin_return_address(0));
+        return __real_calloc(count, size);
+    }
+
+    void* __wrap_realloc(void* ptr, size_t size) {
+        countAllocation(size, __builtin_return_address(0));
+        return __real_realloc(ptr, size);
+    }
+}
+
+#ifdef NATIVE
+void* operator new(size_t size) {
+    countAllocation(size, __builtin_return_address(0));
+    void* p = __real_malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    countAllocation(size, __builtin_return_address(0));
+    void* p = __real_malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+#endif
+
+bool AllocCounter::enabled() {
+    return true;
+}
+
+unsigned long AllocCounter::count() {
+    return allocations;
+}
+
+unsigned long AllocCounter::bytes() {
+    return allocatedBytes;
+}
+
+#else
+
+bool AllocCounter::enabled() {
+    return false;
+}
+
+unsigned long AllocCounter::count() {
+    return 0;
+}
+
+unsigned long AllocCounter::bytes() {
+    return 0;
+}
+
+#endif
+
+#if defined(ALLOC_COUNTER) && defined(ALLOC_TRACE)
+
+bool AllocCounter::tracing() {
+    return true;
+}
+
+unsigned int AllocCounter::topSites(AllocSite* sites, unsigned int maxSites) {
+    unsigned int found = 0;
+
+    // Insertion into the sorted output; the table is small
+    for (unsigned int i = 0; i <= ALLOC_TRACE_SITES; i++) {
+        TraceEntry& entry = i < ALLOC_TRACE_SITES ? traceTable[i] : traceOverflow;
+        AllocSite site;
+        site.address = i < ALLOC_TRACE_SITES ? entry.address.load() : 0;
+        site.count = entry.count;
+        site.bytes = entry.bytes;
+        if (site.count == 0) continue;
+
+        unsigned int pos = found;
+        while (pos > 0 && sites[pos - 1].bytes < site.bytes) {
+            if (pos < maxSites) sites[pos] = sites[pos - 1];
+            pos--;
+        }
+        if (pos < maxSites) {
+            sites[pos] = site;
+            if (found < maxSites) found++;
+        }
+    }
+    return found;
+}
+
+#else
+
+bool AllocCounter::tracing() {
+    return false;
+}
+
+unsigned int AllocCounter::topSites(AllocSite* sites, unsigned int maxSites) {
+    (void)sites;
+    (void)maxSites;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,540 @@
+/**
+ * archive.cpp - Compressed daily archive of all readings
+ *
+ * Sealing a block appends header + packed data to the day file, then
+ * removes open.rec. If a reset hits between the two, the reloaded
+ * block encodes to the same CRC as the last block in the day file and
+ * is not written twice. A block torn by a power loss fails its CRC
+ * and is skipped: the index points past it (tools/records.py
+ * searches for the next block magic instead).
+ *
+ * <day>.idx holds one 16-byte entry per block, written after the
+ * block. A query reads the index sequentially and seeks only to
+ * blocks that overlap the range. Blocks past the last intact index
+ * entry (lost to a reset) are found by hopping from header to header.
+ *
+ * A day file that would grow past SD_MAX_FILE_SIZE continues in
+ * YYYY-MM-DD.1.arc, .2.arc, ... (each with its own index).
+ *
+ * archive.meta keeps the archive's total size and its oldest day, so
+ * retention never needs a directory walk. It is rebuilt from one walk
+ * only if it is missing or damaged.
+ */
+
+#include "archive.h"
+#include "archive_codec.h"
+#include "config.h"
+#include "checksum.h"
+
+#define META_MAGIC  0x4D435241UL    // "ARCM"
+
+struct IndexEntry {
+    uint32_t firstEpoch;
+    uint32_t lastEpoch;
+    uint32_t offset;            // Of the block header in the day file
+    uint32_t crc;               // CRC32 of the fields above
+};
+
+struct ArchiveMeta {
+    uint32_t magic;
+    uint32_t oldestDay;         // Local midnight of the oldest dated day file (0: none)
+    uint32_t bytes;             // Size of all day and index files
+    uint32_t crc;               // CRC32 of the fields above
+};
+
+/**
+ * A running query.
+ */
+struct Query {
+    uint32_t start;
+    uint32_t end;
+    bool (*callback)(const ReadingRecord& record);
+    unsigned int maxCount;
+    unsigned int count;
+    bool done;
+};
+
+static fs::FS* archiveFs = nullptr;
+static char archiveDir[SD_DIR_MAX] = "";
+static SDPath openFile;                 // <dir>/open.rec
+static SDPath openDay;                  // Day file of the open block
+static unsigned int openPart = 0;       // Part of that day being written
+static SDPath metaFile;                 // <dir>/archive.meta
+static time_t oldestDay = 0;
+static uint32_t archiveBytes = 0;
+static unsigned long written = 0;       // Bytes written since boot
+
+static ReadingRecord openRecords[ARCHIVE_BLOCK_RECORDS];
+static unsigned int openRecordCount = 0;
+static bool openReloaded = false;       // Open block came from open.rec; may already be sealed
+static uint8_t packed[ARCHIVE_MAX_BYTES(ARCHIVE_BLOCK_RECORDS)];
+static ReadingRecord blockRecords[ARCHIVE_BLOCK_RECORDS];     // Decoded by queries
+
+static SDPath dirPath(const char* name) {
+    SDPath p;
+    p.format("%s/%s", archiveDir, name);
+    return p;
+}
+
+static SDPath dayPathFor(time_t t) {
+    struct tm timeinfo;
+    localtime_r(&t, &timeinfo);
+    SDPath p;
+    p.format("%s/%04d-%02d-%02d.arc", archiveDir,
+             timeinfo.tm_year + 1900,
+             timeinfo.tm_mon + 1,
+             timeinfo.tm_mday);
+    return p;
+}
+
+static SDPath unknownPath() {
+    return dirPath("unknown.arc");
+}
+
+SDPath Archive::dayPath(const ReadingRecord& record) {
+    if (!(record.flags & RECORD_FLAG_TIME)) return unknownPath();
+    return dayPathFor(record.epoch);
+}
+
+/**
+ * Length of 'path' without its ".arc".
+ */
+static int stemLength(const SDPath& path) {
+    int length = (int)strlen(path.path) - 4;
+    return length > 0 ? length : 0;
+}
+
+static SDPath indexPath(const SDPath& day) {
+    SDPath p;
+    p.format("%.*s.idx", stemLength(day), day.path);
+    return p;
+}
+
+/**
+ * File for part 'part' of a day: 2026-03-15.arc, 2026-03-15.1.arc, ...
+ */
+static SDPath partPath(const SDPath& day, unsigned int part) {
+    if (part == 0) return day;
+    SDPath p;
+    p.format("%.*s.%u.arc", stemLength(day), day.path, part);
+    return p;
+}
+
+static unsigned int lastPart(const SDPath& day) {
+    unsigned int part = 0;
+    while (archiveFs->exists(partPath(day, part + 1).c_str())) part++;
+    return part;
+}
+
+/**
+ * Local midnight of the day after 't'.
+ */
+static time_t nextDay(time_t t) {
+    struct tm timeinfo;
+    localtime_r(&t, &timeinfo);
+    timeinfo.tm_mday++;
+    timeinfo.tm_hour = timeinfo.tm_min = timeinfo.tm_sec = 0;
+    timeinfo.tm_isdst = -1;
+    return mktime(&timeinfo);
+}
+
+static time_t midnight(time_t t) {
+    struct tm timeinfo;
+    localtime_r(&t, &timeinfo);
+    timeinfo.tm_hour = timeinfo.tm_min = timeinfo.tm_sec = 0;
+    timeinfo.tm_isdst = -1;
+    return mktime(&timeinfo);
+}
+
+static void saveMeta() {
+    ArchiveMeta meta;
+    meta.magic = META_MAGIC;
+    meta.oldestDay = oldestDay;
+    meta.bytes = archiveBytes;
+    meta.crc = Checksum::crc32(&meta, offsetof(ArchiveMeta, crc));
+
+    File f = archiveFs->open(metaFile.c_str(), FILE_WRITE);
+    if (!f) return;
+    written += f.write((const uint8_t*)&meta, sizeof(meta));
+    f.close();
+}
+
+static bool loadMeta() {
+    File f = archiveFs->open(metaFile.c_str(), FILE_READ);
+    if (!f) return false;
+    ArchiveMeta meta;
+    size_t n = f.read((uint8_t*)&meta, sizeof(meta));
+    f.close();
+
+    if (n != sizeof(meta) || meta.magic != META_MAGIC) return false;
+    if (meta.crc != Checksum::crc32(&meta, offsetof(ArchiveMeta, crc))) return false;
+    oldestDay = meta.oldestDay;
+    archiveBytes = meta.bytes;
+    return true;
+}
+
+/**
+ * Recount size and oldest day from the files present. One directory
+ * walk; only when archive.meta is unusable.
+ */
+static void rebuildMeta() {
+    oldestDay = 0;
+    archiveBytes = 0;
+
+    File dir = archiveFs->open(archiveDir);
+    if (dir) {
+        File entry = dir.openNextFile();
+        while (entry) {
+            const char* name = strrchr(entry.name(), '/');
+            name = name ? name + 1 : entry.name();
+            if (strstr(name, ".arc") || strstr(name, ".idx")) {
+                archiveBytes += entry.size();
+                struct tm timeinfo = {};
+                if (sscanf(name, "%4d-%2d-%2d", &timeinfo.tm_year, &timeinfo.tm_mon, &timeinfo.tm_mday) == 3) {
+                    timeinfo.tm_year -= 1900;
+                    timeinfo.tm_mon -= 1;
+                    timeinfo.tm_isdst = -1;
+                    time_t day = mktime(&timeinfo);
+                    if (day > 0 && (oldestDay == 0 || day < oldestDay)) oldestDay = day;
+                }
+            }
+            entry.close();
+            entry = dir.openNextFile();
+        }
+        dir.close();
+    }
+    Serial.printf("[Archive] Rebuilt metadata (%lu bytes)\n", (unsigned long)archiveBytes);
+    saveMeta();
+}
+
+static bool overlaps(uint32_t first, uint32_t last, const Query& q) {
+    return last >= q.start && first <= q.end;
+}
+
+/**
+ * Read the block header at 'offset', leaving the file positioned at
+ * the block data. False unless an intact header and its data fit.
+ */
+static bool readHeader(File& f, size_t offset, size_t size, ArchiveBlockHeader& header) {
+    if (offset + sizeof(header) > size || !f.seek(offset)) return false;
+    if (f.read((uint8_t*)&header, sizeof(header)) != sizeof(header)) return false;
+    return ArchiveCodec::isHeader(header) && offset + sizeof(header) + header.length <= size;
+}
+
+/**
+ * CRC of the last intact block in 'path' (0 if none). Hops from
+ * header to header; a day holds only a few dozen blocks.
+ */
+static uint32_t lastBlockCRC(const SDPath& path) {
+    File f = archiveFs->open(path.c_str(), FILE_READ);
+    if (!f) return 0;
+
+    uint32_t crc = 0;
+    size_t size = f.size();
+    size_t offset = 0;
+    ArchiveBlockHeader header;
+    while (readHeader(f, offset, size, header)) {
+        offset += sizeof(header) + header.length;
+        crc = header.crc;
+    }
+    f.close();
+    return crc;
+}
+
+static void writeIndex(const SDPath& path, const ArchiveBlockHeader& header, uint32_t offset) {
+    IndexEntry entry;
+    entry.firstEpoch = header.firstEpoch;
+    entry.lastEpoch = header.lastEpoch;
+    entry.offset = offset;
+    entry.crc = Checksum::crc32(&entry, offsetof(IndexEntry, crc));
+
+    File f = archiveFs->open(indexPath(path).c_str(), FILE_APPEND);
+    if (!f) return;
+    size_t n = f.write((const uint8_t*)&entry, sizeof(entry));
+    f.close();
+    archiveBytes += n;
+    written += n;
+}
+
+/**
+ * Compress the open block into its day file and start a new one.
+ * With 'recovered' set, skip the write if the day file already ends
+ * with this block.
+ */
+static bool sealBlock(bool recovered = false) {
+    if (openRecordCount == 0) return true;
+
+    ArchiveBlockHeader header;
+    size_t length = ArchiveCodec::encode(openRecords, openRecordCount,
+                                         packed, sizeof(packed), header);
+    if (length == 0) return false;
+
+    SDPath path = partPath(openDay, openPart);
+    if (!recovered || lastBlockCRC(path) != header.crc) {
+        File f = archiveFs->open(path.c_str(), FILE_APPEND);
+        uint32_t offset = f ? f.size() : 0;
+
+        // Continue in the next part at the size cap
+        if (f && offset > 0 && offset + sizeof(header) + length > SD_MAX_FILE_SIZE) {
+            f.close();
+            path = partPath(openDay, ++openPart);
+            f = archiveFs->open(path.c_str(), FILE_APPEND);
+            offset = f ? f.size() : 0;
+        }
+        if (!f) {
+            Serial.printf("[Archive] Cannot open %s\n", path.c_str());
+            return false;
+        }
+        size_t n = f.write((const uint8_t*)&header, sizeof(header));
+        n += f.write(packed, length);
+        f.close();
+        archiveBytes += n;
+        written += n;
+        if (n != sizeof(header) + length) {
+            Serial.println("[Archive] Block write failed");
+            return false;
+        }
+        writeIndex(path, header, offset);
+
+        if (oldestDay == 0 && (openRecords[0].flags & RECORD_FLAG_TIME)) {
+            oldestDay = midnight(openRecords[0].epoch);
+        }
+        saveMeta();
+    }
+
+    Serial.printf("[Archive] Sealed %u readings into %u bytes (%s)\n",
+                  openRecordCount, (unsigned)(sizeof(header) + length), path.c_str());
+    archiveFs->remove(openFile.c_str());
+    openRecordCount = 0;
+    openReloaded = false;
+    return true;
+}
+
+/**
+ * Reload the open block left by the previous session.
+ */
+static void loadOpenBlock() {
+    File f = archiveFs->open(openFile.c_str(), FILE_READ);
+    if (!f) return;
+
+    ReadingRecord record;
+    while (openRecordCount < ARCHIVE_BLOCK_RECORDS &&
+           f.read((uint8_t*)&record, sizeof(record)) == sizeof(record)) {
+        if (RecordCodec::isValid(record)) openRecords[openRecordCount++] = record;
+    }
+    f.close();
+    if (openRecordCount == 0) return;
+
+    openDay = Archive::dayPath(openRecords[0]);
+    openPart = lastPart(openDay);
+    openReloaded = true;
+    Serial.printf("[Archive] Reloaded %u readings of the open block\n", openRecordCount);
+
+    if (openRecordCount == ARCHIVE_BLOCK_RECORDS) sealBlock(true);
+}
+
+bool Archive::begin(fs::FS& fs, const char* dir) {
+    if (strlen(dir) >= sizeof(archiveDir)) {
+        Serial.printf("[Archive] Directory name too long: %s\n", dir);
+        archiveFs = nullptr;
+        return false;
+    }
+    archiveFs = &fs;
+    strcpy(archiveDir, dir);
+    openFile = dirPath("open.rec");
+    metaFile = dirPath("archive.meta");
+    openRecordCount = 0;
+    openReloaded = false;
+
+    if (!loadMeta()) rebuildMeta();
+    loadOpenBlock();
+    return true;
+}
+
+bool Archive::append(const ReadingRecord& record) {
+    if (!archiveFs) return false;
+
+    SDPath day = dayPath(record);
+    // Only a reloaded block needs the check for an earlier seal
+    if (openRecordCount > 0 && day != openDay && !sealBlock(openReloaded)) return false;
+    if (openRecordCount == ARCHIVE_BLOCK_RECORDS && !sealBlock(openReloaded)) return false;
+
+    File f = archiveFs->open(openFile.c_str(), FILE_APPEND);
+    if (!f) return false;
+    size_t n = f.write((const uint8_t*)&record, sizeof(record));
+    f.close();
+    written += n;
+    if (n != sizeof(record)) return false;
+
+    if (day != openDay) {
+        openDay = day;
+        openPart = lastPart(day);
+    }
+    openRecords[openRecordCount++] = record;
+
+    if (openRecordCount == ARCHIVE_BLOCK_RECORDS) sealBlock();
+    return true;
+}
+
+/**
+ * Pass the readings in range to the query callback.
+ */
+static void deliver(const ReadingRecord* records, unsigned int count, Query& q) {
+    for (unsigned int i = 0; i < count && !q.done; i++) {
+        const ReadingRecord& r = records[i];
+        if (!(r.flags & RECORD_FLAG_TIME) || r.epoch < q.start || r.epoch > q.end) continue;
+        if (q.count >= q.maxCount || !q.callback(r)) {
+            q.done = true;
+            return;
+        }
+        q.count++;
+    }
+}
+
+/**
+ * Decode the block whose header was just read from 'f'.
+ */
+static void deliverBlock(File& f, const ArchiveBlockHeader& header, Query& q) {
+    if (header.length > sizeof(packed)) return;
+    if (f.read(packed, header.length) != header.length) return;
+    uint16_t count = ArchiveCodec::decode(header, packed, blockRecords, ARCHIVE_BLOCK_RECORDS);
+    deliver(blockRecords, count, q);
+}
+
+/**
+ * Query one day file (one part). Returns false if it does not exist.
+ */
+static bool queryFile(const SDPath& path, Query& q) {
+    File f = archiveFs->open(path.c_str(), FILE_READ);
+    if (!f) return false;
+    size_t size = f.size();
+    size_t next = 0;                    // End of the last block visited
+    ArchiveBlockHeader header;
+
+    File idx = archiveFs->open(indexPath(path).c_str(), FILE_READ);
+    if (idx) {
+        IndexEntry entry;
+        bool indexed = false;
+        uint32_t last = 0;
+        while (!q.done && idx.read((uint8_t*)&entry, sizeof(entry)) == sizeof(entry)) {
+            if (entry.crc != Checksum::crc32(&entry, offsetof(IndexEntry, crc))) break;
+            if (indexed && entry.offset <= last) break;
+            indexed = true;
+            last = entry.offset;
+            if (!overlaps(entry.firstEpoch, entry.lastEpoch, q)) continue;
+
+            if (readHeader(f, entry.offset, size, header) && header.firstEpoch == entry.firstEpoch) {
+                deliverBlock(f, header, q);
+                next = entry.offset + sizeof(header) + header.length;
+            }
+        }
+        idx.close();
+
+        // Blocks after the last indexed one are found by hopping
+        if (indexed && last >= next && readHeader(f, last, size, header)) {
+            next = last + sizeof(header) + header.length;
+        }
+    }
+
+    while (!q.done && readHeader(f, next, size, header)) {
+        size_t blockEnd = next + sizeof(header) + header.length;
+        if (overlaps(header.firstEpoch, header.lastEpoch, q)) deliverBlock(f, header, q);
+        next = blockEnd;
+    }
+    f.close();
+    return true;
+}
+
+unsigned int Archive::query(uint32_t start, uint32_t end,
+                            bool (*callback)(const ReadingRecord& record),
+                            unsigned int maxCount) {
+    Query q = { start, end, callback, maxCount, 0, false };
+    if (!archiveFs || start > end) return 0;
+
+    // One day file (and its parts) per local date in the range
+    time_t day = start;
+    while (!q.done) {
+        SDPath path = dayPathFor(day);
+        for (unsigned int part = 0; !q.done && queryFile(partPath(path, part), q); part++) {
+        }
+
+        day = nextDay(day);
+        if (day <= 0 || (uint64_t)day > end) break;
+    }
+
+    // Newest readings, not yet sealed
+    deliver(openRecords, openRecordCount, q);
+    return q.count;
+}
+
+/**
+ * Delete every part of a day and its indexes.
+ * Returns true if anything was deleted.
+ */
+static bool removeDay(const SDPath& day) {
+    bool removed = false;
+    for (unsigned int part = 0; ; part++) {
+        SDPath path = partPath(day, part);
+        File f = archiveFs->open(path.c_str(), FILE_READ);
+        if (!f) break;
+        uint32_t size = f.size();
+        f.close();
+
+        SDPath idx = indexPath(path);
+        File fi = archiveFs->open(idx.c_str(), FILE_READ);
+        if (fi) {
+            size += fi.size();
+            fi.close();
+            archiveFs->remove(idx.c_str());
+        }
+        archiveFs->remove(path.c_str());
+        archiveBytes -= min(size, archiveBytes);
+        removed = true;
+    }
+    return removed;
+}
+
+bool Archive::removeOldestDay() {
+    if (!archiveFs) return false;
+
+    // Undated readings go first: no query or replay can reach them
+    SDPath unknown = unknownPath();
+    if (unknown != openDay && removeDay(unknown)) {
+        Serial.printf("[Archive] Deleted undated readings (archive now %lu KB)\n",
+                      (unsigned long)(archiveBytes / 1024));
+        saveMeta();
+        return true;
+    }
+    if (oldestDay == 0) return false;
+
+    // Bounded per call; a long gap is crossed over several calls
+    time_t now = time(nullptr);
+    for (int probe = 0; probe < 31; probe++) {
+        SDPath day = dayPathFor(oldestDay);
+        // Never the day being written or today
+        if (day == openDay || nextDay(oldestDay) > now) break;
+
+        bool removed = removeDay(day);
+        oldestDay = nextDay(oldestDay);
+        if (removed) {
+            Serial.printf("[Archive] Deleted %s (archive now %lu KB)\n",
+                          day.c_str(), (unsigned long)(archiveBytes / 1024));
+            saveMeta();
+            return true;
+        }
+    }
+    saveMeta();
+    return false;
+}
+
+unsigned long Archive::bytes() {
+    return archiveBytes;
+}
+
+unsigned int Archive::openCount() {
+    return openRecordCount;
+}
+
+unsigned long Archive::bytesWritten() {
+    return written;
+}
@@ -0,0 +1,180 @@
+/**
+ * archive_codec.cpp - Compressed blocks of reading records
+ *
+ * Columns are packed one after another: all epochs, then all reading
+ * numbers, and so on. All arithmetic is modulo 2^32, so any field
+ * value round-trips; signed fields are sign-extended first.
+ */
+
+#include "archive_codec.h"
+#include "checksum.h"
+#include <string.h>
+
+enum Column {
+    COL_EPOCH, COL_READING, COL_BOOT, COL_FLAGS,
+    COL_CO2, COL_TEMPERATURE, COL_HUMIDITY, COL_LIGHT,
+    COL_SOIL_MOISTURE, COL_SOIL_RAW
+};
+
+static_assert(COL_SOIL_RAW + 1 == ARCHIVE_COLUMNS, "Column list and ARCHIVE_COLUMNS differ");
+
+// Columns stored as delta-of-delta (regularly spaced); the rest as delta
+static bool isDoubleDelta(int column) {
+    return column == COL_EPOCH || column == COL_READING;
+}
+
+static uint32_t getField(const ReadingRecord& r, int column) {
+    switch (column) {
+        case COL_EPOCH:         return r.epoch;
+        case COL_READING:       return r.reading;
+        case COL_BOOT:          return r.boot;
+        case COL_FLAGS:         return r.flags;
+        case COL_CO2:           return r.co2;
+        case COL_TEMPERATURE:   return (uint32_t)(int32_t)r.temperature;
+        case COL_HUMIDITY:      return r.humidity;
+        case COL_LIGHT:         return r.light;
+        case COL_SOIL_MOISTURE: return (uint32_t)(int32_t)r.soilMoisture;
+        default:                return r.soilRaw;
+    }
+}
+
+static void setField(ReadingRecord& r, int column, uint32_t v) {
+    switch (column) {
+        case COL_EPOCH:         r.epoch = v; break;
+        case COL_READING:       r.reading = v; break;
+        case COL_BOOT:          r.boot = v; break;
+        case COL_FLAGS:         r.flags = v; break;
+        case COL_CO2:           r.co2 = v; break;
+        case COL_TEMPERATURE:   r.temperature = (int16_t)v; break;
+        case COL_HUMIDITY:      r.humidity = v; break;
+        case COL_LIGHT:         r.light = v; break;
+        case COL_SOIL_MOISTURE: r.soilMoisture = (int16_t)v; break;
+        default:                r.soilRaw = v; break;
+    }
+}
+
+/**
+ * MSB-first bit writer over a fixed buffer.
+ */
+struct BitWriter {
+    uint8_t* out;
+    size_t capacity;
+    size_t bits;
+
+    bool put(uint32_t value, int width) {
+        if (bits + width > capacity * 8) return false;
+        for (int i = width - 1; i >= 0; i--) {
+            size_t byte = bits >> 3;
+            if ((bits & 7) == 0) out[byte] = 0;
+            if ((value >> i) & 1) out[byte] |= 0x80 >> (bits & 7);
+            bits++;
+        }
+        return true;
+    }
+};
+
+struct BitReader {
+    const uint8_t* data;
+    size_t length;
+    size_t bits;
+
+    // Reads past the end return zero bits; the CRC has been checked
+    uint32_t get(int width) {
+        uint32_t value = 0;
+        for (int i = 0; i < width; i++) {
+            size_t byte = bits >> 3;
+            uint32_t bit = byte < length ? (data[byte] >> (7 - (bits & 7))) & 1 : 0;
+            value = (value << 1) | bit;
+            bits++;
+        }
+        return value;
+    }
+};
+
+static bool putDelta(BitWriter& w, uint32_t delta) {
+    int32_t d = (int32_t)delta;
+    if (d == 0)                   return w.put(0x0, 1);
+    if (d >= -64 && d <= 63)      return w.put(0x2, 2) && w.put(delta & 0x7F, 7);
+    if (d >= -256 && d <= 255)    return w.put(0x6, 3) && w.put(delta & 0x1FF, 9);
+    if (d >= -2048 && d <= 2047)  return w.put(0xE, 4) && w.put(delta & 0xFFF, 12);
+    return w.put(0xF, 4) && w.put(delta, 32);
+}
+
+static uint32_t signExtend(uint32_t value, int width) {
+    uint32_t sign = 1UL << (width - 1);
+    return (value ^ sign) - sign;
+}
+
+static uint32_t getDelta(BitReader& r) {
+    if (r.get(1) == 0) return 0;
+    if (r.get(1) == 0) return signExtend(r.get(7), 7);
+    if (r.get(1) == 0) return signExtend(r.get(9), 9);
+    if (r.get(1) == 0) return signExtend(r.get(12), 12);
+    return r.get(32);
+}
+
+static uint32_t blockCRC(const ArchiveBlockHeader& header, const uint8_t* data) {
+    uint32_t crc = Checksum::crc32(&header, offsetof(ArchiveBlockHeader, crc));
+    return Checksum::crc32(data, header.length, crc);
+}
+
+size_t ArchiveCodec::encode(const ReadingRecord* records, uint16_t count,
+                            uint8_t* out, size_t capacity, ArchiveBlockHeader& header) {
+    if (count == 0) return 0;
+    BitWriter w = { out, capacity, 0 };
+
+    for (int column = 0; column < ARCHIVE_COLUMNS; column++) {
+        uint32_t prev = 0, prevDelta = 0;
+        for (uint16_t i = 0; i < count; i++) {
+            uint32_t value = getField(records[i], column);
+            uint32_t delta = value - prev;
+            bool ok = isDoubleDelta(column) ? putDelta(w, delta - prevDelta) : putDelta(w, delta);
+            if (!ok) return 0;
+            prev = value;
+            prevDelta = delta;
+        }
+    }
+
+    size_t length = (w.bits + 7) / 8;
+    if (length > UINT16_MAX) return 0;
+
+    header.magic = ARCHIVE_BLOCK_MAGIC;
+    header.count = count;
+    header.length = length;
+    header.firstEpoch = records[0].epoch;
+    header.lastEpoch = records[count - 1].epoch;
+    header.crc = blockCRC(header, out);
+    return length;
+}
+
+bool ArchiveCodec::isHeader(const ArchiveBlockHeader& header) {
+    return header.magic == ARCHIVE_BLOCK_MAGIC && header.count > 0 &&
+           header.length <= ARCHIVE_MAX_BYTES((size_t)header.count);
+}
+
+uint16_t ArchiveCodec::decode(const ArchiveBlockHeader& header, const uint8_t* data,
+                              ReadingRecord* records, uint16_t maxCount) {
+    if (!isHeader(header) || header.count > maxCount) return 0;
+    if (blockCRC(header, data) != header.crc) return 0;
+
+    uint16_t count = header.count;
+    memset(records, 0, count * sizeof(ReadingRecord));
+    BitReader r = { data, header.length, 0 };
+
+    for (int column = 0; column < ARCHIVE_COLUMNS; column++) {
+        uint32_t prev = 0, prevDelta = 0;
+        for (uint16_t i = 0; i < count; i++) {
+            uint32_t delta = getDelta(r);
+            if (isDoubleDelta(column)) delta += prevDelta;
+            prev += delta;
+            prevDelta = delta;
+            setField(records[i], column, prev);
+        }
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        records[i].version = RECORD_VERSION;
+        RecordCodec::seal(records[i]);
+    }
+    return count;
+}
@@ -0,0 +1,632 @@
+/**
+ * bench.cpp - Benchmarks of the data path
+ *
+ * Every case times one operation per sample with micros(), outside
+ * of any setup it needs; the SD cases undo each operation afterwards
+ * (untimed) so the backlog stays at its level. Samples, payloads and
+ * the result JSON live in static buffers, so the benchmark itself
+ * adds no heap allocations to the counts.
+ */
+
+#include "bench.h"
+#include "config.h"
+#include "alloc_counter.h"
+#include "buffer_pool.h"
+#include "hal.h"
+#include "mqtt_manager.h"
+#include "outbox.h"
+#include "payload.h"
+#include "reading_record.h"
+#include "sd_manager.h"
+#include "sd_path.h"
+#include "sensor_channels.h"
+#include "sensor_manager.h"
+#include "time_manager.h"
+#include "wifi_manager.h"
+#include <algorithm>
+#include <limits.h>
+#include <time.h>
+
+#define BENCH_BASE_EPOCH   1767225600UL        // 2026-01-01, first synthetic reading
+#define BENCH_RESULT_BYTES 8192
+#define BENCH_CONVERT_REPEAT 100        // Channels::convert() calls per convert_channels sample
+
+static const unsigned long backlogs[] = BENCH_BACKLOGS;
+
+static unsigned long samples[BENCH_SAMPLES];
+static unsigned int sampleCount = 0;
+static unsigned long allocTotal = 0;
+static unsigned long long byteTotal = 0;
+
+// Operation being timed
+static unsigned long opStart = 0;
+static unsigned long opAllocs = 0;
+static unsigned long opBytes = 0;
+
+static char results[BENCH_RESULT_BYTES];
+static size_t resultLength = 0;
+static unsigned int caseCount = 0;
+static double caseRate = -1;       // Readings per second, < 0: not measured
+
+static uint32_t windowStart = 0;    // Range of the query cases
+static uint32_t windowEnd = 0;
+static unsigned int queryMatches = 0;
+
+static char payload[MQTT_BUFFER_SIZE];
+static char batch[MQTT_BATCH_BYTES];
+static uint32_t readingNumber = 0;
+static volatile uint16_t lastAck = 0;
+
+/**
+ * Next synthetic reading: all sensors valid, one minute after the
+ * previous one, values varying a little.
+ */
+static ReadingRecord nextRecord() {
+    readingNumber++;
+
+    SensorData data = {};
+    data.co2 = 450.0f + (readingNumber % 50);
+    data.temperature = 21.5f + (readingNumber % 20) * 0.05f;
+    data.humidity = 60.0f + (readingNumber % 30) * 0.1f;
+    data.light = 12000.0f + (readingNumber % 100) * 10.0f;
+    data.soilMoisture = 42.0f + (readingNumber % 10) * 0.1f;
+    data.soilRaw = 2150 + readingNumber % 16;
+    data.scd30Valid = true;
+    data.bh1750Valid = true;
+    data.soilValid = true;
+
+    return RecordCodec::encode(data, BENCH_BASE_EPOCH + readingNumber * 60,
+                               RECORD_FLAG_TIME, 1, readingNumber);
+}
+
+/**
+ * flushBuffer() callback: format the payload as the network task
+ * would, without sending it.
+ */
+static bool formatReading(const ReadingRecord& record) {
+    return Payload::writeReading(payload, sizeof(payload), record) > 0;
+}
+
+static void onAck(uint16_t packetId) {
+    lastAck = packetId;
+    Outbox::onAck(packetId);
+}
+
+/**
+ * Wait for the PUBACK of 'packetId'.
+ * Returns false after MQTT_ACK_TIMEOUT.
+ */
+static bool waitForAck(uint16_t packetId) {
+    unsigned long start = millis();
+    while (lastAck != packetId) {
+        if (millis() - start >= MQTT_ACK_TIMEOUT) return false;
+        MQTTManager::maintain();
+    }
+    return true;
+}
+
+static void beginCase() {
+    sampleCount = 0;
+    allocTotal = 0;
+    byteTotal = 0;
+    caseRate = -1;
+}
+
+static void beginOp() {
+    opAllocs = AllocCounter::count();
+    opBytes = SDManager::getBytesWritten();
+    opStart = micros();
+}
+
+/**
+ * 'extraBytes': bytes produced other than SD writes (payloads).
+ */
+static void endOp(size_t extraBytes = 0) {
+    unsigned long elapsed = micros() - opStart;
+    allocTotal += AllocCounter::count() - opAllocs;
+    byteTotal += SDManager::getBytesWritten() - opBytes + extraBytes;
+    if (sampleCount < BENCH_SAMPLES) samples[sampleCount++] = elapsed;
+}
+
+/**
+ * Nearest-rank percentile of the sorted samples.
+ */
+static unsigned long percentile(unsigned int p) {
+    return samples[(sampleCount - 1) * p / 100];
+}
+
+/**
+ * Add the case's statistics to the results and print them.
+ * 'backlog' < 0: the case does not depend on the buffer.
+ */
+static void endCase(const char* name, long backlog) {
+    if (sampleCount == 0) {
+        Serial.printf("[Bench] %s: no samples\n", name);
+        return;
+    }
+
+    std::sort(samples, samples + sampleCount);
+    unsigned long long sum = 0;
+    for (unsigned int i = 0; i < sampleCount; i++) sum += samples[i];
+
+    char backlogField[32] = "";
+    if (backlog >= 0) snprintf(backlogField, sizeof(backlogField), "\"backlog\":%ld,", backlog);
+    char rateField[40] = "";
+    if (caseRate >= 0) snprintf(rateField, sizeof(rateField), ",\"readings_per_s\":%.1f", caseRate);
+
+    int n = snprintf(results + resultLength, sizeof(results) - resultLength,
+                     "%s{\"name\":\"%s\",%s\"n\":%u,\"p50_us\":%lu,\"p90_us\":%lu,\"p99_us\":%lu,"
+                     "\"max_us\":%lu,\"mean_us\":%.1f,\"allocs_per_op\":%.2f,\"bytes_per_op\":%.1f%s}",
+                     caseCount ? "," : "", name, backlogField, sampleCount,
+                     percentile(50), percentile(90), percentile(99), samples[sampleCount - 1],
+                     (double)sum / sampleCount, (double)allocTotal / sampleCount,
+                     (double)byteTotal / sampleCount, rateField);
+    if (n < 0 || (size_t)n >= sizeof(results) - resultLength) {
+        Serial.println("[Bench] Results buffer full");
+        return;
+    }
+    resultLength += n;
+    caseCount++;
+
+    Serial.printf("[Bench] %-14s %-16s p50 %7lu us  p99 %7lu us  max %7lu us  "
+                  "%.2f allocs  %.1f bytes\n",
+                  name, backlogField, percentile(50), percentile(99),
+                  samples[sampleCount - 1], (double)allocTotal / sampleCount,
+                  (double)byteTotal / sampleCount);
+}
+
+static void clearBuffer() {
+    unsigned long count;
+    while ((count = SDManager::getBufferCount()) > 0) {
+        if (SDManager::removeBuffered(count) == 0) break;
+    }
+}
+
+static void fillBuffer(unsigned long count) {
+    if (SDManager::getBufferCount() < count) {
+        Serial.printf("[Bench] Filling buffer to %lu readings\n", count);
+    }
+    while (SDManager::getBufferCount() < count) {
+        if (!SDManager::writeReading(nextRecord())) break;
+    }
+}
+
+static void benchPayload() {
+    ReadingRecord record = nextRecord();
+    beginCase();
+    for (unsigned int i = 0; i < BENCH_SAMPLES; i++) {
+        beginOp();
+        size_t length = Payload::writeReading(payload, sizeof(payload), record);
+        endOp(length);
+    }
+    endCase("build_payload", -1);
+}
+
+/**
+ * Channels::convert() of one reading is well below the micros()
+ * resolution, so each sample times BENCH_CONVERT_REPEAT of them.
+ */
+static void benchConvert() {
+    float values[BENCH_CONVERT_REPEAT][CH_COUNT];
+    for (unsigned int i = 0; i < BENCH_CONVERT_REPEAT; i++) {
+        values[i][CH_CO2] = 450.0f + i;
+        values[i][CH_TEMPERATURE] = 21.5f + i * 0.01f;
+        values[i][CH_HUMIDITY] = 60.0f + i * 0.1f;
+        values[i][CH_LIGHT] = 12000.0f + i * 10.0f;
+        values[i][CH_SOIL_MOISTURE] = 42.0f + i * 0.01f;
+        values[i][CH_SOIL_RAW] = 2150.0f + i % 16;
+    }
+    int32_t fixed[CH_COUNT];
+    volatile uint32_t sink = 0;
+
+    beginCase();
+    for (unsigned int i = 0; i < BENCH_SAMPLES; i++) {
+        beginOp();
+        for (unsigned int j = 0; j < BENCH_CONVERT_REPEAT; j++) {
+            sink = sink + Channels::convert(values[j], fixed) + fixed[CH_LIGHT];
+        }
+        endOp();
+    }
+    endCase("convert_channels", -1);
+}
+
+/**
+ * SD cases with 'backlog' readings in the buffer.
+ */
+static void benchSD(unsigned long backlog) {
+    fillBuffer(backlog);
+
+    beginCase();
+    for (unsigned int i = 0; i < BENCH_SAMPLES; i++) {
+        ReadingRecord record = nextRecord();
+        beginOp();
+        SDManager::writeReading(record);
+        endOp();
+        SDManager::removeOldestBuffered();
+    }
+    endCase("write_reading", backlog);
+
+    beginCase();
+    for (unsigned int i = 0; i < BENCH_SAMPLES; i++) {
+        beginOp();
+        bool removed = SDManager::removeOldestBuffered();
+        endOp();
+        if (removed) SDManager::writeReading(nextRecord());
+    }
+    endCase("remove_oldest", backlog);
+
+    beginCase();
+    for (unsigned int i = 0; i < BENCH_SAMPLES; i++) {
+        beginOp();
+        unsigned int flushed = SDManager::flushBuffer(formatReading, SD_FLUSH_BATCH);
+        endOp();
+        while (flushed--) SDManager::writeReading(nextRecord());
+    }
+    endCase("flush_buffer", backlog);
+}
+
+static bool countReading(const ReadingRecord& record) {
+    (void)record;
+    queryMatches++;
+    return true;
+}
+
+static bool countInWindow(const ReadingRecord& record) {
+    if (record.epoch >= windowStart && record.epoch <= windowEnd) queryMatches++;
+    return true;
+}
+
+/**
+ * Archive lookups over BENCH_QUERY_DAYS days of readings, one a
+ * minute. query_range asks SDManager::queryRange() for
+ * BENCH_QUERY_WINDOW seconds from noon of the second day (index, then
+ * only the blocks that overlap); query_scan decodes that whole day
+ * file and filters the same window, as a lookup without the index
+ * would.
+ */
+static void benchQuery() {
+    ReadingRecord first = nextRecord();
+    SDManager::writeReading(first, false);
+    for (unsigned long i = 1; i < BENCH_QUERY_DAYS * 1440UL; i++) {
+        SDManager::writeReading(nextRecord(), false);
+    }
+
+    time_t day = first.epoch + 86400;
+    struct tm timeinfo;
+    localtime_r(&day, &timeinfo);
+    timeinfo.tm_hour = timeinfo.tm_min = timeinfo.tm_sec = 0;
+    timeinfo.tm_isdst = -1;
+    uint32_t dayStart = mktime(&timeinfo);
+    uint32_t dayEnd = dayStart + 86399;
+    windowStart = dayStart + 12 * 3600;
+    windowEnd = windowStart + BENCH_QUERY_WINDOW - 1;
+
+    beginCase();
+    for (unsigned int i = 0; i < BENCH_SAMPLES; i++) {
+        queryMatches = 0;
+        beginOp();
+        SDManager::queryRange(windowStart, windowEnd, countReading, UINT_MAX);
+        endOp();
+    }
+    endCase("query_range", -1);
+    unsigned int indexed = queryMatches;
+
+    beginCase();
+    for (unsigned int i = 0; i < BENCH_SAMPLES; i++) {
+        queryMatches = 0;
+        beginOp();
+        SDManager::queryRange(dayStart, dayEnd, countInWindow, UINT_MAX);
+        endOp();
+    }
+    endCase("query_scan", -1);
+
+    Serial.printf("[Bench] query: %u readings in the window indexed, %u by decoding the day\n",
+                  indexed, queryMatches);
+    if (indexed != queryMatches) Serial.println("[Bench] query: FAILED (results differ)");
+}
+
+/**
+ * Overwrite both buffer log metadata slots, so the next init finds
+ * neither valid and rebuilds the cursor from the segment files.
+ */
+static void corruptBufferMeta() {
+    static const uint8_t garbage[16] = {};
+    for (unsigned int slot = 0; slot < 2; slot++) {
+        SDPath path;
+        path.format("%s/meta.%u", SD_BUFFER_DIR, slot);
+        File f = Hal::storage().open(path.c_str(), FILE_WRITE);
+        if (!f) continue;
+        f.write(garbage, sizeof(garbage));
+        f.close();
+    }
+}
+
+/**
+ * Boot-time cost of reopening the card with 'backlog' readings
+ * buffered: SDManager::init() as at boot (metadata read, tail
+ * recovered, archive reopened), then with both metadata slots
+ * corrupted so the buffer log walks its segments.
+ */
+static void benchInit(unsigned long backlog) {
+    fillBuffer(backlog);
+
+    beginCase();
+    for (unsigned int i = 0; i < BENCH_INITS; i++) {
+        beginOp();
+        SDManager::init();
+        endOp();
+    }
+    endCase("init", backlog);
+
+    beginCase();
+    for (unsigned int i = 0; i < BENCH_INITS; i++) {
+        corruptBufferMeta();
+        beginOp();
+        SDManager::init();
+        endOp();
+    }
+    endCase("init_rebuild", backlog);
+}
+
+/**
+ * Stress case: drain BENCH_DRAIN_BACKLOG readings the way the outbox
+ * sends them, with the records and batch message taken from the
+ * pool. Every stride-th batch is timed; the free heap is checked
+ * after every batch and must not shrink as the backlog is drained.
+ */
+static void benchDrain() {
+    clearBuffer();
+    fillBuffer(BENCH_DRAIN_BACKLOG);
+    unsigned long backlog = SDManager::getBufferCount();
+    unsigned long stride = backlog / SD_FLUSH_MAX_BATCH / BENCH_SAMPLES + 1;
+
+    uint32_t heapBefore = ESP.getFreeHeap();
+    uint32_t heapLowest = heapBefore;
+    unsigned long allocsBefore = AllocCounter::count();
+    unsigned long missesBefore = BufferPool::misses();
+    unsigned long batches = 0;
+
+    beginCase();
+    while (SDManager::getBufferCount() > 0) {
+        bool timed = batches++ % stride == 0;
+        if (timed) beginOp();
+
+        size_t length = 0;
+        unsigned int taken = 0;
+        {
+            PoolBuffer records(SD_FLUSH_MAX_BATCH * sizeof(ReadingRecord));
+            PoolBuffer message(MQTT_BATCH_BYTES);
+            if (!records || !message) break;
+            unsigned int read = SDManager::peekBuffered(records.as<ReadingRecord>(), SD_FLUSH_MAX_BATCH);
+            length = Payload::writeBatch(message.data(), message.size(),
+                                         records.as<ReadingRecord>(), read, taken);
+        }
+        if (taken == 0 || SDManager::removeBuffered(taken) == 0) break;
+
+        if (timed) endOp(length);
+        uint32_t heap = ESP.getFreeHeap();
+        if (heap < heapLowest) heapLowest = heap;
+    }
+    endCase("drain_backlog", backlog);
+
+    unsigned long left = SDManager::getBufferCount();
+    uint32_t heapAfter = ESP.getFreeHeap();
+    Serial.printf("[Bench] drain_backlog: %lu readings in %lu batches, %lu left; "
+                  "free heap %lu before, %lu lowest, %lu after; %lu allocations; "
+                  "pool peak %u, %lu misses\n",
+                  backlog - left, batches, left, (unsigned long)heapBefore,
+                  (unsigned long)heapLowest, (unsigned long)heapAfter,
+                  AllocCounter::count() - allocsBefore, BufferPool::peak(),
+                  BufferPool::misses() - missesBefore);
+    if (left > 0 || heapAfter < heapBefore) {
+        Serial.println("[Bench] drain_backlog: FAILED (backlog not drained or heap not constant)");
+    }
+}
+
+/**
+ * Bring up the network and wait for the broker.
+ * Returns false if it is not reached within BENCH_CONNECT_TIMEOUT.
+ */
+static bool connectBroker() {
+    WiFiManager::init();
+    TimeManager::init();
+    MQTTManager::setAckCallback(onAck);
+    MQTTManager::init();
+
+    unsigned long start = millis();
+    while (millis() - start < BENCH_CONNECT_TIMEOUT) {
+        WiFiManager::maintain();
+        MQTTManager::maintain();
+        if (MQTTManager::isConnected()) return true;
+        delay(10);
+    }
+    return false;
+}
+
+static void benchMQTT() {
+    ReadingRecord records[SD_FLUSH_BATCH];
+    for (unsigned int i = 0; i < SD_FLUSH_BATCH; i++) records[i] = nextRecord();
+    unsigned int taken = 0;
+    size_t length = Payload::writeBatch(batch, sizeof(batch), records, SD_FLUSH_BATCH, taken);
+
+    // The next message goes out once the last is acknowledged, so
+    // every sample starts with an empty in-flight window
+    beginCase();
+    for (unsigned int i = 0; i < BENCH_SAMPLES; i++) {
+        beginOp();
+        uint16_t packetId = MQTTManager::publishBatch(batch, length);
+        endOp(length);
+        if (!packetId || !waitForAck(packetId)) break;
+    }
+    endCase("mqtt_publish", -1);
+
+    beginCase();
+    for (unsigned int i = 0; i < BENCH_SAMPLES; i++) {
+        beginOp();
+        uint16_t packetId = MQTTManager::publishBatch(batch, length);
+        if (!packetId || !waitForAck(packetId)) break;
+        endOp(length);
+    }
+    endCase("mqtt_puback", -1);
+}
+
+/**
+ * Outbox::SendBatch for drain_rate: the synthetic readings already
+ * carry their time, so they go out as read.
+ */
+static unsigned int sendBatch(ReadingRecord* records, unsigned int count, uint16_t& packetId) {
+    unsigned int taken = 0;
+    size_t length = Payload::writeBatch(batch, sizeof(batch), records, count, taken);
+    packetId = length ? MQTTManager::publishBatch(batch, length) : 0;
+    if (length && !packetId) return 0;
+    return taken;
+}
+
+/**
+ * Drain BENCH_DRAIN_RATE_BACKLOG readings to the broker through the
+ * outbox, as the network task does once the link is back. Each
+ * sample is the time until the next acknowledged readings leave the
+ * buffer; the case also reports the overall readings per second.
+ */
+static void benchDrainRate() {
+    clearBuffer();
+    fillBuffer(BENCH_DRAIN_RATE_BACKLOG);
+    unsigned long backlog = SDManager::getBufferCount();
+    unsigned long remaining = backlog;
+    unsigned long failures = 0;
+
+    beginCase();
+    unsigned long start = millis();
+    unsigned long lastProgress = start;
+    beginOp();
+    while (remaining > 0) {
+        MQTTManager::maintain();
+        if (!Outbox::service(sendBatch)) failures++;
+
+        unsigned long count = SDManager::getBufferCount();
+        if (count < remaining) {
+            endOp(0);
+            remaining = count;
+            lastProgress = millis();
+            beginOp();
+        } else if (millis() - lastProgress >= BENCH_CONNECT_TIMEOUT) {
+            break;
+        }
+    }
+    unsigned long elapsed = millis() - start;
+    unsigned long drained = backlog - remaining;
+    caseRate = elapsed ? drained * 1000.0 / elapsed : 0;
+    endCase("drain_rate", backlog);
+
+    Serial.printf("[Bench] drain_rate: %lu readings in %lu ms (%.0f readings/s), %lu left, "
+                  "%lu failed or timed out batches\n",
+                  drained, elapsed, caseRate, remaining, failures);
+    if (remaining > 0) Serial.println("[Bench] drain_rate: FAILED (broker stopped acknowledging)");
+    clearBuffer();
+}
+
+/**
+ * BENCH_RECONNECTS reconnects to the broker: a clean disconnect, then
+ * maintain() until connected again (TCP, TLS handshake, CONNECT,
+ * subscribe, online status). With 'resume' the cached TLS session is
+ * offered; without, it is dropped first so every handshake is a full
+ * one. The host build has no TLS, so both cases time the plain connect.
+ */
+static void benchReconnect(bool resume) {
+    const char* name = resume ? "mqtt_reconnect" : "mqtt_connect_full";
+    const TLSStats& tls = Hal::networkStats();
+    unsigned long resumedBefore = tls.resumedHandshakes;
+    unsigned long heapPeak = 0;
+
+    beginCase();
+    for (unsigned int i = 0; i < BENCH_RECONNECTS; i++) {
+        MQTTManager::disconnect();
+        if (!resume) Hal::clearNetworkSession();
+
+        unsigned long start = millis();
+        beginOp();
+        while (!MQTTManager::maintain() && millis() - start < BENCH_CONNECT_TIMEOUT) delay(1);
+        if (!MQTTManager::isConnected()) break;
+        endOp();
+        if (tls.heapPeak > heapPeak) heapPeak = tls.heapPeak;
+    }
+    endCase(name, -1);
+
+    Serial.printf("[Bench] %s: %lu of %u handshakes resumed, TLS heap peak %lu bytes\n",
+                  name, tls.resumedHandshakes - resumedBefore, sampleCount, heapPeak);
+}
+
+/**
+ * Write the results to BENCH_RESULTS_DIR/<FIRMWARE_VERSION>.json.
+ */
+static bool saveResults(const char* json, size_t length) {
+    if (!SDManager::isAvailable()) return false;
+    if (!Hal::storage().exists(BENCH_RESULTS_DIR) && !Hal::storage().mkdir(BENCH_RESULTS_DIR)) {
+        return false;
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%s.json", BENCH_RESULTS_DIR, FIRMWARE_VERSION);
+    File file = Hal::storage().open(path, FILE_WRITE);
+    if (!file) return false;
+    bool ok = file.write((const uint8_t*)json, length) == length;
+    file.close();
+    if (ok) Serial.printf("[Bench] Results saved to %s\n", path);
+    return ok;
+}
+
+void Bench::run() {
+    Serial.println("\n--- Benchmark ---");
+    Serial.printf("[Bench] %d samples per case, allocation counting %s\n",
+                  BENCH_SAMPLES, AllocCounter::enabled() ? "on" : "off");
+
+    benchPayload();
+    benchConvert();
+
+    if (SDManager::isAvailable()) {
+        clearBuffer();
+        for (unsigned int i = 0; i < sizeof(backlogs) / sizeof(backlogs[0]); i++) {
+            benchSD(backlogs[i]);
+            benchInit(backlogs[i]);
+        }
+        benchDrain();
+        clearBuffer();
+        benchQuery();
+    } else {
+        Serial.println("[Bench] SD card not available, SD cases skipped");
+    }
+
+    if (connectBroker()) {
+        benchMQTT();
+        if (SDManager::isAvailable()) benchDrainRate();
+        benchReconnect(false);
+        benchReconnect(true);
+    } else {
+        Serial.println("[Bench] Broker not reached, MQTT cases skipped");
+    }
+
+#ifdef NATIVE
+    const char* platform = "native";
+#else
+    const char* platform = "esp32";
+#endif
+
+    static char json[BENCH_RESULT_BYTES + 256];
+    int length = snprintf(json, sizeof(json),
+                          "{\"firmware\":\"%s\",\"platform\":\"%s\",\"timestamp\":\"%s\","
+                          "\"samples\":%d,\"alloc_counting\":%s,\"cases\":[%s]}",
+                          FIRMWARE_VERSION, platform, TimeManager::getISO8601().c_str(),
+                          BENCH_SAMPLES, AllocCounter::enabled() ? "true" : "false", results);
+    if (length < 0 || (size_t)length >= sizeof(json)) {
+        Serial.println("[Bench] Results too large");
+    } else {
+        Serial.printf("[Bench] %s\n", json);
+        if (!saveResults(json, length)) Serial.println("[Bench] Could not save results");
+    }
+
+    Serial.println("--- Benchmark complete ---");
+#ifdef NATIVE
+    Serial.flush();
+    exit(0);
+#endif
+}
@@ -0,0 +1,448 @@
+/**
+ * buffer_log.cpp - Segmented append-only ring log for buffered readings
+ *
+ * Layout inside the log directory:
+ *   meta.0        metadata block, slot A
+ *   meta.1        metadata block, slot B
+ *   00000001.rec  up to SD_SEGMENT_RECORDS readings
+ *   00000002.rec  ...
+ *
+ * Segments hold fixed-size ReadingRecords, so a reading's position is
+ * its index times the record size. A record cut short by a power loss
+ * fails its CRC and is skipped when read.
+ *
+ * The metadata block holds the head/tail cursor plus the oldest/newest
+ * timestamps. It is saved after every append and dequeue, alternating
+ * between two slots with a sequence number and CRC, so a torn write
+ * leaves the previous slot intact.
+ *
+ * Boot normally reads only the metadata block. Readings appended
+ * after the last save are picked up from the size of the tail
+ * segment. A directory walk runs only if both metadata slots fail
+ * validation. Readings are delivered at least once.
+ */
+
+#include "buffer_log.h"
+#include "config.h"
+#include "checksum.h"
+#include "sd_path.h"
+
+#define META_MAGIC   0x47484D32UL   // "GHM2"
+#define RECORD_SIZE  sizeof(ReadingRecord)
+
+struct MetaRecord {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t headSeg;
+    uint32_t headIdx;
+    uint32_t tailSeg;
+    uint32_t tailCount;
+    uint32_t oldestEpoch;
+    uint32_t newestEpoch;
+    uint32_t crc;                   // CRC32 of all fields above
+};
+
+static fs::FS* logFs = nullptr;
+static char logDir[SD_DIR_MAX] = "";
+
+static uint32_t headSeg = 1;     // Segment holding the oldest reading
+static uint32_t headIdx = 0;     // Readings already consumed in head segment
+static uint32_t tailSeg = 1;     // Segment receiving new readings
+static uint32_t tailCount = 0;   // Readings in the tail segment
+static uint32_t oldestStamp = 0; // Epoch of the head reading
+static uint32_t newestStamp = 0; // Epoch of the last appended reading
+static uint32_t metaSeq = 0;     // Sequence number of the last saved block
+static unsigned long written = 0; // Bytes written since boot
+
+static SDPath segmentPath(uint32_t seg) {
+    SDPath p;
+    p.format("%s/%08lu.rec", logDir, (unsigned long)seg);
+    return p;
+}
+
+static SDPath metaPath(uint32_t slot) {
+    SDPath p;
+    p.format("%s/meta.%lu", logDir, (unsigned long)slot);
+    return p;
+}
+
+static bool saveMeta() {
+    MetaRecord rec;
+    rec.magic = META_MAGIC;
+    rec.seq = metaSeq + 1;
+    rec.headSeg = headSeg;
+    rec.headIdx = headIdx;
+    rec.tailSeg = tailSeg;
+    rec.tailCount = tailCount;
+    rec.oldestEpoch = oldestStamp;
+    rec.newestEpoch = newestStamp;
+    rec.crc = Checksum::crc32(&rec, offsetof(MetaRecord, crc));
+
+    File f = logFs->open(metaPath(rec.seq & 1).c_str(), FILE_WRITE);
+    if (!f) {
+        Serial.println("[Log] Failed to write metadata");
+        return false;
+    }
+    size_t n = f.write((const uint8_t*)&rec, sizeof(rec));
+    f.close();
+    written += n;
+    if (n != sizeof(rec)) return false;
+
+    metaSeq = rec.seq;
+    return true;
+}
+
+static bool readMetaSlot(uint32_t slot, MetaRecord& rec) {
+    File f = logFs->open(metaPath(slot).c_str(), FILE_READ);
+    if (!f) return false;
+    size_t n = f.read((uint8_t*)&rec, sizeof(rec));
+    f.close();
+
+    if (n != sizeof(rec) || rec.magic != META_MAGIC) return false;
+    if (rec.crc != Checksum::crc32(&rec, offsetof(MetaRecord, crc))) return false;
+    return rec.headSeg > 0 && rec.tailSeg >= rec.headSeg;
+}
+
+/**
+ * Load the newest valid metadata slot.
+ */
+static bool loadMeta() {
+    MetaRecord a, b;
+    bool aOK = readMetaSlot(0, a);
+    bool bOK = readMetaSlot(1, b);
+    if (!aOK && !bOK) return false;
+
+    const MetaRecord& rec = (aOK && (!bOK || a.seq > b.seq)) ? a : b;
+    metaSeq = rec.seq;
+    headSeg = rec.headSeg;
+    headIdx = rec.headIdx;
+    tailSeg = rec.tailSeg;
+    tailCount = rec.tailCount;
+    oldestStamp = rec.oldestEpoch;
+    newestStamp = rec.newestEpoch;
+    return true;
+}
+
+/**
+ * Rebuild the cursor from the segment files present when both
+ * metadata slots are unreadable. Bounded by the number of segments.
+ * Head restarts at the oldest segment (readings may be re-sent).
+ */
+static void rebuildMeta() {
+    uint32_t lo = 0, hi = 0;
+
+    File dir = logFs->open(logDir);
+    if (dir) {
+        File entry = dir.openNextFile();
+        while (entry) {
+            const char* name = strrchr(entry.name(), '/');
+            name = name ? name + 1 : entry.name();
+            uint32_t seg = strtoul(name, nullptr, 10);
+            if (seg > 0 && strstr(name, ".rec")) {
+                if (lo == 0 || seg < lo) lo = seg;
+                if (seg > hi) hi = seg;
+            }
+            entry.close();
+            entry = dir.openNextFile();
+        }
+        dir.close();
+    }
+
+    headSeg = lo ? lo : 1;
+    tailSeg = hi ? hi : 1;
+    headIdx = 0;
+    tailCount = 0;
+    oldestStamp = 0;
+    newestStamp = 0;
+    metaSeq = 0;
+
+    if (lo) {
+        Serial.printf("[Log] Metadata lost, rebuilt from segments %lu-%lu\n",
+                      (unsigned long)lo, (unsigned long)hi);
+    }
+}
+
+/**
+ * Pick up tail readings written after the last metadata save from
+ * the size of the tail segment. A record torn by a power loss is
+ * padded to full size so that the next append stays aligned; it then
+ * fails its CRC and is skipped when read.
+ */
+static void recoverTail() {
+    File f = logFs->open(segmentPath(tailSeg).c_str(), FILE_READ);
+    uint32_t size = f ? f.size() : 0;
+    uint32_t expected = tailCount * RECORD_SIZE;
+    if (size == expected) {
+        if (f) f.close();
+        return;
+    }
+
+    Serial.printf("[Log] Tail segment is %lu bytes, expected %lu\n",
+                  (unsigned long)size, (unsigned long)expected);
+
+    uint32_t whole = size / RECORD_SIZE;
+    uint32_t torn = size % RECORD_SIZE;
+
+    // Newest timestamp from the last complete record
+    ReadingRecord last;
+    if (whole > 0 && f.seek((whole - 1) * RECORD_SIZE) &&
+        f.read((uint8_t*)&last, RECORD_SIZE) == RECORD_SIZE &&
+        RecordCodec::isValid(last)) {
+        newestStamp = last.epoch;
+    }
+    if (f) f.close();
+
+    tailCount = whole;
+    if (torn) {
+        Serial.println("[Log] Torn reading at end of buffer, skipping it");
+        uint8_t pad[RECORD_SIZE] = {};
+        f = logFs->open(segmentPath(tailSeg).c_str(), FILE_APPEND);
+        if (f) {
+            written += f.write(pad, RECORD_SIZE - torn);
+            f.close();
+            tailCount++;
+        }
+    }
+}
+
+/**
+ * Number of readings the head segment holds in total.
+ */
+static uint32_t headSegmentSize() {
+    return headSeg == tailSeg ? tailCount : SD_SEGMENT_RECORDS;
+}
+
+/**
+ * Move the head past the oldest reading. Once the head segment is
+ * fully consumed the metadata is saved and then the segment deleted,
+ * so a power loss in between leaves at most one stale segment.
+ */
+static void advanceHead() {
+    headIdx++;
+    if (headIdx < headSegmentSize()) return;
+
+    uint32_t retired = headSeg;
+    if (headSeg == tailSeg) {
+        // Log is empty: start a fresh segment
+        tailSeg++;
+        tailCount = 0;
+    }
+    headSeg++;
+    headIdx = 0;
+
+    saveMeta();
+    logFs->remove(segmentPath(retired).c_str());
+}
+
+/**
+ * Read the head reading's timestamp into oldestStamp.
+ */
+static void refreshOldest() {
+    ReadingRecord record;
+    if (BufferLog::count() == 0) {
+        oldestStamp = 0;
+    } else if (BufferLog::peek(record)) {
+        oldestStamp = record.epoch;
+    }
+}
+
+bool BufferLog::begin(fs::FS& fs, const char* dir) {
+    if (strlen(dir) >= sizeof(logDir)) {
+        Serial.printf("[Log] Directory name too long: %s\n", dir);
+        logFs = nullptr;
+        return false;
+    }
+    logFs = &fs;
+    strcpy(logDir, dir);
+
+    if (!fs.exists(dir) && !fs.mkdir(dir)) {
+        Serial.printf("[Log] Cannot create %s\n", dir);
+        logFs = nullptr;
+        return false;
+    }
+
+    if (!loadMeta()) {
+        rebuildMeta();
+    }
+
+    // Segment retired but not yet deleted before the last power loss
+    if (headSeg > 1 && fs.exists(segmentPath(headSeg - 1).c_str())) {
+        fs.remove(segmentPath(headSeg - 1).c_str());
+    }
+
+    // New tail started after the last save
+    while (fs.exists(segmentPath(tailSeg + 1).c_str())) {
+        tailSeg++;
+        tailCount = 0;
+    }
+
+    recoverTail();
+    if (headSeg == tailSeg && headIdx > tailCount) {
+        headIdx = tailCount;
+    }
+
+    refreshOldest();
+    saveMeta();
+    return true;
+}
+
+bool BufferLog::append(const ReadingRecord& record) {
+    if (!logFs) return false;
+
+    if (tailCount >= SD_SEGMENT_RECORDS) {
+        tailSeg++;
+        tailCount = 0;
+    }
+
+    File f = logFs->open(segmentPath(tailSeg).c_str(), FILE_APPEND);
+    if (!f) {
+        Serial.println("[Log] Failed to open tail segment");
+        return false;
+    }
+    size_t n = f.write((const uint8_t*)&record, RECORD_SIZE);
+    f.close();
+    written += n;
+    if (n != RECORD_SIZE) {
+        Serial.println("[Log] Short write to tail segment");
+        return false;
+    }
+
+    if (count() == 0) oldestStamp = record.epoch;
+    newestStamp = record.epoch;
+    tailCount++;
+    saveMeta();
+    return true;
+}
+
+bool BufferLog::peek(ReadingRecord& record) {
+    if (!logFs || count() == 0) return false;
+
+    File f = logFs->open(segmentPath(headSeg).c_str(), FILE_READ);
+    if (!f) return false;
+
+    f.seek(headIdx * RECORD_SIZE);
+    size_t n = f.read((uint8_t*)&record, RECORD_SIZE);
+    f.close();
+
+    return n == RECORD_SIZE && RecordCodec::isValid(record);
+}
+
+bool BufferLog::pop() {
+    if (!logFs || count() == 0) return false;
+
+    advanceHead();
+    refreshOldest();
+    saveMeta();
+    return true;
+}
+
+unsigned int BufferLog::peekBatch(ReadingRecord* records, unsigned int maxCount, unsigned long skip) {
+    if (!logFs) return 0;
+
+    unsigned long available = count();
+    if (skip >= available) return 0;
+    if (maxCount > available - skip) maxCount = available - skip;
+
+    // Locate the first reading after 'skip'
+    unsigned long pos = headIdx + skip;
+    unsigned int read = 0;
+    uint32_t seg = headSeg + pos / SD_SEGMENT_RECORDS;
+    uint32_t idx = pos % SD_SEGMENT_RECORDS;
+    while (read < maxCount) {
+        File f = logFs->open(segmentPath(seg).c_str(), FILE_READ);
+        if (!f) break;
+        f.seek(idx * RECORD_SIZE);
+
+        // Read the rest of this segment in one request
+        uint32_t inSeg = (seg == tailSeg ? tailCount : SD_SEGMENT_RECORDS) - idx;
+        uint32_t want = maxCount - read < inSeg ? maxCount - read : inSeg;
+        size_t n = f.read((uint8_t*)&records[read], want * RECORD_SIZE) / RECORD_SIZE;
+        f.close();
+
+        read += n;
+        if (n < want) break;
+        seg++;
+        idx = 0;
+    }
+    return read;
+}
+
+unsigned int BufferLog::popBatch(unsigned int count) {
+    if (!logFs) return 0;
+
+    unsigned int removed = 0;
+    while (removed < count && BufferLog::count() > 0) {
+        advanceHead();
+        removed++;
+    }
+    if (removed > 0) {
+        refreshOldest();
+        saveMeta();
+    }
+    return removed;
+}
+
+unsigned int BufferLog::drain(bool (*callback)(const ReadingRecord& record), unsigned int maxCount) {
+    if (!logFs) return 0;
+
+    unsigned int consumed = 0;
+    bool advanced = false;
+    File f;
+    uint32_t openSeg = 0;
+
+    while (consumed < maxCount && count() > 0) {
+        if (!f || openSeg != headSeg) {
+            if (f) f.close();
+            f = logFs->open(segmentPath(headSeg).c_str(), FILE_READ);
+            if (!f) break;
+            f.seek(headIdx * RECORD_SIZE);
+            openSeg = headSeg;
+        }
+
+        ReadingRecord record;
+        size_t n = f.read((uint8_t*)&record, RECORD_SIZE);
+
+        // Corrupted records are skipped, not delivered
+        if (n == RECORD_SIZE && RecordCodec::isValid(record)) {
+            if (!callback(record)) break;
+            consumed++;
+        }
+
+        // Close before the segment is deleted by advanceHead()
+        if (headIdx + 1 >= headSegmentSize()) {
+            f.close();
+        }
+        advanceHead();
+        advanced = true;
+    }
+
+    if (f) f.close();
+    if (advanced) {
+        refreshOldest();
+        saveMeta();
+    }
+    return consumed;
+}
+
+unsigned long BufferLog::count() {
+    if (!logFs) return 0;
+    if (headSeg == tailSeg) return tailCount - headIdx;
+    return (unsigned long)(tailSeg - headSeg - 1) * SD_SEGMENT_RECORDS
+         + (SD_SEGMENT_RECORDS - headIdx) + tailCount;
+}
+
+unsigned long BufferLog::bytes() {
+    return count() * RECORD_SIZE;
+}
+
+uint32_t BufferLog::oldestEpoch() {
+    return oldestStamp;
+}
+
+uint32_t BufferLog::newestEpoch() {
+    return newestStamp;
+}
+
+unsigned long BufferLog::bytesWritten() {
+    return written;
+}
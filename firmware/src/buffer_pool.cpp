@@ -0,0 +1,84 @@
+/**
+ * buffer_pool.cpp - Fixed pool of transient buffers
+ *
+ * Each class is an array of slots with a bitmap of the taken ones;
+ * a slot is claimed with a compare-and-swap on the bitmap, so the
+ * storage and network tasks can share the pool without a lock.
+ */
+
+#include "buffer_pool.h"
+#include "config.h"
+#include <atomic>
+
+static_assert(POOL_SMALL_SLOTS <= 32 && POOL_LARGE_SLOTS <= 32, "at most 32 slots per class");
+static_assert(POOL_SMALL_BYTES % 4 == 0 && POOL_LARGE_BYTES % 4 == 0, "slot sizes must be multiples of 4");
+
+// uint32_t storage keeps the slots aligned for record arrays
+static uint32_t smallSlots[POOL_SMALL_SLOTS][POOL_SMALL_BYTES / 4];
+static uint32_t largeSlots[POOL_LARGE_SLOTS][POOL_LARGE_BYTES / 4];
+
+static std::atomic<uint32_t> smallTaken(0);
+static std::atomic<uint32_t> largeTaken(0);
+static std::atomic<unsigned int> taken(0);
+static std::atomic<unsigned int> takenPeak(0);
+static std::atomic<unsigned long> missCount(0);
+
+/**
+ * Claim a clear bit of 'bitmap' below 'slots'.
+ * Returns its index, or -1 if all are set.
+ */
+static int claim(std::atomic<uint32_t>& bitmap, unsigned int slots) {
+    uint32_t current = bitmap.load();
+    for (;;) {
+        unsigned int i = 0;
+        while (i < slots && (current & (1UL << i))) i++;
+        if (i == slots) return -1;
+        if (bitmap.compare_exchange_weak(current, current | (1UL << i))) return i;
+    }
+}
+
+void* BufferPool::acquire(size_t size) {
+    void* buffer = nullptr;
+    if (size <= POOL_SMALL_BYTES) {
+        int i = claim(smallTaken, POOL_SMALL_SLOTS);
+        if (i >= 0) buffer = smallSlots[i];
+    } else if (size <= POOL_LARGE_BYTES) {
+        int i = claim(largeTaken, POOL_LARGE_SLOTS);
+        if (i >= 0) buffer = largeSlots[i];
+    }
+
+    if (!buffer) {
+        missCount++;
+        return nullptr;
+    }
+    unsigned int now = ++taken;
+    unsigned int peak = takenPeak.load();
+    while (now > peak && !takenPeak.compare_exchange_weak(peak, now)) {}
+    return buffer;
+}
+
+void BufferPool::release(void* buffer) {
+    uint32_t* slot = (uint32_t*)buffer;
+    if (slot >= smallSlots[0] && slot < smallSlots[0] + POOL_SMALL_SLOTS * (POOL_SMALL_BYTES / 4)) {
+        unsigned int i = (slot - smallSlots[0]) / (POOL_SMALL_BYTES / 4);
+        smallTaken &= ~(1UL << i);
+    } else if (slot >= largeSlots[0] && slot < largeSlots[0] + POOL_LARGE_SLOTS * (POOL_LARGE_BYTES / 4)) {
+        unsigned int i = (slot - largeSlots[0]) / (POOL_LARGE_BYTES / 4);
+        largeTaken &= ~(1UL << i);
+    } else {
+        return;
+    }
+    taken--;
+}
+
+unsigned int BufferPool::inUse() {
+    return taken;
+}
+
+unsigned int BufferPool::peak() {
+    return takenPeak;
+}
+
+unsigned long BufferPool::misses() {
+    return missCount;
+}
@@ -0,0 +1,76 @@
+/**
+ * deadband.cpp - Report-by-exception filter for published readings
+ *
+ * Compares record fields directly in their fixed-point units; the
+ * thresholds from config.h are scaled with the channel table once.
+ */
+
+#include "deadband.h"
+#include "config.h"
+#include "sensor_channels.h"
+#include <atomic>
+
+// Thresholds in record (fixed-point) units, rounded (0.29 C is 29,
+// not the 28 that truncating 28.999... would give)
+static constexpr int32_t BAND_CO2 = Channels::toFixed(CH_CO2, DEADBAND_CO2);
+static constexpr int32_t BAND_TEMPERATURE = Channels::toFixed(CH_TEMPERATURE, DEADBAND_TEMPERATURE);
+static constexpr int32_t BAND_HUMIDITY = Channels::toFixed(CH_HUMIDITY, DEADBAND_HUMIDITY);
+static constexpr int32_t BAND_LIGHT = Channels::toFixed(CH_LIGHT, DEADBAND_LIGHT);
+static constexpr int32_t BAND_SOIL = Channels::toFixed(CH_SOIL_MOISTURE, DEADBAND_SOIL);
+
+#define VALID_FLAGS (RECORD_FLAG_SCD30 | RECORD_FLAG_BH1750 | RECORD_FLAG_SOIL)
+
+static ReadingRecord reference;         // Last published reading
+static bool haveReference = false;
+static unsigned long referenceTime = 0;
+static std::atomic<unsigned long> checked(0);
+static std::atomic<unsigned long> suppressed(0);
+
+static bool moved(int32_t value, int32_t last, int32_t band) {
+    return abs(value - last) > band;
+}
+
+/**
+ * True if any valid channel left its deadband.
+ */
+static bool changed(const ReadingRecord& r) {
+    if ((r.flags & VALID_FLAGS) != (reference.flags & VALID_FLAGS)) return true;
+
+    if (r.flags & RECORD_FLAG_SCD30) {
+        if (moved(r.co2, reference.co2, BAND_CO2) ||
+            moved(r.temperature, reference.temperature, BAND_TEMPERATURE) ||
+            moved(r.humidity, reference.humidity, BAND_HUMIDITY)) {
+            return true;
+        }
+    }
+    if ((r.flags & RECORD_FLAG_BH1750) && moved(r.light, reference.light, BAND_LIGHT)) return true;
+    if ((r.flags & RECORD_FLAG_SOIL) && moved(r.soilMoisture, reference.soilMoisture, BAND_SOIL)) return true;
+    return false;
+}
+
+bool Deadband::shouldPublish(const ReadingRecord& record) {
+    checked++;
+    if (!DEADBAND_ENABLED) return true;
+
+    unsigned long now = millis();
+    bool publish = !haveReference ||
+                   now - referenceTime >= DEADBAND_HEARTBEAT ||
+                   changed(record);
+
+    if (publish) {
+        reference = record;
+        referenceTime = now;
+        haveReference = true;
+    } else {
+        suppressed++;
+    }
+    return publish;
+}
+
+unsigned long Deadband::getChecked() {
+    return checked;
+}
+
+unsigned long Deadband::getSuppressed() {
+    return suppressed;
+}
@@ -0,0 +1,106 @@
+/**
+ * diagnostics.cpp - Heap and stack telemetry
+ *
+ * The loop figures are written by the network task and read when it
+ * builds the status message, so they need no locking.
+ */
+
+#include "diagnostics.h"
+#include "config.h"
+#include "alloc_counter.h"
+#include "mqtt_manager.h"
+#include "time_manager.h"
+
+#define DIAG_MAX_TASKS 4
+
+static struct {
+    const char* name;
+    TaskHandle_t handle;
+} tasks[DIAG_MAX_TASKS];
+static unsigned int taskCount = 0;
+
+static unsigned long loopStartAllocs = 0;
+static unsigned long loopAllocsMax = 0;
+static unsigned long loopAllocsTotal = 0;
+static unsigned long loopCount = 0;
+
+void Diagnostics::addTask(const char* name, TaskHandle_t task) {
+    if (taskCount >= DIAG_MAX_TASKS || !task) return;
+    tasks[taskCount].name = name;
+    tasks[taskCount].handle = task;
+    taskCount++;
+}
+
+void Diagnostics::beginLoop() {
+    loopStartAllocs = AllocCounter::count();
+}
+
+void Diagnostics::endLoop() {
+    unsigned long allocs = AllocCounter::count() - loopStartAllocs;
+    if (allocs > loopAllocsMax) loopAllocsMax = allocs;
+    loopAllocsTotal += allocs;
+    loopCount++;
+}
+
+/**
+ * Heap and stack figures, shared by the status message and the report.
+ */
+static void addHeap(JsonDocument& doc) {
+    uint32_t free = ESP.getFreeHeap();
+    uint32_t largest = ESP.getMaxAllocHeap();
+
+    JsonObject heap = doc["heap"].to<JsonObject>();
+    heap["free"] = free;
+    heap["min_free"] = ESP.getMinFreeHeap();
+    heap["largest_block"] = largest;
+    // Share of free memory not usable for one allocation (%)
+    heap["fragmentation"] = free ? roundf(1000.0f * (free - min(largest, free)) / free) / 10.0f : 0.0f;
+    if (AllocCounter::enabled()) {
+        heap["allocs"] = AllocCounter::count();
+        heap["alloc_bytes"] = AllocCounter::bytes();
+        heap["loop_allocs_max"] = loopAllocsMax;
+        heap["loop_allocs_mean"] = loopCount ? roundf(10.0f * loopAllocsTotal / loopCount) / 10.0f : 0.0f;
+    }
+
+    JsonObject stacks = doc["stack_free"].to<JsonObject>();
+    for (unsigned int i = 0; i < taskCount; i++) {
+        stacks[tasks[i].name] = uxTaskGetStackHighWaterMark(tasks[i].handle);
+    }
+}
+
+void Diagnostics::addStatus(JsonDocument& doc) {
+    addHeap(doc);
+    loopAllocsMax = 0;
+    loopAllocsTotal = 0;
+    loopCount = 0;
+}
+
+void Diagnostics::publishReport() {
+    JsonDocument doc;
+    doc["device"] = DEVICE_ID;
+    doc["uptime_sec"] = TimeManager::getUptime();
+    addHeap(doc);
+
+    if (AllocCounter::tracing()) {
+        static AllocSite sites[DIAG_TOP_SITES];
+        unsigned int count = AllocCounter::topSites(sites, DIAG_TOP_SITES);
+        JsonArray list = doc["alloc_sites"].to<JsonArray>();
+        for (unsigned int i = 0; i < count; i++) {
+            JsonArray site = list.add<JsonArray>();
+            if (sites[i].address) {
+                char address[20];
+                snprintf(address, sizeof(address), "0x%08lx", (unsigned long)sites[i].address);
+                site.add(address);
+            } else {
+                site.add("other");
+            }
+            site.add(sites[i].count);
+            site.add(sites[i].bytes);
+        }
+    }
+
+    String report;
+    serializeJson(doc, report);
+    MQTTManager::publishDiagnostics(report);
+    Serial.printf("[Diag] %s\n", report.c_str());
+}
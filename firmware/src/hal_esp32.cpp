@@ -0,0 +1,72 @@
+/**
+ * hal_esp32.cpp - Hardware abstraction on the ESP32
+ *
+ * SD card on the VSPI pins from config.h; broker connection through
+ * TLSClient.
+ */
+
+#include "hal.h"
+#include "config.h"
+#include "tls_client.h"
+#include <SD.h>
+#include <SPI.h>
+
+/**
+ * Constructed on first use: other modules bind to it during static
+ * initialization.
+ */
+static TLSClient& tlsClient() {
+    static TLSClient client;
+    return client;
+}
+
+bool Hal::mountStorage() {
+    SPI.begin(SD_SCK_PIN, SD_MISO_PIN, SD_MOSI_PIN, SD_CS_PIN);
+
+    if (!SD.begin(SD_CS_PIN)) {
+        Serial.println("FAILED! Check wiring and card.");
+        return false;
+    }
+    if (SD.cardType() == CARD_NONE) {
+        Serial.println("No card inserted.");
+        return false;
+    }
+    return true;
+}
+
+fs::FS& Hal::storage() {
+    return SD;
+}
+
+const char* Hal::storageType() {
+    switch (SD.cardType()) {
+        case CARD_MMC:  return "MMC";
+        case CARD_SD:   return "SD";
+        case CARD_SDHC: return "SDHC";
+        default:        return "UNKNOWN";
+    }
+}
+
+uint64_t Hal::storageTotalBytes() {
+    return SD.totalBytes();
+}
+
+uint64_t Hal::storageUsedBytes() {
+    return SD.usedBytes();
+}
+
+Client& Hal::networkClient() {
+    return tlsClient();
+}
+
+void Hal::setRootCA(const char* rootCA) {
+    tlsClient().setCACert(rootCA);
+}
+
+const TLSStats& Hal::networkStats() {
+    return tlsClient().getStats();
+}
+
+void Hal::clearNetworkSession() {
+    tlsClient().clearSession();
+}
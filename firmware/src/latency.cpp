@@ -0,0 +1,90 @@
+/**
+ * latency.cpp - Per-stage latency histograms
+ *
+ * Bucket layout: 0-3 us one bucket each, then four buckets per
+ * octave, i.e. bucket 4*(k-1) + s covers [2^k + s*2^(k-2),
+ * 2^k + (s+1)*2^(k-2)) for k >= 2. The last bucket collects
+ * everything from 2^24 us (16.8 s) on and reports the exact maximum,
+ * which is kept separately.
+ */
+
+#include "latency.h"
+#include <atomic>
+
+#define LATENCY_OCTAVES 24
+#define LATENCY_BUCKETS (4 * LATENCY_OCTAVES)
+
+struct Histogram {
+    std::atomic<uint32_t> buckets[LATENCY_BUCKETS];
+    std::atomic<uint32_t> max;
+};
+
+static Histogram histograms[STAGE_COUNT];
+
+static const char* const stageNames[STAGE_COUNT] = {
+    "sensor_poll", "sensor_read", "sd_write", "payload", "wifi", "mqtt",
+    "ntp", "outbox", "replay", "retention", "network_loop",
+};
+
+static unsigned int bucketFor(uint32_t us) {
+    if (us < 4) return us;
+    unsigned int octave = 31 - __builtin_clz(us);
+    if (octave >= LATENCY_OCTAVES) return LATENCY_BUCKETS - 1;
+    return 4 * (octave - 1) + ((us >> (octave - 2)) & 3);
+}
+
+/**
+ * Largest value counted into 'bucket'.
+ */
+static uint32_t bucketTop(unsigned int bucket) {
+    if (bucket < 4) return bucket;
+    if (bucket == LATENCY_BUCKETS - 1) return UINT32_MAX;
+    unsigned int octave = bucket / 4 + 1;
+    unsigned int sub = bucket % 4;
+    return (1UL << octave) + ((sub + 1) << (octave - 2)) - 1;
+}
+
+void Latency::record(LatencyStage stage, uint32_t us) {
+    Histogram& h = histograms[stage];
+    h.buckets[bucketFor(us)].fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t max = h.max.load(std::memory_order_relaxed);
+    while (us > max && !h.max.compare_exchange_weak(max, us, std::memory_order_relaxed)) {}
+}
+
+LatencySummary Latency::take(LatencyStage stage) {
+    Histogram& h = histograms[stage];
+    uint32_t counts[LATENCY_BUCKETS];
+    LatencySummary summary = {0, 0, 0, 0};
+
+    for (unsigned int i = 0; i < LATENCY_BUCKETS; i++) {
+        counts[i] = h.buckets[i].exchange(0, std::memory_order_relaxed);
+        summary.count += counts[i];
+    }
+    summary.max = h.max.exchange(0, std::memory_order_relaxed);
+    if (summary.count == 0) return summary;
+
+    // Nearest rank; a bucket reports its upper edge, capped at the max
+    uint32_t rank50 = (summary.count + 1) / 2;
+    uint32_t rank99 = summary.count - summary.count / 100;
+    uint32_t seen = 0;
+    bool haveP50 = false;
+    for (unsigned int i = 0; i < LATENCY_BUCKETS; i++) {
+        if (!counts[i]) continue;
+        seen += counts[i];
+        uint32_t top = min(bucketTop(i), summary.max);
+        if (!haveP50 && seen >= rank50) {
+            summary.p50 = top;
+            haveP50 = true;
+        }
+        if (seen >= rank99) {
+            summary.p99 = top;
+            break;
+        }
+    }
+    return summary;
+}
+
+const char* Latency::name(LatencyStage stage) {
+    return stage < STAGE_COUNT ? stageNames[stage] : "unknown";
+}
@@ -14,93 +14,139 @@
  * Storage:  MicroSD card via SPI (write-first data buffering)
  * Protocol: MQTT over TLS -> InfluxDB
  * Interval: 60 seconds
+ * 
+ * Tasks (FreeRTOS, see config.h for cores and priorities):
+ *   sensor  - samples each sensor at its own rate, queues the interval
+ *             means every SENSOR_READ_INTERVAL
+ *   storage - writes queued records to the SD buffer and archive
+ *   network - WiFi/MQTT upkeep, sends the SD buffer, status,
+ *             interval statistics and requested archive replays
+ * Sampling never waits on the network: a reconnect only stalls the
+ * network task, and readings wait on SD meanwhile.
+ * 
+ * Boot brings up SD and sensors first and starts sampling at once;
+ * WiFi, NTP and MQTT come up in the network task. Readings taken
+ * before NTP syncs carry uptime and get wall-clock time when sent.
  */
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include <esp_task_wdt.h>
 #include <Preferences.h>   
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
 #include "config.h"
 #include "wifi_manager.h"
 #include "mqtt_manager.h"
 #include "time_manager.h"
 #include "sensor_manager.h"
 #include "sd_manager.h"
-
-// Timing trackers
-static unsigned long lastSensorRead = 0;
-static unsigned long lastStatusPublish = 0;
-static unsigned long readingCount = 0;
-static unsigned long publishFailCount = 0;
+#include "reading_record.h"
+#include "outbox.h"
+#include "payload.h"
+#include "deadband.h"
+#include "replay.h"
+#include "retention.h"
+#include "bench.h"
+#include "latency.h"
+#include "diagnostics.h"
+#include "buffer_pool.h"
+
+#if SENSOR_READ_INTERVAL >= WATCHDOG_TIMEOUT * 1000
+#error "SENSOR_READ_INTERVAL must be shorter than WATCHDOG_TIMEOUT"
+#endif
+
+// Counters shared between tasks
+static std::atomic<unsigned long> readingCount(0);
+static std::atomic<unsigned long> publishFailCount(0);
+static std::atomic<unsigned long> droppedCount(0);
+static std::atomic<bool> mqttOnline(false);
+static std::atomic<unsigned long> networkStallMax(0);   // Longest network loop since last status
 static uint32_t bootCount = 0;
 
+// Milliseconds after power-on at which each boot phase finished
+// (0 = not yet). Reported once, in the first status message.
+static struct {
+    unsigned long sensors;
+    unsigned long sd;
+    unsigned long wifi;
+    unsigned long ntp;
+    unsigned long mqtt;
+} bootTimes;
+static std::atomic<unsigned long> firstReadingTime(0);
+static bool sensorsOK = false;
+static bool sdOK = false;
+
+// Stage handoff: sensor -> storage, storage -> network (not on SD)
+static QueueHandle_t readingQueue = nullptr;
+static QueueHandle_t publishQueue = nullptr;
+static QueueHandle_t statsQueue = nullptr;
+static std::atomic<unsigned int> readingQueuePeak(0);
+static std::atomic<unsigned int> publishQueuePeak(0);
+
 /**
- * Build JSON payload from sensor readings.
- * 
- * Example output:
- * {
- *   "device": "LEPAA-GH-01",
- *   "timestamp": "2026-03-15T14:30:00+02:00",
- *   "reading": 142,
- *   "sensors": {
- *     "co2": 485.2,
- *     "temperature": 22.15,
- *     "humidity": 65.3,
- *     "light": 12450.0,
- *     "soil_moisture": 42.5,
- *     "soil_raw": 2150
- *   },
- *   "valid": {
- *     "scd30": true,
- *     "bh1750": true,
- *     "soil": true
- *   }
- * }
+ * Statistics of one reading interval, with the reading they were
+ * averaged into (for its timestamp and msg_id).
  */
+struct StatsMessage {
+    ReadingRecord record;
+    WindowSummary summary;
+};
 
-String generateMessageID() {
-    uint64_t chipId = ESP.getEfuseMac();
-    uint32_t shortId = (uint32_t)(chipId & 0xFFFFFFFF);
-    char msgId[32];
-    snprintf(msgId, sizeof(msgId), "%08X-%04u-%05lu", shortId, bootCount, readingCount);
-    return String(msgId);
+/**
+ * Queue a record without blocking. Tracks the deepest backlog seen.
+ * Returns false (and counts a dropped reading) if the queue is full.
+ */
+static bool enqueue(QueueHandle_t queue, std::atomic<unsigned int>& peak, const ReadingRecord& record) {
+    if (xQueueSend(queue, &record, 0) != pdTRUE) {
+        droppedCount++;
+        return false;
+    }
+    unsigned int depth = uxQueueMessagesWaiting(queue);
+    if (depth > peak) peak = depth;
+    return true;
 }
-String buildDataPayload(const SensorData& data) {
-    JsonDocument doc;
 
-    doc["device"] = DEVICE_ID;
-    doc["msg_id"] = generateMessageID();
-    doc["timestamp"] = TimeManager::getISO8601();
-    doc["reading"] = readingCount;
+/**
+ * Give a reading taken before NTP sync its wall-clock time, once the
+ * clock is set. Readings from earlier boots keep the placeholder.
+ */
+static void resolveTime(ReadingRecord& record) {
+    RecordCodec::resolveUptime(record, bootCount, TimeManager::getBootEpoch());
+}
 
-    JsonObject sensors = doc["sensors"].to<JsonObject>();
-    if (data.scd30Valid) {
-        sensors["co2"] = serialized(String(data.co2, 1));
-        sensors["temperature"] = serialized(String(data.temperature, 2));
-        sensors["humidity"] = serialized(String(data.humidity, 1));
-    }
-    if (data.bh1750Valid) {
-        sensors["light"] = serialized(String(data.light, 1));
-    }
-    if (data.soilValid) {
-        sensors["soil_moisture"] = serialized(String(data.soilMoisture, 1));
-        sensors["soil_raw"] = data.soilRaw;
+/**
+ * Publish buffered readings as one JSON array on the data topic.
+ * Adds readings until MQTT_BATCH_BYTES is reached; corrupted records
+ * are skipped but still counted so they leave the buffer.
+ * Returns number of records taken (0 on failure).
+ */
+unsigned int publishBufferedBatch(ReadingRecord* records, unsigned int count, uint16_t& packetId) {
+    packetId = 0;
+    PoolBuffer batch(MQTT_BATCH_BYTES);
+    if (!batch) return 0;
+
+    for (unsigned int i = 0; i < count; i++) {
+        if (RecordCodec::isValid(records[i])) resolveTime(records[i]);
     }
 
-    JsonObject valid = doc["valid"].to<JsonObject>();
-    valid["scd30"] = data.scd30Valid;
-    valid["bh1750"] = data.bh1750Valid;
-    valid["soil"] = data.soilValid;
+    unsigned int taken = 0;
+    size_t length = Payload::writeBatch(batch.data(), batch.size(), records, count, taken);
 
-    String output;
-    serializeJson(doc, output);
-    return output;
+    if (length > 0) {
+        packetId = MQTTManager::publishBatch(batch.data(), length);
+        if (!packetId) return 0;
+    }
+    return taken;
 }
 
 /**
- * Build device status payload.
+ * Build device status payload. The first one after boot also
+ * carries the boot phase timings.
  */
-String buildStatusPayload() {
+String buildStatusPayload(bool bootReport = false) {
     JsonDocument doc;
 
     doc["device"] = DEVICE_ID;
@@ -108,12 +154,35 @@ String buildStatusPayload() {
     doc["location"] = LOCATION;
     doc["timestamp"] = TimeManager::getISO8601();
     doc["uptime_sec"] = TimeManager::getUptime();
-    doc["readings"] = readingCount;
-    doc["publish_failures"] = publishFailCount;
+    doc["readings"] = readingCount.load();
+    doc["publish_failures"] = publishFailCount.load();
     doc["wifi_rssi"] = WiFiManager::getRSSI();
     doc["wifi_ip"] = WiFiManager::getIP();
+    doc["wifi_connect_ms"] = WiFiManager::getLastConnectTime();
+    doc["wifi_reconnects"] = WiFiManager::getReconnectCount();
+    doc["network_stall_ms"] = networkStallMax.exchange(0);
     doc["free_heap"] = ESP.getFreeHeap();
+    Diagnostics::addStatus(doc);
     doc["is_time_synced"] = TimeManager::isSynced() ? 1 : 0;
+    doc["soil_noise"] = SensorManager::getSoilNoise();
+
+    // Cost of the last broker connection
+    const TLSStats& tls = MQTTManager::getTLSStats();
+    JsonObject conn = doc["mqtt_connect"].to<JsonObject>();
+    conn["handshake_ms"] = tls.handshakeMs;
+    conn["heap_peak"] = tls.heapPeak;
+    conn["tls_resumed"] = tls.resumed;
+    conn["tls_full"] = tls.fullHandshakes;
+    conn["tls_resumed_count"] = tls.resumedHandshakes;
+    conn["session_present"] = MQTTManager::isSessionPresent();
+
+    // Readings held back by the deadband
+    unsigned long checked = Deadband::getChecked();
+    unsigned long suppressed = Deadband::getSuppressed();
+    JsonObject deadband = doc["deadband"].to<JsonObject>();
+    deadband["published"] = checked - suppressed;
+    deadband["suppressed"] = suppressed;
+    deadband["ratio"] = checked ? (float)suppressed / checked : 0.0f;
 
     // SD card status
     JsonObject sd = doc["sd_card"].to<JsonObject>();
@@ -122,6 +191,47 @@ String buildStatusPayload() {
         sd["total_mb"] = SDManager::getTotalBytes() / (1024 * 1024);
         sd["used_mb"] = SDManager::getUsedBytes() / (1024 * 1024);
         sd["buffered"] = SDManager::getBufferCount();
+        sd["buffered_kb"] = SDManager::getBufferBytes() / 1024;
+        sd["oldest_buffered"] = SDManager::getOldestBufferedEpoch();
+        sd["awaiting_ack"] = Outbox::pending();
+        sd["archive_kb"] = SDManager::getArchiveBytes() / 1024;
+        sd["deleted_days"] = Retention::getDeletedDays();
+        sd["dropped_unsent"] = Retention::getDroppedReadings();
+    }
+
+    if (bootReport) {
+        JsonObject boot = doc["boot_ms"].to<JsonObject>();
+        boot["sensors"] = bootTimes.sensors;
+        boot["sd"] = bootTimes.sd;
+        boot["first_reading"] = firstReadingTime.load();
+        boot["wifi"] = bootTimes.wifi;
+        boot["ntp"] = bootTimes.ntp;
+        boot["mqtt"] = bootTimes.mqtt;
+    }
+
+    // Pipeline queue depths (now and peak since boot)
+    JsonObject pipeline = doc["pipeline"].to<JsonObject>();
+    pipeline["reading_queue"] = uxQueueMessagesWaiting(readingQueue);
+    pipeline["reading_queue_peak"] = readingQueuePeak.load();
+    pipeline["publish_queue"] = uxQueueMessagesWaiting(publishQueue);
+    pipeline["publish_queue_peak"] = publishQueuePeak.load();
+    pipeline["dropped"] = droppedCount.load();
+
+    // Transient buffers (see buffer_pool.h)
+    JsonObject pool = doc["buffer_pool"].to<JsonObject>();
+    pool["in_use"] = BufferPool::inUse();
+    pool["peak"] = BufferPool::peak();
+    pool["misses"] = BufferPool::misses();
+
+    // Stage latencies since the last status: [p50, p99, max, count] (us)
+    JsonObject latency = doc["latency_us"].to<JsonObject>();
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        LatencySummary summary = Latency::take((LatencyStage)i);
+        JsonArray stage = latency[Latency::name((LatencyStage)i)].to<JsonArray>();
+        stage.add(summary.p50);
+        stage.add(summary.p99);
+        stage.add(summary.max);
+        stage.add(summary.count);
     }
 
     String output;
@@ -129,9 +239,244 @@ String buildStatusPayload() {
     return output;
 }
 
+/**
+ * Sensor task: step the sensor state machines every
+ * SENSOR_POLL_INTERVAL and take a reading of the latest values every
+ * SENSOR_READ_INTERVAL. Runs on a fixed schedule.
+ */
+static void sensorTask(void*) {
+    esp_task_wdt_add(nullptr);
+    TickType_t lastWake = xTaskGetTickCount();
+    TickType_t nextReading = lastWake + pdMS_TO_TICKS(SENSOR_WARMUP);
+
+    for (;;) {
+        esp_task_wdt_reset();
+        {
+            LatencyProbe probe(STAGE_SENSOR_POLL);
+            SensorManager::poll();
+        }
+
+        if ((int32_t)(xTaskGetTickCount() - nextReading) >= 0) {
+            nextReading += pdMS_TO_TICKS(SENSOR_READ_INTERVAL);
+            unsigned long reading = ++readingCount;
+
+            Serial.printf("\n=== Reading #%lu ===\n", reading);
+
+            // Until NTP syncs, stamp readings with uptime
+            StatsMessage stats;
+            SensorData data;
+            {
+                LatencyProbe probe(STAGE_SENSOR_READ);
+                data = SensorManager::read(&stats.summary);
+            }
+            bool synced = TimeManager::isSynced();
+            ReadingRecord record = RecordCodec::encode(data,
+                                                       synced ? TimeManager::getEpoch() : millis() / 1000,
+                                                       synced ? RECORD_FLAG_TIME : RECORD_FLAG_UPTIME,
+                                                       bootCount, reading);
+            if (firstReadingTime == 0) firstReadingTime = millis();
+
+            if (!enqueue(readingQueue, readingQueuePeak, record)) {
+                Serial.println("[WARN] Storage queue full. Reading dropped.");
+            }
+
+            // Only the latest interval's statistics are kept
+            stats.record = record;
+            xQueueOverwrite(statsQueue, &stats);
+        }
+
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SENSOR_POLL_INTERVAL));
+    }
+}
+
+/**
+ * Storage task: write each reading to the SD card first. Readings
+ * that cannot be saved are passed to the network task directly.
+ * Readings held back by the deadband are archived only.
+ */
+static void storageTask(void*) {
+    esp_task_wdt_add(nullptr);
+
+    for (;;) {
+        esp_task_wdt_reset();
+
+        ReadingRecord record;
+        if (xQueueReceive(readingQueue, &record, pdMS_TO_TICKS(1000)) != pdTRUE) continue;
+        resolveTime(record);
+
+        // Log line only: skipped if the pool is exhausted
+        {
+            PoolBuffer payload(MQTT_BUFFER_SIZE);
+            if (payload) {
+                {
+                    LatencyProbe probe(STAGE_PAYLOAD);
+                    Payload::writeReading(payload.data(), payload.size(), record);
+                }
+                Serial.printf("[Data] %s\n", payload.data());
+            }
+        }
+
+        // Readings inside the deadband are only archived. Buffered
+        // readings go out through the outbox and stay on SD until the
+        // broker acknowledges them
+        bool publish = Deadband::shouldPublish(record);
+        bool saved;
+        {
+            LatencyProbe probe(STAGE_SD_WRITE);
+            saved = SDManager::writeReading(record, publish);
+        }
+        if (!saved) {
+            if (!publish) {
+                Serial.println("[WARN] SD archive write failed.");
+                continue;
+            }
+            Serial.println("[WARN] SD write failed. Data only in MQTT.");
+            if (!enqueue(publishQueue, publishQueuePeak, record)) {
+                Serial.println("[WARN] Publish queue full. Reading lost.");
+            }
+        } else if (publish && !mqttOnline) {
+            publishFailCount++;
+            Serial.printf("[WARN] MQTT offline (total: %lu). Data buffered on SD.\n", publishFailCount.load());
+        }
+    }
+}
+
+/**
+ * First status after boot: boot timings plus any init problems that
+ * could not be reported while MQTT was still down.
+ */
+static void publishBootStatus() {
+    String status = buildStatusPayload(true);
+    MQTTManager::publishStatus(status);
+    Serial.printf("[Status] %s\n", status.c_str());
+
+    if (!sensorsOK) MQTTManager::publishError("No sensors initialized at boot");
+    if (!sdOK) MQTTManager::publishError("SD card not available at boot");
+}
+
+/**
+ * Command topic: diagnostic requests are answered here, everything
+ * else goes to the archive replay.
+ */
+static void onCommand(const char* payload, size_t length) {
+    JsonDocument doc;
+    if (deserializeJson(doc, payload, length) == DeserializationError::Ok &&
+        strcmp(doc["cmd"] | "", "diag") == 0) {
+        Diagnostics::publishReport();
+        return;
+    }
+    Replay::onCommand(payload, length);
+}
+
+/**
+ * Network task: keep WiFi, MQTT and NTP up, send buffered readings
+ * and publish status. Reconnects may block here for seconds.
+ */
+static void networkTask(void*) {
+    esp_task_wdt_add(nullptr);
+    unsigned long lastStatusPublish = millis();
+
+    for (;;) {
+        esp_task_wdt_reset();
+        unsigned long loopStart = millis();
+        unsigned long loopStartUs = micros();
+        Diagnostics::beginLoop();
+
+        // Maintain connections
+        {
+            LatencyProbe probe(STAGE_WIFI);
+            WiFiManager::maintain();
+        }
+        {
+            LatencyProbe probe(STAGE_MQTT);
+            MQTTManager::maintain();
+        }
+        {
+            LatencyProbe probe(STAGE_NTP);
+            TimeManager::maintain();
+        }
+        mqttOnline = MQTTManager::isConnected();
+
+        // Boot phases; the first connection reports them with status
+        if (!bootTimes.wifi && WiFiManager::isConnected()) bootTimes.wifi = millis();
+        if (!bootTimes.ntp && TimeManager::isSynced()) bootTimes.ntp = millis();
+        if (!bootTimes.mqtt && mqttOnline) {
+            bootTimes.mqtt = millis();
+            publishBootStatus();
+            lastStatusPublish = millis();
+        }
+
+        // Readings that could not be saved to SD: publish directly.
+        // Without a pool slot they stay queued until the next loop
+        if (uxQueueMessagesWaiting(publishQueue) > 0) {
+            PoolBuffer payload(MQTT_BUFFER_SIZE);
+            ReadingRecord record;
+            while (payload && xQueueReceive(publishQueue, &record, 0) == pdTRUE) {
+                resolveTime(record);
+                size_t length = Payload::writeReading(payload.data(), payload.size(), record);
+                if (!MQTTManager::publishData(payload.data(), length)) {
+                    publishFailCount++;
+                    Serial.printf("[WARN] MQTT publish failed (total: %lu). Reading lost.\n", publishFailCount.load());
+                }
+            }
+        }
+
+        // Statistics are for live control and are not buffered: sent
+        // if online, otherwise replaced by the next interval's
+        if (mqttOnline && uxQueueMessagesWaiting(statsQueue) > 0) {
+            PoolBuffer statsPayload(MQTT_STATS_BYTES);
+            StatsMessage stats;
+            if (statsPayload && xQueueReceive(statsQueue, &stats, 0) == pdTRUE) {
+                resolveTime(stats.record);
+                size_t length = Payload::writeStats(statsPayload.data(), statsPayload.size(),
+                                                    stats.record, stats.summary);
+                if (length) MQTTManager::publishStats(statsPayload.data(), length);
+            }
+        }
+
+        // Send buffered readings, keeping several batches in flight
+        {
+            LatencyProbe probe(STAGE_OUTBOX);
+            if (!Outbox::service(publishBufferedBatch)) {
+                publishFailCount++;
+            }
+        }
+
+        // Archive replay requested by the server, after live readings
+        if (mqttOnline) {
+            LatencyProbe probe(STAGE_REPLAY);
+            Replay::service();
+        }
+
+        // SD budgets; the buffer is only trimmed with nothing in flight
+        {
+            LatencyProbe probe(STAGE_RETENTION);
+            Retention::service(Outbox::pending() == 0);
+        }
+
+        // Publish status every 5 minutes
+        if (millis() - lastStatusPublish >= STATUS_INTERVAL) {
+            lastStatusPublish = millis();
+            String status = buildStatusPayload();
+            MQTTManager::publishStatus(status);
+            Serial.printf("[Status] %s\n", status.c_str());
+        }
+
+        unsigned long stall = millis() - loopStart;
+        if (stall > networkStallMax) networkStallMax = stall;
+        Latency::record(STAGE_NETWORK_LOOP, micros() - loopStartUs);
+        Diagnostics::endLoop();
+
+        // Small delay to prevent tight looping
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+}
+
+// Host tests (pio test) bring their own setup()
+#ifndef PIO_UNIT_TESTING
+
 void setup() {
     Serial.begin(115200);
-    delay(1000);
 
     Preferences prefs;
     prefs.begin("greenhouse", false);
@@ -145,115 +490,64 @@ void setup() {
     Serial.println("  Location: " LOCATION);
     Serial.println("========================================");
 
-    // Phase 1: Network connectivity
-    Serial.println("\n--- Phase 1: WiFi ---");
-    WiFiManager::init();
-
-    Serial.println("\n--- Phase 2: Time Sync ---");
-    TimeManager::init();
-
-    Serial.println("\n--- Phase 3: MQTT ---");
-    MQTTManager::init();
-
-    // Phase 2: Sensors
-    Serial.println("\n--- Phase 4: Sensors ---");
-    bool sensorsOK = SensorManager::init();
+    // Phase 1: Sensors. The I2C buses come up before SPI, and the
+    // SCD30 before the SD card (see README, Initialization Order)
+    Serial.println("\n--- Phase 1: Sensors ---");
+    sensorsOK = SensorManager::init();
     if (!sensorsOK) {
         Serial.println("[WARN] No sensors initialized! Check wiring.");
-        MQTTManager::publishError("No sensors initialized at boot");
     }
+    bootTimes.sensors = millis();
 
-    // Phase 3: SD Card
-    Serial.println("\n--- Phase 5: SD Card ---");
-    bool sdOK = SDManager::init();
+    // Phase 2: SD Card
+    Serial.println("\n--- Phase 2: SD Card ---");
+    sdOK = SDManager::init();
     if (!sdOK) {
         Serial.println("[WARN] SD card not available. No local backup.");
-        MQTTManager::publishError("SD card not available at boot");
     }
+    bootTimes.sd = millis();
 
-    // Enable watchdog timer
+#ifdef BENCHMARK
+    Bench::run();
+    return;
+#endif
+
+    // Enable watchdog timer; each task subscribes itself
     esp_task_wdt_init(WATCHDOG_TIMEOUT, true);
-    esp_task_wdt_add(NULL);
+
+    readingQueue = xQueueCreate(READING_QUEUE_LENGTH, sizeof(ReadingRecord));
+    publishQueue = xQueueCreate(READING_QUEUE_LENGTH, sizeof(ReadingRecord));
+    statsQueue = xQueueCreate(1, sizeof(StatsMessage));
+
+    // Start sampling before the network is up
+    TaskHandle_t task = nullptr;
+    xTaskCreatePinnedToCore(sensorTask, "sensor", SENSOR_TASK_STACK, nullptr,
+                            SENSOR_TASK_PRIORITY, &task, SENSOR_TASK_CORE);
+    Diagnostics::addTask("sensor", task);
+    xTaskCreatePinnedToCore(storageTask, "storage", STORAGE_TASK_STACK, nullptr,
+                            STORAGE_TASK_PRIORITY, &task, STORAGE_TASK_CORE);
+    Diagnostics::addTask("storage", task);
+
+    // Phase 3: Network, completed in the background by the network task
+    Serial.println("\n--- Phase 3: WiFi / Time / MQTT ---");
+    WiFiManager::init();
+    TimeManager::init();
+    MQTTManager::setAckCallback(Outbox::onAck);
+    MQTTManager::setCommandCallback(onCommand);
+    MQTTManager::init();
 
     Serial.println("\n--- Setup Complete ---");
     Serial.printf("Sensor interval: %d ms\n", SENSOR_READ_INTERVAL);
     Serial.printf("Status interval: %d ms\n", STATUS_INTERVAL);
-    Serial.println("Entering main loop...\n");
 
-    // Publish initial status
-    MQTTManager::publishStatus(buildStatusPayload());
+    xTaskCreatePinnedToCore(networkTask, "network", NETWORK_TASK_STACK, nullptr,
+                            NETWORK_TASK_PRIORITY, &task, NETWORK_TASK_CORE);
+    Diagnostics::addTask("network", task);
 }
 
 void loop() {
-    // Reset watchdog
-    esp_task_wdt_reset();
-
-    // Maintain connections
-    WiFiManager::maintain();
-    MQTTManager::maintain();
-    TimeManager::maintain();
-
-    unsigned long now = millis();
-
-    // Read and publish sensor data every 60 seconds
-    if (now - lastSensorRead >= SENSOR_READ_INTERVAL) {
-        lastSensorRead = now;
-        readingCount++;
-
-        Serial.printf("\n=== Reading #%lu ===\n", readingCount);
-
-        // Read all sensors
-        SensorData data = SensorManager::read();
-
-        // Build JSON payload
-        String payload = buildDataPayload(data);
-        Serial.printf("[Data] %s\n", payload.c_str());
-
-        // STEP 1: Write to SD card first (local backup)
-        bool savedToSD = SDManager::writeReading(payload);
-        if (!savedToSD) {
-            Serial.println("[WARN] SD write failed. Data only in MQTT.");
-        }
-
-        // STEP 2: Try MQTT publish
-        if (MQTTManager::isConnected()) {
-            if (MQTTManager::publishData(payload)) {
-                // Published successfully. Remove from SD buffer.
-                if (savedToSD) {
-                    SDManager::removeOldestBuffered();
-                }
-            } else {
-                publishFailCount++;
-                Serial.printf("[WARN] MQTT publish failed (total: %lu). Data safe on SD.\n", publishFailCount);
-            }
-        } else {
-            publishFailCount++;
-            Serial.printf("[WARN] MQTT offline (total: %lu). Data buffered on SD.\n", publishFailCount);
-        }
-
-        // STEP 3: Flush old buffered readings if MQTT is back
-        if (MQTTManager::isConnected() && SDManager::getBufferCount() > 0) {
-            Serial.printf("[Buffer] Flushing %lu buffered readings...\n", SDManager::getBufferCount());
-            unsigned int flushed = SDManager::flushBuffer(
-                [](const String& p) -> bool {
-                    return MQTTManager::publishData(p);
-                },
-                SD_FLUSH_BATCH
-            );
-            if (flushed > 0) {
-                Serial.printf("[Buffer] Flushed %u readings\n", flushed);
-            }
-        }
-    }
-
-    // Publish status every 5 minutes
-    if (now - lastStatusPublish >= STATUS_INTERVAL) {
-        lastStatusPublish = now;
-        String status = buildStatusPayload();
-        MQTTManager::publishStatus(status);
-        Serial.printf("[Status] %s\n", status.c_str());
-    }
-
-    // Small delay to prevent tight looping
-    delay(10);
+    // All work runs in the tasks started by setup()
+    vTaskDelete(nullptr);
 }
+
+#endif // PIO_UNIT_TESTING
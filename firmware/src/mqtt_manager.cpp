@@ -1,13 +1,23 @@
 /**
  * mqtt_manager.cpp - MQTT client with TLS support
  * 
- * Uses WiFiClientSecure for encrypted connections.
+ * Connects through Hal::networkClient(): TLSClient on the board, which
+ * resumes the previous TLS session on reconnect. Connects with cleanSession=false (see
+ * MQTT_CLEAN_SESSION) so the broker keeps our session too.
  * Handles automatic reconnection with backoff.
+ * 
+ * PubSubClient only publishes at QoS 0, so sensor data is framed as a
+ * QoS 1 PUBLISH here and written through the client. PubSubClient
+ * ignores the PUBACKs that come back; AckClient picks them out of the
+ * byte stream it reads and reports the packet IDs. The command
+ * SUBSCRIBE is framed here too, so every packet ID on the connection
+ * comes from one counter and PubSubClient never picks its own.
  */
 
 #include "mqtt_manager.h"
 #include "config.h"
-#include <WiFiClientSecure.h>
+#include "wifi_manager.h"
+#include "hal.h"
 #include <PubSubClient.h>
 
 // Root CA certificate for your MQTT broker
@@ -34,15 +44,201 @@ qANiNNoawRyh/AWuxt+YJ0hwQTsa
 -----END CERTIFICATE-----
 )EOF";
 
-static WiFiClientSecure espClient;
-static PubSubClient mqttClient(espClient);
+#define MQTT_PUBLISH_QOS1  0x32     // PUBLISH, QoS 1, no retain
+#define MQTT_SUBSCRIBE     0x82
+#define MQTT_PUBACK        0x40
+#define MQTT_CONNACK       0x20
+
+/**
+ * Pass-through network client that watches incoming MQTT packets
+ * for PUBACKs and the CONNACK session-present flag.
+ */
+class AckClient : public Client {
+public:
+    explicit AckClient(Client& inner) : inner(inner) {}
+
+    int connect(IPAddress ip, uint16_t port) override { resetParser(); return inner.connect(ip, port); }
+    int connect(const char* host, uint16_t port) override { resetParser(); return inner.connect(host, port); }
+    size_t write(uint8_t b) override { return inner.write(b); }
+    size_t write(const uint8_t* buf, size_t size) override { return inner.write(buf, size); }
+    int available() override { return inner.available(); }
+    int peek() override { return inner.peek(); }
+    void flush() override { inner.flush(); }
+    void stop() override { inner.stop(); }
+    uint8_t connected() override { return inner.connected(); }
+    operator bool() override { return (bool)inner; }
+
+    int read() override {
+        int c = inner.read();
+        if (c >= 0) feed((uint8_t)c);
+        return c;
+    }
+
+    int read(uint8_t* buf, size_t size) override {
+        int n = inner.read(buf, size);
+        for (int i = 0; i < n; i++) feed(buf[i]);
+        return n;
+    }
+
+    void (*onPuback)(uint16_t packetId) = nullptr;
+    bool sessionPresent = false;
+
+private:
+    Client& inner;
+    enum { HEADER, LENGTH, BODY } state = HEADER;
+    uint8_t type = 0;
+    uint32_t remaining = 0;
+    uint32_t multiplier = 1;
+    uint32_t bodyPos = 0;
+    uint16_t packetId = 0;
+
+    void resetParser() { state = HEADER; }
+
+    // Track packet boundaries: fixed header byte, variable-length
+    // remaining length, then the body
+    void feed(uint8_t b) {
+        switch (state) {
+        case HEADER:
+            type = b;
+            remaining = 0;
+            multiplier = 1;
+            state = LENGTH;
+            break;
+        case LENGTH:
+            remaining += (b & 0x7F) * multiplier;
+            multiplier <<= 7;
+            if (b & 0x80) break;
+            bodyPos = 0;
+            packetId = 0;
+            state = remaining ? BODY : HEADER;
+            break;
+        case BODY:
+            if (bodyPos < 2) packetId = (packetId << 8) | b;
+            if (++bodyPos < remaining) break;
+            if (type == MQTT_PUBACK && remaining == 2 && onPuback) onPuback(packetId);
+            // CONNACK body: flags, return code
+            if (type == MQTT_CONNACK && remaining == 2) sessionPresent = (packetId >> 8) & 0x01;
+            state = HEADER;
+            break;
+        }
+    }
+};
+
+static AckClient ackClient(Hal::networkClient());
+static PubSubClient mqttClient(ackClient);
 static unsigned long lastReconnectAttempt = 0;
 static int reconnectCount = 0;
+static uint16_t lastPacketId = 0;
+static void (*commandCallback)(const char* payload, size_t length) = nullptr;
 
-// MQTT callback for incoming messages (if needed)
+// MQTT callback for incoming messages
 static void mqttCallback(char* topic, byte* payload, unsigned int length) {
     Serial.printf("[MQTT] Message on topic: %s\n", topic);
-    // Handle incoming commands here if needed
+    if (strcmp(topic, MQTT_TOPIC_COMMAND) == 0 && commandCallback) {
+        commandCallback((const char*)payload, length);
+    }
+}
+
+/**
+ * Packet ID for the next PUBLISH or SUBSCRIBE (never 0).
+ */
+static uint16_t nextPacketId() {
+    if (++lastPacketId == 0) lastPacketId = 1;
+    return lastPacketId;
+}
+
+/**
+ * Append the MQTT remaining length to 'header' at 'pos'.
+ */
+static size_t writeRemainingLength(uint8_t* header, size_t pos, size_t remaining) {
+    do {
+        uint8_t digit = remaining & 0x7F;
+        remaining >>= 7;
+        header[pos++] = remaining ? (digit | 0x80) : digit;
+    } while (remaining);
+    return pos;
+}
+
+/**
+ * Drop a connection left with a partly written packet: the broker
+ * would read the next packet's bytes as the rest of this one.
+ * Stops the socket without a DISCONNECT packet, which could not be
+ * framed either and would suppress the will. PubSubClient sees the
+ * closed socket and maintain() reconnects.
+ */
+static void abortConnection() {
+    Serial.println("[MQTT] Short write, dropping the connection");
+    ackClient.stop();
+}
+
+/**
+ * Write a QoS 1 PUBLISH for 'payload' to 'topic'.
+ * Returns the packet ID, or 0 if the write failed.
+ */
+static uint16_t publishQoS1(const char* topic, const uint8_t* payload, size_t length) {
+    size_t topicLen = strlen(topic);
+    uint8_t header[5 + 2 + 64 + 2];
+    if (topicLen > 64) return 0;
+
+    uint16_t packetId = nextPacketId();
+
+    size_t pos = 0;
+    header[pos++] = MQTT_PUBLISH_QOS1;
+    pos = writeRemainingLength(header, pos, 2 + topicLen + 2 + length);
+    header[pos++] = topicLen >> 8;
+    header[pos++] = topicLen & 0xFF;
+    memcpy(header + pos, topic, topicLen);
+    pos += topicLen;
+    header[pos++] = packetId >> 8;
+    header[pos++] = packetId & 0xFF;
+
+    if (mqttClient.write(header, pos) != pos || mqttClient.write(payload, length) != length) {
+        abortConnection();
+        return 0;
+    }
+    return packetId;
+}
+
+/**
+ * Write a SUBSCRIBE for 'topic' at 'qos'. PubSubClient ignores the
+ * SUBACK. Returns false if the write failed.
+ */
+static bool subscribe(const char* topic, uint8_t qos) {
+    size_t topicLen = strlen(topic);
+    uint8_t packet[5 + 2 + 2 + 64 + 1];
+    if (topicLen > 64) return false;
+
+    uint16_t packetId = nextPacketId();
+
+    size_t pos = 0;
+    packet[pos++] = MQTT_SUBSCRIBE;
+    pos = writeRemainingLength(packet, pos, 2 + 2 + topicLen + 1);
+    packet[pos++] = packetId >> 8;
+    packet[pos++] = packetId & 0xFF;
+    packet[pos++] = topicLen >> 8;
+    packet[pos++] = topicLen & 0xFF;
+    memcpy(packet + pos, topic, topicLen);
+    pos += topicLen;
+    packet[pos++] = qos;
+
+    if (mqttClient.write(packet, pos) != pos) {
+        abortConnection();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Publish at QoS 0, streamed to the socket: status and diagnostic
+ * messages outgrow MQTT_BUFFER_SIZE.
+ */
+static bool publishStreamed(const char* topic, const String& payload, bool retain) {
+    if (!mqttClient.beginPublish(topic, payload.length(), retain) ||
+        mqttClient.write((const uint8_t*)payload.c_str(), payload.length()) != payload.length()) {
+        abortConnection();
+        return false;
+    }
+    return mqttClient.endPublish();
 }
 
 static bool connectToBroker() {
@@ -58,13 +254,19 @@ static bool connectToBroker() {
         MQTT_TOPIC_STATUS,          // Will topic
         MQTT_QOS,                   // Will QoS
         true,                       // Will retain
-        willPayload.c_str()         // Will message
+        willPayload.c_str(),        // Will message
+        MQTT_CLEAN_SESSION          // Keep the session on the broker
     );
 
     if (connected) {
-        Serial.println("[MQTT] Connected!");
+        Serial.printf("[MQTT] Connected! (%s session)\n", ackClient.sessionPresent ? "resumed" : "new");
         reconnectCount = 0;
 
+        // A resumed session already has the subscription, plus any
+        // commands sent while we were offline; subscribing again is
+        // harmless
+        subscribe(MQTT_TOPIC_COMMAND, MQTT_QOS);
+
         // Publish online status
         String onlineMsg = "{\"device\":\"" + String(DEVICE_ID) + "\",\"status\":\"online\",\"firmware\":\"" + String(FIRMWARE_VERSION) + "\"}";
         mqttClient.publish(MQTT_TOPIC_STATUS, onlineMsg.c_str(), true);
@@ -78,17 +280,14 @@ static bool connectToBroker() {
 
 void MQTTManager::init() {
     // Configure TLS
-    espClient.setCACert(ROOT_CA);
-
-    // For development/testing without certificate verification:
-    // espClient.setInsecure();    // REMOVE THIS IN PRODUCTION
+    Hal::setRootCA(ROOT_CA);
 
     mqttClient.setServer(MQTT_BROKER, MQTT_PORT);
     mqttClient.setCallback(mqttCallback);
     mqttClient.setBufferSize(MQTT_BUFFER_SIZE);
     mqttClient.setKeepAlive(MQTT_KEEPALIVE);
 
-    connectToBroker();
+    // The first connection attempt is made by maintain()
 }
 
 bool MQTTManager::maintain() {
@@ -97,11 +296,16 @@ bool MQTTManager::maintain() {
         return true;
     }
 
+    // No point trying until WiFi is back
+    if (!WiFiManager::isConnected()) {
+        return false;
+    }
+
     // Exponential backoff for reconnection
     unsigned long now = millis();
     unsigned long backoff = min((unsigned long)(2000 * (1 << reconnectCount)), (unsigned long)30000);
 
-    if (now - lastReconnectAttempt < backoff) {
+    if (reconnectCount > 0 && now - lastReconnectAttempt < backoff) {
         return false;
     }
 
@@ -123,24 +327,54 @@ bool MQTTManager::maintain() {
     return false;
 }
 
-bool MQTTManager::publishData(const String& payload) {
+bool MQTTManager::publishData(const char* payload, size_t length) {
     if (!mqttClient.connected()) {
         Serial.println("[MQTT] Not connected. Data not published.");
         return false;
     }
 
-    bool success = mqttClient.publish(MQTT_TOPIC_DATA, payload.c_str(), false);
+    bool success = publishQoS1(MQTT_TOPIC_DATA, (const uint8_t*)payload, length) != 0;
     if (success) {
-        Serial.printf("[MQTT] Data published (%d bytes)\n", payload.length());
+        Serial.printf("[MQTT] Data published (%u bytes)\n", (unsigned int)length);
     } else {
         Serial.println("[MQTT] Publish failed!");
     }
     return success;
 }
 
+bool MQTTManager::publishStats(const char* payload, size_t length) {
+    if (!mqttClient.connected()) return false;
+    return publishQoS1(MQTT_TOPIC_STATS, (const uint8_t*)payload, length) != 0;
+}
+
+uint16_t MQTTManager::publishBatch(const char* payload, size_t length) {
+    if (!mqttClient.connected()) return 0;
+
+    uint16_t packetId = publishQoS1(MQTT_TOPIC_DATA, (const uint8_t*)payload, length);
+    if (packetId) {
+        Serial.printf("[MQTT] Batch %u sent (%u bytes)\n", packetId, (unsigned int)length);
+    } else {
+        Serial.println("[MQTT] Batch publish failed!");
+    }
+    return packetId;
+}
+
+bool MQTTManager::publishReplay(const char* payload, size_t length) {
+    if (!mqttClient.connected()) return false;
+    return publishQoS1(MQTT_TOPIC_REPLAY, (const uint8_t*)payload, length) != 0;
+}
+
+void MQTTManager::setAckCallback(void (*callback)(uint16_t packetId)) {
+    ackClient.onPuback = callback;
+}
+
+void MQTTManager::setCommandCallback(void (*callback)(const char* payload, size_t length)) {
+    commandCallback = callback;
+}
+
 bool MQTTManager::publishStatus(const String& payload) {
     if (!mqttClient.connected()) return false;
-    return mqttClient.publish(MQTT_TOPIC_STATUS, payload.c_str(), true);
+    return publishStreamed(MQTT_TOPIC_STATUS, payload, true);
 }
 
 bool MQTTManager::publishError(const String& errorMsg) {
@@ -149,6 +383,23 @@ bool MQTTManager::publishError(const String& errorMsg) {
     return mqttClient.publish(MQTT_TOPIC_ERROR, payload.c_str(), false);
 }
 
+bool MQTTManager::publishDiagnostics(const String& payload) {
+    if (!mqttClient.connected()) return false;
+    return publishStreamed(MQTT_TOPIC_DIAG, payload, false);
+}
+
+void MQTTManager::disconnect() {
+    mqttClient.disconnect();
+}
+
 bool MQTTManager::isConnected() {
     return mqttClient.connected();
 }
+
+bool MQTTManager::isSessionPresent() {
+    return mqttClient.connected() && ackClient.sessionPresent;
+}
+
+const TLSStats& MQTTManager::getTLSStats() {
+    return Hal::networkStats();
+}
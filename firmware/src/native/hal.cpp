@@ -0,0 +1,63 @@
+/**
+ * hal.cpp - Hardware abstraction on the host build
+ *
+ * NATIVE_SD_DIR in the working directory stands in for the SD card
+ * and its size is that of the filesystem holding it. The broker
+ * connection is a plain TCP socket (MQTT_BROKER/MQTT_PORT of the
+ * host build, see config.h).
+ */
+
+#include "hal.h"
+#include "config.h"
+#include <SocketClient.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+static fs::FS hostFs(NATIVE_SD_DIR);
+static TLSStats stats = {};
+
+bool Hal::mountStorage() {
+    mkdir(NATIVE_SD_DIR, 0755);
+    struct stat st;
+    if (stat(NATIVE_SD_DIR, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        Serial.println("FAILED! Cannot create " NATIVE_SD_DIR);
+        return false;
+    }
+    return true;
+}
+
+fs::FS& Hal::storage() {
+    return hostFs;
+}
+
+const char* Hal::storageType() {
+    return "host";
+}
+
+uint64_t Hal::storageTotalBytes() {
+    struct statvfs vfs;
+    if (statvfs(NATIVE_SD_DIR, &vfs) != 0) return 0;
+    return (uint64_t)vfs.f_blocks * vfs.f_frsize;
+}
+
+uint64_t Hal::storageUsedBytes() {
+    struct statvfs vfs;
+    if (statvfs(NATIVE_SD_DIR, &vfs) != 0) return 0;
+    return (uint64_t)(vfs.f_blocks - vfs.f_bavail) * vfs.f_frsize;
+}
+
+Client& Hal::networkClient() {
+    static SocketClient client;
+    return client;
+}
+
+void Hal::setRootCA(const char* rootCA) {
+    (void)rootCA;
+}
+
+const TLSStats& Hal::networkStats() {
+    return stats;
+}
+
+void Hal::clearNetworkSession() {
+}
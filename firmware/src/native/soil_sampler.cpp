@@ -0,0 +1,47 @@
+/**
+ * soil_sampler.cpp - Simulated soil ADC for the host build
+ *
+ * Produces samples at SOIL_ADC_SAMPLE_RATE from the greenhouse model,
+ * as the DMA would, and keeps no more than the DMA buffers hold.
+ */
+
+#include "soil_sampler.h"
+#include "config.h"
+#include <Simulation.h>
+
+#define SOIL_DMA_CAPACITY 1024          // Samples the DMA buffers hold
+
+static unsigned long lastCollect = 0;
+static bool running = false;
+
+bool SoilSampler::begin() {
+    lastCollect = micros();
+    running = true;
+    Serial.printf("[Soil] Simulated ADC at %d Hz\n", SOIL_ADC_SAMPLE_RATE);
+    return true;
+}
+
+size_t SoilSampler::collect(uint16_t* samples, size_t maxCount) {
+    if (!running) return 0;
+
+    unsigned long now = micros();
+    size_t ready = (unsigned long long)(now - lastCollect) * SOIL_ADC_SAMPLE_RATE / 1000000UL;
+    if (ready == 0) return 0;
+    lastCollect = now;
+
+    size_t n = min(min(ready, (size_t)SOIL_DMA_CAPACITY), maxCount);
+    for (size_t i = 0; i < n; i++) {
+        float raw = Simulation::soilRaw();
+        samples[i] = (uint16_t)constrain(raw, 0.0f, 4095.0f);
+    }
+    return n;
+}
+
+float SoilSampler::toMillivolts(float raw) {
+    // Nominal curve of the 11 dB attenuation range
+    return constrain(raw, 0.0f, 4095.0f) * 3300.0f / 4095.0f;
+}
+
+bool SoilSampler::isDMA() {
+    return running;
+}
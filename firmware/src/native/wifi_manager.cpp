@@ -0,0 +1,39 @@
+/**
+ * wifi_manager.cpp - Network link on the host build
+ *
+ * The host is already on the network, so the link is always up.
+ */
+
+#include "wifi_manager.h"
+
+void WiFiManager::init() {
+    Serial.println("[WiFi] Host network");
+}
+
+bool WiFiManager::maintain() {
+    return true;
+}
+
+bool WiFiManager::isConnected() {
+    return true;
+}
+
+int WiFiManager::getRSSI() {
+    return 0;
+}
+
+String WiFiManager::getIP() {
+    return "127.0.0.1";
+}
+
+String WiFiManager::getMAC() {
+    return "00:00:00:00:00:00";
+}
+
+unsigned long WiFiManager::getLastConnectTime() {
+    return 0;
+}
+
+unsigned long WiFiManager::getReconnectCount() {
+    return 0;
+}
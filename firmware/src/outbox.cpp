@@ -0,0 +1,121 @@
+/**
+ * outbox.cpp - Acknowledged delivery of buffered readings
+ *
+ * The window is a ring of batches in send order. Batch i covers the
+ * buffered readings that follow those of batches 0..i-1, so new
+ * batches are read from SD after skipping 'pending' readings.
+ *
+ * Batch size adapts to the link: it grows by one after each full
+ * batch is acknowledged and halves on a send failure or timeout.
+ * After a failure nothing new is sent for MQTT_RETRY_DELAY.
+ */
+
+#include "outbox.h"
+#include "config.h"
+#include "mqtt_manager.h"
+#include "sd_manager.h"
+#include "buffer_pool.h"
+
+static_assert(SD_FLUSH_MAX_BATCH * sizeof(ReadingRecord) <= POOL_SMALL_BYTES,
+              "a full batch of records must fit a small pool slot");
+
+struct Batch {
+    uint16_t packetId;
+    uint16_t count;
+    unsigned long sentAt;
+    bool acked;
+};
+
+static Batch window[MQTT_INFLIGHT_WINDOW];
+static unsigned int first = 0;          // Index of the oldest batch
+static unsigned int batches = 0;        // Batches in the window
+static unsigned long pendingCount = 0;  // Readings covered by the window
+static unsigned int batchSize = SD_FLUSH_BATCH;
+static unsigned long lastFailure = 0;
+static bool failed = false;
+
+static Batch& slot(unsigned int i) {
+    return window[(first + i) % MQTT_INFLIGHT_WINDOW];
+}
+
+static void clearWindow() {
+    first = 0;
+    batches = 0;
+    pendingCount = 0;
+}
+
+static bool sendFailed() {
+    batchSize = batchSize > 1 ? batchSize / 2 : 1;
+    lastFailure = millis();
+    failed = true;
+    return false;
+}
+
+bool Outbox::service(SendBatch sendBatch) {
+    if (!MQTTManager::isConnected()) {
+        if (batches > 0) {
+            Serial.printf("[Outbox] Connection lost, %lu readings will be re-sent\n", pendingCount);
+            clearWindow();
+        }
+        return true;
+    }
+
+    // Remove acknowledged readings from SD, oldest batch first
+    while (batches > 0 && slot(0).acked) {
+        Batch& b = slot(0);
+        SDManager::removeBuffered(b.count);
+        pendingCount -= b.count;
+        if (b.count >= batchSize && batchSize < SD_FLUSH_MAX_BATCH) batchSize++;
+        first = (first + 1) % MQTT_INFLIGHT_WINDOW;
+        batches--;
+    }
+
+    if (batches > 0 && millis() - slot(0).sentAt >= MQTT_ACK_TIMEOUT) {
+        Serial.printf("[Outbox] No ack for batch %u, re-sending %lu readings\n",
+                      slot(0).packetId, pendingCount);
+        clearWindow();
+        return sendFailed();
+    }
+
+    if (failed && millis() - lastFailure < MQTT_RETRY_DELAY) return true;
+    failed = false;
+
+    if (batches >= MQTT_INFLIGHT_WINDOW || SDManager::getBufferCount() <= pendingCount) return true;
+
+    // Pool exhausted: the readings wait on SD until the next call
+    PoolBuffer buffer(SD_FLUSH_MAX_BATCH * sizeof(ReadingRecord));
+    if (!buffer) return true;
+    ReadingRecord* records = buffer.as<ReadingRecord>();
+
+    // Fill the window with the next unsent readings
+    while (batches < MQTT_INFLIGHT_WINDOW && SDManager::getBufferCount() > pendingCount) {
+        unsigned int read = SDManager::peekBuffered(records, batchSize, pendingCount);
+        if (read == 0) return sendFailed();
+
+        uint16_t packetId = 0;
+        unsigned int taken = sendBatch(records, read, packetId);
+        if (taken == 0) return sendFailed();
+
+        Batch& b = slot(batches);
+        b.packetId = packetId;
+        b.count = taken;
+        b.sentAt = millis();
+        b.acked = packetId == 0;    // Nothing to send (all corrupted)
+        batches++;
+        pendingCount += taken;
+    }
+    return true;
+}
+
+void Outbox::onAck(uint16_t packetId) {
+    for (unsigned int i = 0; i < batches; i++) {
+        if (slot(i).packetId == packetId) {
+            slot(i).acked = true;
+            return;
+        }
+    }
+}
+
+unsigned long Outbox::pending() {
+    return pendingCount;
+}
@@ -0,0 +1,203 @@
+/**
+ * payload.cpp - JSON payloads for sensor readings
+ *
+ * The output matches what ArduinoJson produced for the same reading:
+ * compact JSON, decimals per field from the channel table
+ * (co2 1, temperature 2, ...).
+ */
+
+#include "payload.h"
+#include "config.h"
+#include "time_manager.h"
+#include "sensor_channels.h"
+
+/**
+ * Appends text to a fixed buffer. Stops writing once full and
+ * remembers the overflow so the caller can discard the output.
+ */
+struct Writer {
+    char* buffer;
+    size_t size;
+    size_t length;
+    bool overflow;
+
+    Writer(char* buffer, size_t size) : buffer(buffer), size(size), length(0), overflow(size == 0) {}
+
+    void put(char c) {
+        if (length + 1 < size) buffer[length++] = c;
+        else overflow = true;
+    }
+
+    void text(const char* s) {
+        while (*s) put(*s++);
+    }
+
+    void number(uint32_t value, uint8_t minDigits = 1) {
+        char digits[10];
+        uint8_t n = 0;
+        do {
+            digits[n++] = '0' + value % 10;
+            value /= 10;
+        } while (value);
+        while (n < minDigits) digits[n++] = '0';
+        while (n) put(digits[--n]);
+    }
+
+    void hex(uint32_t value, uint8_t digits) {
+        static const char HEX_DIGITS[] = "0123456789ABCDEF";
+        while (digits) put(HEX_DIGITS[(value >> (4 * --digits)) & 0xF]);
+    }
+
+    // Fixed-point value with 'decimals' digits after the point,
+    // e.g. fixed(-525, 2) -> "-5.25"
+    void fixed(int32_t value, uint8_t decimals) {
+        uint32_t magnitude = value < 0 ? -(int64_t)value : value;
+        uint32_t scale = 1;
+        for (uint8_t i = 0; i < decimals; i++) scale *= 10;
+        if (value < 0) put('-');
+        number(magnitude / scale);
+        if (decimals == 0) return;
+        put('.');
+        number(magnitude % scale, decimals);
+    }
+
+    void boolean(bool value) {
+        text(value ? "true" : "false");
+    }
+
+    size_t finish() {
+        if (overflow) return 0;
+        buffer[length] = '\0';
+        return length;
+    }
+};
+
+/**
+ * Opening fields shared by all payloads about a reading, up to and
+ * including "reading"; the object is left open.
+ */
+static void writeHeader(Writer& out, const ReadingRecord& record) {
+    char timestamp[ISO8601_BUFFER_SIZE];
+    TimeManager::formatISO8601(timestamp, sizeof(timestamp), record.epoch, record.flags & RECORD_FLAG_TIME);
+
+    // msg_id: chip ID, boot count, reading number (unique per device)
+    uint32_t chipId = (uint32_t)(ESP.getEfuseMac() & 0xFFFFFFFF);
+
+    out.text("{\"device\":\"" DEVICE_ID "\",\"msg_id\":\"");
+    out.hex(chipId, 8);
+    out.put('-');
+    out.number(record.boot, 4);
+    out.put('-');
+    out.number(record.reading, 5);
+    out.text("\",\"timestamp\":\"");
+    out.text(timestamp);
+    out.text("\",\"reading\":");
+    out.number(record.reading);
+}
+
+size_t Payload::writeReading(char* buffer, size_t size, const ReadingRecord& record) {
+    Writer out(buffer, size);
+    writeHeader(out, record);
+
+    out.text(",\"sensors\":{");
+    bool first = true;
+    if (record.flags & RECORD_FLAG_SCD30) {
+        out.text("\"co2\":");
+        out.fixed(record.co2, CHANNELS[CH_CO2].decimals);
+        out.text(",\"temperature\":");
+        out.fixed(record.temperature, CHANNELS[CH_TEMPERATURE].decimals);
+        out.text(",\"humidity\":");
+        out.fixed(record.humidity, CHANNELS[CH_HUMIDITY].decimals);
+        first = false;
+    }
+    if (record.flags & RECORD_FLAG_BH1750) {
+        out.text(first ? "\"light\":" : ",\"light\":");
+        out.fixed(record.light, CHANNELS[CH_LIGHT].decimals);
+        first = false;
+    }
+    if (record.flags & RECORD_FLAG_SOIL) {
+        out.text(first ? "\"soil_moisture\":" : ",\"soil_moisture\":");
+        out.fixed(record.soilMoisture, CHANNELS[CH_SOIL_MOISTURE].decimals);
+        out.text(",\"soil_raw\":");
+        out.number(record.soilRaw);
+    }
+
+    out.text("},\"valid\":{\"scd30\":");
+    out.boolean(record.flags & RECORD_FLAG_SCD30);
+    out.text(",\"bh1750\":");
+    out.boolean(record.flags & RECORD_FLAG_BH1750);
+    out.text(",\"soil\":");
+    out.boolean(record.flags & RECORD_FLAG_SOIL);
+    out.text("}}");
+
+    return out.finish();
+}
+
+size_t Payload::writeBatch(char* buffer, size_t size, const ReadingRecord* records,
+                           unsigned int count, unsigned int& taken) {
+    taken = 0;
+    if (size < 3) return 0;
+
+    size_t length = 0;
+    unsigned int items = 0;
+    buffer[length++] = '[';
+
+    for (unsigned int i = 0; i < count; i++) {
+        if (RecordCodec::isValid(records[i])) {
+            // Room for a comma before and the closing bracket after
+            size_t start = length + (items > 0 ? 1 : 0);
+            if (start + 2 >= size) break;
+            size_t n = writeReading(buffer + start, size - start - 1, records[i]);
+            if (n == 0) break;
+            if (items > 0) buffer[length] = ',';
+            length = start + n;
+            items++;
+        }
+        taken++;
+    }
+
+    buffer[length++] = ']';
+    buffer[length] = '\0';
+    return items > 0 ? length : 0;
+}
+
+// JSON keys for each channel, in ChannelId order
+static const char* const CHANNEL_KEYS[CH_COUNT] = {
+    "co2", "temperature", "humidity", "light", "soil_moisture", "soil_raw"
+};
+
+size_t Payload::writeStats(char* buffer, size_t size, const ReadingRecord& record,
+                           const WindowSummary& summary) {
+    Writer out(buffer, size);
+    writeHeader(out, record);
+    out.text(",\"window_ms\":");
+    out.number(summary.durationMs);
+
+    out.text(",\"stats\":{");
+    bool first = true;
+    for (uint8_t i = 0; i < CH_COUNT; i++) {
+        const RunningStats& s = summary.channels[i];
+        if (s.count == 0) continue;
+        int32_t scale = CHANNELS[i].scale;
+        uint8_t decimals = CHANNELS[i].decimals;
+
+        if (!first) out.put(',');
+        first = false;
+        out.put('"');
+        out.text(CHANNEL_KEYS[i]);
+        out.text("\":{\"n\":");
+        out.number(s.count);
+        out.text(",\"mean\":");
+        out.fixed((int32_t)roundf(s.mean * scale), decimals);
+        out.text(",\"min\":");
+        out.fixed((int32_t)roundf(s.min * scale), decimals);
+        out.text(",\"max\":");
+        out.fixed((int32_t)roundf(s.max * scale), decimals);
+        out.text(",\"sd\":");
+        out.fixed((int32_t)roundf(s.stddev() * scale), decimals);
+        out.put('}');
+    }
+    out.text("}}");
+
+    return out.finish();
+}
@@ -0,0 +1,127 @@
+/**
+ * reading_record.cpp - Compact binary record for SD storage
+ */
+
+#include "reading_record.h"
+#include "checksum.h"
+#include "sensor_channels.h"
+#include <ArduinoJson.h>
+
+static uint32_t recordCRC(const ReadingRecord& record) {
+    return Checksum::crc32(&record, offsetof(ReadingRecord, crc));
+}
+
+/**
+ * Days since 1970-01-01 for a civil date (proleptic Gregorian).
+ */
+static int32_t daysFromCivil(int y, int m, int d) {
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+ReadingRecord RecordCodec::encode(const SensorData& data, uint32_t epoch, uint8_t clock,
+                                  uint16_t boot, uint32_t reading) {
+    ReadingRecord record = {};
+    record.version = RECORD_VERSION;
+    record.boot = boot;
+    record.epoch = epoch;
+    record.reading = reading;
+
+    float values[CH_COUNT] = {
+        data.co2, data.temperature, data.humidity,
+        data.light, data.soilMoisture, (float)data.soilRaw
+    };
+    int32_t fixed[CH_COUNT];
+    uint32_t inRange = Channels::convert(values, fixed);
+
+    // A sensor is valid only if all of its channels are in range
+    if (data.scd30Valid && (inRange & SCD30_CHANNELS) == SCD30_CHANNELS) record.flags |= RECORD_FLAG_SCD30;
+    if (data.bh1750Valid && (inRange & BH1750_CHANNELS) == BH1750_CHANNELS) record.flags |= RECORD_FLAG_BH1750;
+    if (data.soilValid && (inRange & SOIL_CHANNELS) == SOIL_CHANNELS) record.flags |= RECORD_FLAG_SOIL;
+    record.flags |= clock & (RECORD_FLAG_TIME | RECORD_FLAG_UPTIME);
+
+    // Clamp to the width of each record field
+    record.co2 = constrain(fixed[CH_CO2], 0, INT32_MAX);
+    record.temperature = constrain(fixed[CH_TEMPERATURE], INT16_MIN, INT16_MAX);
+    record.humidity = constrain(fixed[CH_HUMIDITY], 0, UINT16_MAX);
+    record.light = constrain(fixed[CH_LIGHT], 0, INT32_MAX);
+    record.soilMoisture = constrain(fixed[CH_SOIL_MOISTURE], INT16_MIN, INT16_MAX);
+    record.soilRaw = constrain(fixed[CH_SOIL_RAW], 0, UINT16_MAX);
+
+    record.crc = recordCRC(record);
+    return record;
+}
+
+SensorData RecordCodec::decode(const ReadingRecord& record) {
+    SensorData data = {};
+    data.co2 = (float)record.co2 / CHANNELS[CH_CO2].scale;
+    data.temperature = (float)record.temperature / CHANNELS[CH_TEMPERATURE].scale;
+    data.humidity = (float)record.humidity / CHANNELS[CH_HUMIDITY].scale;
+    data.light = (float)record.light / CHANNELS[CH_LIGHT].scale;
+    data.soilMoisture = (float)record.soilMoisture / CHANNELS[CH_SOIL_MOISTURE].scale;
+    data.soilRaw = record.soilRaw;
+    data.scd30Valid = record.flags & RECORD_FLAG_SCD30;
+    data.bh1750Valid = record.flags & RECORD_FLAG_BH1750;
+    data.soilValid = record.flags & RECORD_FLAG_SOIL;
+    return data;
+}
+
+bool RecordCodec::resolveUptime(ReadingRecord& record, uint16_t boot, uint32_t bootEpoch) {
+    if (!(record.flags & RECORD_FLAG_UPTIME) || record.boot != boot || bootEpoch == 0) {
+        return false;
+    }
+    record.epoch += bootEpoch;
+    record.flags = (record.flags & ~RECORD_FLAG_UPTIME) | RECORD_FLAG_TIME;
+    record.crc = recordCRC(record);
+    return true;
+}
+
+void RecordCodec::seal(ReadingRecord& record) {
+    record.crc = recordCRC(record);
+}
+
+bool RecordCodec::isValid(const ReadingRecord& record) {
+    return record.version == RECORD_VERSION && record.crc == recordCRC(record);
+}
+
+bool RecordCodec::fromJSON(const String& json, ReadingRecord& record) {
+    JsonDocument doc;
+    if (deserializeJson(doc, json) != DeserializationError::Ok) return false;
+    if (!doc["timestamp"].is<const char*>()) return false;
+
+    // "2026-03-15T14:30:00+02:00" -> UTC epoch
+    int y, mo, d, h, mi, s, oh, om;
+    char sign;
+    if (sscanf(doc["timestamp"].as<const char*>(), "%d-%d-%dT%d:%d:%d%c%d:%d",
+               &y, &mo, &d, &h, &mi, &s, &sign, &oh, &om) != 9) {
+        return false;
+    }
+    int32_t offset = (oh * 3600 + om * 60) * (sign == '-' ? -1 : 1);
+    int64_t epoch = (int64_t)daysFromCivil(y, mo, d) * 86400 + h * 3600 + mi * 60 + s - offset;
+
+    // msg_id is "<chip>-<boot>-<reading>"
+    unsigned int chip = 0, boot = 0;
+    unsigned long reading = doc["reading"] | 0UL;
+    if (doc["msg_id"].is<const char*>()) {
+        sscanf(doc["msg_id"].as<const char*>(), "%8X-%u-%lu", &chip, &boot, &reading);
+    }
+
+    SensorData data = {};
+    JsonObject sensors = doc["sensors"];
+    data.scd30Valid = doc["valid"]["scd30"] | false;
+    data.bh1750Valid = doc["valid"]["bh1750"] | false;
+    data.soilValid = doc["valid"]["soil"] | false;
+    data.co2 = sensors["co2"] | 0.0f;
+    data.temperature = sensors["temperature"] | 0.0f;
+    data.humidity = sensors["humidity"] | 0.0f;
+    data.light = sensors["light"] | 0.0f;
+    data.soilMoisture = sensors["soil_moisture"] | 0.0f;
+    data.soilRaw = sensors["soil_raw"] | 0;
+
+    record = encode(data, epoch > 0 ? (uint32_t)epoch : 0, y > 1970 ? RECORD_FLAG_TIME : 0, boot, reading);
+    return true;
+}
@@ -0,0 +1,157 @@
+/**
+ * replay.cpp - Re-send archived readings on request
+ *
+ * Runs in the network task: the command arrives through
+ * MQTTManager::maintain() and service() is called from the same loop,
+ * so the state needs no locking. Each batch is one bounded archive
+ * query, so the SD card is held only briefly and the storage task
+ * keeps writing live readings.
+ */
+
+#include "replay.h"
+#include "config.h"
+#include "sd_manager.h"
+#include "mqtt_manager.h"
+#include "payload.h"
+#include "buffer_pool.h"
+#include <ArduinoJson.h>
+
+static bool active = false;
+static String requestId = "";
+static uint32_t rangeStart = 0;
+static uint32_t rangeEnd = 0;
+static uint32_t position = 0;           // Epoch of the next reading to send
+static unsigned int sentAtPosition = 0; // Readings at 'position' already sent
+static unsigned long sentCount = 0;
+static unsigned long lastBatch = 0;
+static unsigned long lastProgress = 0;
+
+static ReadingRecord records[REPLAY_BATCH];
+static unsigned int fetched = 0;
+static unsigned int skipping = 0;
+
+/**
+ * Query callback. Readings sharing an epoch come back in the same
+ * order every time, so the ones at 'position' already sent are the
+ * first ones returned.
+ */
+static bool collect(const ReadingRecord& record) {
+    if (skipping > 0 && record.epoch == position) {
+        skipping--;
+        return true;
+    }
+    records[fetched++] = record;
+    return true;
+}
+
+static void report(const char* state) {
+    JsonDocument doc;
+    doc["device"] = DEVICE_ID;
+    if (requestId.length()) doc["id"] = requestId;
+    doc["state"] = state;
+    doc["from"] = rangeStart;
+    doc["to"] = rangeEnd;
+    doc["position"] = position;
+    doc["sent"] = sentCount;
+
+    char payload[256];
+    size_t length = serializeJson(doc, payload, sizeof(payload));
+    MQTTManager::publishReplay(payload, length);
+    Serial.printf("[Replay] %s\n", payload);
+    lastProgress = millis();
+}
+
+static void finish(const char* state) {
+    report(state);
+    active = false;
+}
+
+void Replay::onCommand(const char* payload, size_t length) {
+    JsonDocument doc;
+    if (deserializeJson(doc, payload, length) != DeserializationError::Ok) {
+        Serial.println("[Replay] Ignoring malformed command");
+        return;
+    }
+
+    const char* cmd = doc["cmd"] | "";
+    if (strcmp(cmd, "cancel") == 0) {
+        if (active) finish("cancelled");
+        return;
+    }
+    if (strcmp(cmd, "replay") != 0) return;
+
+    // A running replay is not replaced; the server can cancel it first
+    if (active) {
+        String running = requestId;
+        requestId = doc["id"] | "";
+        report("rejected");
+        requestId = running;
+        return;
+    }
+
+    requestId = doc["id"] | "";
+    rangeStart = doc["from"] | 0UL;
+    rangeEnd = doc["to"] | 0UL;
+    position = rangeStart;
+    sentAtPosition = 0;
+    sentCount = 0;
+
+    if (rangeStart == 0 || rangeEnd < rangeStart || !SDManager::isAvailable()) {
+        report("rejected");
+        return;
+    }
+    active = true;
+    lastBatch = 0;
+    report("started");
+}
+
+void Replay::service() {
+    if (!active) return;
+    unsigned long now = millis();
+    if (now - lastBatch < REPLAY_INTERVAL) return;
+
+    // Live readings go first
+    if (SDManager::getBufferCount() > 0) return;
+
+    // Pool exhausted: the same batch is tried next time
+    PoolBuffer batch(MQTT_BATCH_BYTES);
+    if (!batch) return;
+    lastBatch = now;
+
+    fetched = 0;
+    skipping = sentAtPosition;
+    SDManager::queryRange(position, rangeEnd, collect, REPLAY_BATCH + sentAtPosition);
+    if (fetched == 0) {
+        finish("done");
+        return;
+    }
+
+    unsigned int taken = 0;
+    size_t length = Payload::writeBatch(batch.data(), batch.size(), records, fetched, taken);
+    if (length == 0 || taken == 0) {
+        finish("failed");
+        return;
+    }
+    // Not sent: try the same readings again next time
+    if (!MQTTManager::publishBatch(batch.data(), length)) return;
+
+    sentCount += taken;
+
+    // A batch can end partway through the readings of one epoch: the
+    // next query starts at that epoch and skips the ones sent
+    uint32_t last = records[taken - 1].epoch;
+    unsigned int atLast = 0;
+    for (unsigned int i = taken; i > 0 && records[i - 1].epoch == last; i--) atLast++;
+    sentAtPosition = (last == position) ? sentAtPosition + atLast : atLast;
+    position = last;
+
+    if (fetched < REPLAY_BATCH && taken == fetched) {
+        finish("done");
+    } else if (now - lastProgress >= REPLAY_PROGRESS_INTERVAL) {
+        report("running");
+    }
+}
+
+bool Replay::isActive() {
+    return active;
+}
@@ -0,0 +1,43 @@
+/**
+ * retention.cpp - Keeps the SD card from filling up
+ */
+
+#include "retention.h"
+#include "config.h"
+#include "sd_manager.h"
+
+static unsigned long lastCheck = 0;
+static unsigned long deletedDays = 0;
+static unsigned long droppedReadings = 0;
+
+void Retention::service(bool bufferIdle) {
+    unsigned long now = millis();
+    if (now - lastCheck < SD_RETENTION_INTERVAL) return;
+    lastCheck = now;
+    if (!SDManager::isAvailable()) return;
+
+    bool lowSpace = SDManager::getFreeBytes() < SD_MIN_FREE_BYTES;
+
+    if (lowSpace || SDManager::getArchiveBytes() > SD_ARCHIVE_MAX_BYTES) {
+        if (SDManager::removeOldestArchiveDay()) {
+            deletedDays++;
+            return;
+        }
+    }
+
+    if (bufferIdle && (lowSpace || SDManager::getBufferBytes() > SD_BUFFER_MAX_BYTES)) {
+        unsigned int dropped = SDManager::removeBuffered(SD_SEGMENT_RECORDS);
+        if (dropped > 0) {
+            droppedReadings += dropped;
+            Serial.printf("[Retention] Dropped %u unsent readings (still archived)\n", dropped);
+        }
+    }
+}
+
+unsigned long Retention::getDeletedDays() {
+    return deletedDays;
+}
+
+unsigned long Retention::getDroppedReadings() {
+    return droppedReadings;
+}
@@ -0,0 +1,32 @@
+/**
+ * running_stats.cpp - Single-pass mean, variance, min and max
+ */
+
+#include "running_stats.h"
+#include <math.h>
+
+void RunningStats::reset() {
+    count = 0;
+    mean = 0;
+    m2 = 0;
+    min = 0;
+    max = 0;
+}
+
+void RunningStats::add(float x) {
+    if (count == 0) {
+        min = x;
+        max = x;
+    } else {
+        if (x < min) min = x;
+        if (x > max) max = x;
+    }
+    count++;
+    float delta = x - mean;
+    mean += delta / count;
+    m2 += delta * (x - mean);
+}
+
+float RunningStats::stddev() const {
+    return count > 1 ? sqrtf(m2 / (count - 1)) : 0.0f;
+}
@@ -2,242 +2,271 @@
  * sd_manager.cpp - SD card logging and data buffering
  * 
  * Architecture:
- * 1. Every reading writes to /data/buffer.jsonl (append)
- * 2. After successful MQTT publish, the reading is removed from buffer
+ * 1. Every reading is appended to the buffer log in /data/buffer/
+ * 2. Once the broker acknowledges it (QoS 1 PUBACK), the reading is
+ *    removed from buffer
  * 3. If MQTT is down, readings accumulate in buffer
  * 4. When MQTT recovers, buffered readings flush in batches
- * 5. Daily log files in /data/archive/ keep a permanent copy
+ * 5. Daily archive files in /data/archive/ keep a permanent,
+ *    compressed copy (see archive.h)
  * 
- * File format: JSONL (one JSON object per line, newline-delimited)
+ * The buffer is a segmented ring log (see buffer_log.h), so removing
+ * a reading only advances a cursor instead of rewriting a file.
+ * 
+ * Buffer format: fixed 32-byte binary records (see reading_record.h).
+ * Use tools/records.py to decode buffer and archive files on a PC.
+ * 
+ * The storage task writes readings while the network task reads and
+ * removes them, so every public function holds the SD mutex.
+ *
+ * The card is reached through Hal::storage() (a directory on the
+ * host build).
  */
 
 #include "sd_manager.h"
 #include "config.h"
 #include "time_manager.h"
-#include <SD.h>
-#include <SPI.h>
-#include <vector>
+#include "buffer_log.h"
+#include "archive.h"
+#include "hal.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 static bool sdAvailable = false;
-static unsigned long bufferCount = 0;
-static String currentArchiveFile = "";
+static SemaphoreHandle_t sdMutex = nullptr;
+
+// Free space: counted on the card every SD_FREE_REFRESH_INTERVAL, in
+// between lowered by the bytes written and raised by the bytes the
+// buffer and archive give back. Metadata rewrites count as writes, so
+// the estimate errs low.
+static uint64_t freeBytes = 0;
+static unsigned long freeWritten = 0;   // Bytes written when freeBytes was last updated
+static unsigned long freeCounted = 0;   // millis() of the last count
+static bool freeValid = false;
 
 /**
- * Create directory if it does not exist.
+ * Holds the SD mutex until the end of the scope.
  */
-static bool ensureDir(const char* path) {
-    if (SD.exists(path)) return true;
-    return SD.mkdir(path);
+struct SDLock {
+    SDLock() { if (sdMutex) xSemaphoreTake(sdMutex, portMAX_DELAY); }
+    ~SDLock() { if (sdMutex) xSemaphoreGive(sdMutex); }
+};
+
+static unsigned long bytesWritten() {
+    return BufferLog::bytesWritten() + Archive::bytesWritten();
 }
 
 /**
- * Get archive filename based on current date.
- * Format: /data/archive/2026-03-15.jsonl
+ * Bring the free space estimate up to date with the bytes written
+ * since it was last updated.
  */
-static String getArchiveFilename() {
-    struct tm timeinfo;
-    if (!getLocalTime(&timeinfo)) {
-        return String(SD_ARCHIVE_DIR) + "/unknown.jsonl";
-    }
-    char buf[40];
-    snprintf(buf, sizeof(buf), "%s/%04d-%02d-%02d.jsonl",
-             SD_ARCHIVE_DIR,
-             timeinfo.tm_year + 1900,
-             timeinfo.tm_mon + 1,
-             timeinfo.tm_mday);
-    return String(buf);
+static void settleFree() {
+    unsigned long total = bytesWritten();
+    uint64_t used = total - freeWritten;
+    freeBytes = used < freeBytes ? freeBytes - used : 0;
+    freeWritten = total;
+}
+
+/**
+ * Credit bytes given back by the buffer or archive ('before' and
+ * 'after' are their sizes around a removal).
+ */
+static void releaseFree(unsigned long before, unsigned long after) {
+    if (after < before) freeBytes += before - after;
+}
+
+/**
+ * Create directory if it does not exist.
+ */
+static bool ensureDir(const char* path) {
+    if (Hal::storage().exists(path)) return true;
+    return Hal::storage().mkdir(path);
 }
 
 /**
- * Count lines in buffer file.
+ * Move readings from the old single-file buffer into the buffer log.
+ * Runs once after a firmware upgrade; the legacy file is then removed.
  */
-static unsigned long countLines(const char* path) {
-    if (!SD.exists(path)) return 0;
+static void migrateLegacyBuffer() {
+    if (!Hal::storage().exists(SD_BUFFER_FILE)) return;
 
-    File f = SD.open(path, FILE_READ);
-    if (!f) return 0;
+    File f = Hal::storage().open(SD_BUFFER_FILE, FILE_READ);
+    if (!f) return;
 
-    unsigned long count = 0;
+    unsigned long migrated = 0;
     while (f.available()) {
         String line = f.readStringUntil('\n');
         line.trim();
-        if (line.length() > 0) count++;
+        ReadingRecord record;
+        if (RecordCodec::fromJSON(line, record) && BufferLog::append(record)) migrated++;
     }
     f.close();
-    return count;
+
+    Hal::storage().remove(SD_BUFFER_FILE);
+    Serial.printf("[SD] Migrated %lu readings from legacy buffer\n", migrated);
 }
 
 bool SDManager::init() {
-    Serial.print("[SD] Initializing... ");
-
-    SPI.begin(SD_SCK_PIN, SD_MISO_PIN, SD_MOSI_PIN, SD_CS_PIN);
+    if (!sdMutex) sdMutex = xSemaphoreCreateMutex();
+    SDLock lock;
 
-    if (!SD.begin(SD_CS_PIN)) {
-        Serial.println("FAILED! Check wiring and card.");
-        sdAvailable = false;
-        return false;
-    }
+    Serial.print("[SD] Initializing... ");
 
-    uint8_t cardType = SD.cardType();
-    if (cardType == CARD_NONE) {
-        Serial.println("No card inserted.");
+    if (!Hal::mountStorage()) {
         sdAvailable = false;
         return false;
     }
 
-    const char* typeStr = "UNKNOWN";
-    if (cardType == CARD_MMC)  typeStr = "MMC";
-    if (cardType == CARD_SD)   typeStr = "SD";
-    if (cardType == CARD_SDHC) typeStr = "SDHC";
-
-    Serial.printf("OK (%s, %lluMB)\n", typeStr, SD.totalBytes() / (1024 * 1024));
+    Serial.printf("OK (%s, %lluMB)\n", Hal::storageType(),
+                  (unsigned long long)(Hal::storageTotalBytes() / (1024 * 1024)));
 
     // Create directory structure
     ensureDir(SD_LOG_DIR);
     ensureDir(SD_ARCHIVE_DIR);
 
-    // Count existing buffered readings
-    bufferCount = countLines(SD_BUFFER_FILE);
-    if (bufferCount > 0) {
-        Serial.printf("[SD] Found %lu buffered readings from previous session\n", bufferCount);
+    // Open the buffer log and restore its cursor
+    unsigned long restoreStart = millis();
+    if (!BufferLog::begin(Hal::storage(), SD_BUFFER_DIR)) {
+        Serial.println("[SD] Buffer log unavailable");
+        sdAvailable = false;
+        return false;
+    }
+    migrateLegacyBuffer();
+    if (!Archive::begin(Hal::storage(), SD_ARCHIVE_DIR)) {
+        Serial.println("[SD] Archive unavailable");
     }
+    freeValid = false;
+
+    Serial.printf("[SD] Buffer restored in %lu ms (%lu readings, %lu bytes)\n",
+                  millis() - restoreStart, BufferLog::count(), BufferLog::bytes());
 
     sdAvailable = true;
     return true;
 }
 
-bool SDManager::writeReading(const String& jsonPayload) {
+bool SDManager::writeReading(const ReadingRecord& record, bool publish) {
+    SDLock lock;
     if (!sdAvailable) return false;
 
-    // Write to buffer file (unpublished readings)
-    File bufferFile = SD.open(SD_BUFFER_FILE, FILE_APPEND);
-    if (!bufferFile) {
-        Serial.println("[SD] Failed to open buffer file");
+    // Write to buffer log (unpublished readings)
+    if (publish && !BufferLog::append(record)) {
+        Serial.println("[SD] Failed to write buffer log");
         return false;
     }
-    bufferFile.println(jsonPayload);
-    bufferFile.close();
-    bufferCount++;
 
     // Write to daily archive (permanent record)
-    String archivePath = getArchiveFilename();
-    File archiveFile = SD.open(archivePath.c_str(), FILE_APPEND);
-    if (archiveFile) {
-        archiveFile.println(jsonPayload);
-        archiveFile.close();
-    }
+    bool archived = Archive::append(record);
 
-    Serial.printf("[SD] Reading saved (buffer: %lu)\n", bufferCount);
+    if (!publish) return archived;
+    Serial.printf("[SD] Reading saved (buffer: %lu)\n", BufferLog::count());
     return true;
 }
 
 unsigned long SDManager::getBufferCount() {
-    return bufferCount;
+    SDLock lock;
+    return sdAvailable ? BufferLog::count() : 0;
 }
 
-String SDManager::peekNextBuffered() {
-    if (!sdAvailable || bufferCount == 0) return "";
+unsigned long SDManager::getBufferBytes() {
+    SDLock lock;
+    return sdAvailable ? BufferLog::bytes() : 0;
+}
 
-    File f = SD.open(SD_BUFFER_FILE, FILE_READ);
-    if (!f) return "";
+unsigned long SDManager::getOldestBufferedEpoch() {
+    SDLock lock;
+    return sdAvailable ? BufferLog::oldestEpoch() : 0;
+}
 
-    String line = f.readStringUntil('\n');
-    f.close();
-    line.trim();
-    return line;
+bool SDManager::peekNextBuffered(ReadingRecord& record) {
+    SDLock lock;
+    if (!sdAvailable) return false;
+    return BufferLog::peek(record);
 }
 
 bool SDManager::removeOldestBuffered() {
-    if (!sdAvailable || bufferCount == 0) return false;
-
-    // Read all lines except the first
-    File f = SD.open(SD_BUFFER_FILE, FILE_READ);
-    if (!f) return false;
-
-    // Skip first line
-    f.readStringUntil('\n');
+    SDLock lock;
+    if (!sdAvailable) return false;
+    unsigned long before = BufferLog::bytes();
+    bool removed = BufferLog::pop();
+    releaseFree(before, BufferLog::bytes());
+    return removed;
+}
 
-    // Read remaining lines into memory
-    String remaining = "";
-    while (f.available()) {
-        String line = f.readStringUntil('\n');
-        line.trim();
-        if (line.length() > 0) {
-            remaining += line + "\n";
-        }
-    }
-    f.close();
+unsigned int SDManager::flushBuffer(bool (*publishCallback)(const ReadingRecord& record), unsigned int batchSize) {
+    SDLock lock;
+    if (!sdAvailable || BufferLog::count() == 0) return 0;
 
-    // Rewrite buffer file without the first line
-    SD.remove(SD_BUFFER_FILE);
-    if (remaining.length() > 0) {
-        File newFile = SD.open(SD_BUFFER_FILE, FILE_WRITE);
-        if (newFile) {
-            newFile.print(remaining);
-            newFile.close();
-        }
+    // Oldest readings first; stops on first publish failure
+    unsigned long before = BufferLog::bytes();
+    unsigned int flushed = BufferLog::drain(publishCallback, batchSize);
+    releaseFree(before, BufferLog::bytes());
+    if (flushed > 0) {
+        Serial.printf("[SD] Flushed %u readings, %lu remaining\n", flushed, BufferLog::count());
     }
+    return flushed;
+}
 
-    bufferCount--;
-    return true;
+unsigned int SDManager::peekBuffered(ReadingRecord* records, unsigned int maxCount, unsigned long skip) {
+    SDLock lock;
+    if (!sdAvailable) return 0;
+    return BufferLog::peekBatch(records, maxCount, skip);
 }
 
-unsigned int SDManager::flushBuffer(bool (*publishCallback)(const String& payload), unsigned int batchSize) {
-    if (!sdAvailable || bufferCount == 0) return 0;
+unsigned int SDManager::removeBuffered(unsigned int count) {
+    SDLock lock;
+    if (!sdAvailable) return 0;
+    unsigned long before = BufferLog::bytes();
+    unsigned int removed = BufferLog::popBatch(count);
+    releaseFree(before, BufferLog::bytes());
+    return removed;
+}
 
-    unsigned int flushed = 0;
+unsigned int SDManager::queryRange(uint32_t start, uint32_t end,
+                                   bool (*callback)(const ReadingRecord& record),
+                                   unsigned int maxCount) {
+    SDLock lock;
+    if (!sdAvailable) return 0;
+    return Archive::query(start, end, callback, maxCount);
+}
 
-    // Read all buffered lines
-    File f = SD.open(SD_BUFFER_FILE, FILE_READ);
-    if (!f) return 0;
+unsigned long SDManager::getArchiveBytes() {
+    SDLock lock;
+    return sdAvailable ? Archive::bytes() : 0;
+}
 
-    // Collect all lines
-    std::vector<String> lines;
-    while (f.available()) {
-        String line = f.readStringUntil('\n');
-        line.trim();
-        if (line.length() > 0) {
-            lines.push_back(line);
-        }
-    }
-    f.close();
+bool SDManager::removeOldestArchiveDay() {
+    SDLock lock;
+    if (!sdAvailable) return false;
+    unsigned long before = Archive::bytes();
+    bool removed = Archive::removeOldestDay();
+    releaseFree(before, Archive::bytes());
+    return removed;
+}
 
-    if (lines.empty()) {
-        bufferCount = 0;
-        return 0;
-    }
+unsigned long SDManager::getBytesWritten() {
+    SDLock lock;
+    return bytesWritten();
+}
 
-    // Try to publish oldest readings first
-    unsigned int publishedUpTo = 0;
-    for (unsigned int i = 0; i < lines.size() && flushed < batchSize; i++) {
-        if (publishCallback(lines[i])) {
-            flushed++;
-            publishedUpTo = i + 1;
-        } else {
-            // Stop on first failure
-            break;
-        }
-    }
+uint64_t SDManager::getFreeBytes() {
+    if (!sdAvailable) return 0;
 
-    // Rewrite buffer file with remaining unpublished lines
-    if (publishedUpTo > 0) {
-        SD.remove(SD_BUFFER_FILE);
-
-        if (publishedUpTo < lines.size()) {
-            File newFile = SD.open(SD_BUFFER_FILE, FILE_WRITE);
-            if (newFile) {
-                for (unsigned int i = publishedUpTo; i < lines.size(); i++) {
-                    newFile.println(lines[i]);
-                }
-                newFile.close();
-            }
-        }
-
-        bufferCount = lines.size() - publishedUpTo;
-        Serial.printf("[SD] Flushed %u readings, %lu remaining\n", flushed, bufferCount);
+    // Counting free clusters scans the FAT, so it runs rarely and
+    // without the SD mutex (FatFs locks the volume itself); the
+    // storage task is not held up behind it
+    if (!freeValid || millis() - freeCounted >= SD_FREE_REFRESH_INTERVAL) {
+        uint64_t counted = Hal::storageTotalBytes() - Hal::storageUsedBytes();
+        SDLock lock;
+        freeBytes = counted;
+        freeWritten = bytesWritten();
+        freeCounted = millis();
+        freeValid = true;
+        return freeBytes;
     }
 
-    return flushed;
+    SDLock lock;
+    settleFree();
+    return freeBytes;
 }
 
 bool SDManager::isAvailable() {
@@ -245,22 +274,27 @@ bool SDManager::isAvailable() {
 }
 
 unsigned long SDManager::getTotalBytes() {
+    SDLock lock;
     if (!sdAvailable) return 0;
-    return SD.totalBytes();
+    return Hal::storageTotalBytes();
 }
 
 unsigned long SDManager::getUsedBytes() {
+    SDLock lock;
     if (!sdAvailable) return 0;
-    return SD.usedBytes();
+    return Hal::storageUsedBytes();
 }
 
 String SDManager::getStatusJSON() {
+    SDLock lock;
     String json = "{";
     json += "\"available\":" + String(sdAvailable ? "true" : "false");
     if (sdAvailable) {
-        json += ",\"total_mb\":" + String(SD.totalBytes() / (1024 * 1024));
-        json += ",\"used_mb\":" + String(SD.usedBytes() / (1024 * 1024));
-        json += ",\"buffered\":" + String(bufferCount);
+        json += ",\"total_mb\":" + String(Hal::storageTotalBytes() / (1024 * 1024));
+        json += ",\"used_mb\":" + String(Hal::storageUsedBytes() / (1024 * 1024));
+        json += ",\"buffered\":" + String(BufferLog::count());
+        json += ",\"buffered_kb\":" + String(BufferLog::bytes() / 1024);
+        json += ",\"oldest\":" + String(BufferLog::oldestEpoch());
     }
     json += "}";
     return json;
@@ -0,0 +1,21 @@
+/**
+ * sensor_channels.cpp - Validation and fixed-point conversion table
+ */
+
+#include "sensor_channels.h"
+#include <math.h>
+
+uint32_t Channels::convert(const float values[CH_COUNT], int32_t fixed[CH_COUNT]) {
+    uint32_t mask = 0;
+    for (uint8_t i = 0; i < CH_COUNT; i++) {
+        const ChannelSpec& c = CHANNELS[i];
+        float v = values[i] + c.offset;
+        v = (v == v) ? v : 0.0f;            // NaN -> 0, and fails the range check below
+        mask |= (uint32_t)((values[i] == values[i]) & (v >= c.min) & (v <= c.max)) << i;
+
+        // Saturate to the largest floats that fit in int32, then round
+        float scaled = fminf(fmaxf(v * c.scale, -2147483520.0f), 2147483520.0f);
+        fixed[i] = (int32_t)roundf(scaled);
+    }
+    return mask;
+}
@@ -4,10 +4,20 @@
  * SCD30: CO2 (ppm), Temperature (C), Humidity (%RH) via I2C
  * BH1750: Light intensity (lux) via I2C
  * Capacitive sensor: Soil moisture (%) via analog
+ * 
+ * Nothing here waits on a sensor. poll() moves each sensor's state
+ * machine one step (at most one bus transaction, or one copy of the
+ * soil samples gathered by DMA). Every valid sample goes into a
+ * running mean/variance/min/max per channel, and read() returns the
+ * means over the interval since the previous read(). SCD30 samples are
+ * read as soon as they are ready, so none is lost when a reading
+ * falls between two measurements.
  */
 
 #include "sensor_manager.h"
 #include "config.h"
+#include "adc_filter.h"
+#include "soil_sampler.h"
 #include <Wire.h>
 #include <SparkFun_SCD30_Arduino_Library.h>
 #include <BH1750.h>
@@ -22,32 +32,195 @@ static bool bh1750Initialized = false;
 // Needed because SCD30 has internal 45kΩ pullups that conflict with BH1750's 10kΩ pullups
 
 /**
- * Read soil moisture from capacitive sensor.
- * Takes multiple samples and averages them to reduce noise.
- * Maps raw ADC value to 0-100% range.
+ * Acquisition steps. Each sensor moves through them one poll() at a
+ * time: start a measurement, wait for it, fetch it, then validate.
  */
-static float readSoilMoisture(int* rawOut) {
-    long sum = 0;
-    for (int i = 0; i < SOIL_SAMPLES; i++) {
-        sum += analogRead(SOIL_PIN);
-        delay(10);
-    }
-    int raw = sum / SOIL_SAMPLES;
-    *rawOut = raw;
+enum AcqState { ACQ_TRIGGER, ACQ_WAIT, ACQ_FETCH, ACQ_VALIDATE };
+
+/**
+ * Acquisition state of one sensor.
+ */
+struct Channel {
+    AcqState state;
+    unsigned long nextStep;     // millis() before which WAIT does nothing
+    unsigned long sampledAt;    // millis() of the last completed value
+    bool hasValue;              // A value has completed since boot
+};
+
+static Channel scd30Ch = {ACQ_TRIGGER, 0, 0, false};
+static Channel bh1750Ch = {ACQ_TRIGGER, 0, 0, false};
+static Channel soilCh = {ACQ_TRIGGER, 0, 0, false};
 
+static SensorData latest = {};  // Latest completed values
+static RunningStats window[CH_COUNT];   // Every valid sample since the last read()
+static unsigned long windowStart = 0;
+static SensorData pending = {}; // Values being fetched
+static uint16_t soilBlock[SOIL_SAMPLES];
+static size_t soilCount = 0;
+static float soilAirMv = 0;     // Calibration points converted to mV
+static float soilWaterMv = 0;
+
+/**
+ * Map a filtered raw ADC value to 0-100% soil moisture, or -1 if it is
+ * outside the calibrated range.
+ */
+static float soilPercent(float raw) {
     // ADC range check: raw must be within calibrated sensor range
     // SOIL_WATER_VALUE = wet (100%), SOIL_AIR_VALUE = dry (0%)
     if (raw < SOIL_WATER_VALUE || raw > SOIL_AIR_VALUE) {
         return -1.0f;
     }
 
-    // Map raw value to percentage
+    // Interpolate in calibrated millivolts, which are linear where
+    // the raw ADC scale is not
     // SOIL_AIR_VALUE = dry (0%), SOIL_WATER_VALUE = wet (100%)
-    float percent = map(raw, SOIL_AIR_VALUE, SOIL_WATER_VALUE, 0, 100);
+    float mv = SoilSampler::toMillivolts(raw);
+    float percent = (mv - soilAirMv) * 100.0f / (soilWaterMv - soilAirMv);
     percent = constrain(percent, 0.0f, 100.0f);
     return percent;
 }
 
+static bool due(unsigned long now, unsigned long at) {
+    return (long)(now - at) >= 0;
+}
+
+/**
+ * SCD30 measures continuously every SCD30_INTERVAL, so there is
+ * nothing to trigger; wait for data ready, then read it.
+ */
+static void pollSCD30(unsigned long now) {
+    switch (scd30Ch.state) {
+    case ACQ_TRIGGER:
+        scd30Ch.state = ACQ_WAIT;
+        break;
+    case ACQ_WAIT:
+        if (!due(now, scd30Ch.nextStep)) break;
+        if (scd30.dataAvailable()) {
+            scd30Ch.state = ACQ_FETCH;
+        } else {
+            scd30Ch.nextStep = now + 100;
+        }
+        break;
+    case ACQ_FETCH:
+        if (scd30.readMeasurement()) {
+            pending.co2 = scd30.getCO2();
+            pending.temperature = scd30.getTemperature();
+            pending.humidity = scd30.getHumidity();
+            scd30Ch.state = ACQ_VALIDATE;
+        } else {
+            scd30Ch.state = ACQ_WAIT;
+        }
+        break;
+    case ACQ_VALIDATE: {
+        // Sanity checks
+        bool valid = Channels::inRange(CH_CO2, pending.co2) &&
+                     Channels::inRange(CH_TEMPERATURE, pending.temperature) &&
+                     Channels::inRange(CH_HUMIDITY, pending.humidity);
+        if (valid) {
+            latest.co2 = pending.co2;
+            latest.temperature = pending.temperature;
+            latest.humidity = pending.humidity;
+            window[CH_CO2].add(pending.co2);
+            window[CH_TEMPERATURE].add(pending.temperature);
+            window[CH_HUMIDITY].add(pending.humidity);
+            scd30Ch.sampledAt = now;
+            scd30Ch.hasValue = true;
+        } else {
+            Serial.println("[Sensor] SCD30: Reading out of range");
+        }
+        latest.scd30Valid = valid;
+        // Next sample is not due before the measurement interval
+        scd30Ch.nextStep = now + SCD30_INTERVAL * 1000UL - 200;
+        scd30Ch.state = ACQ_TRIGGER;
+        break;
+    }
+    }
+}
+
+/**
+ * BH1750 runs in continuous mode; wait until the library says the
+ * current measurement is complete, then read it.
+ */
+static void pollBH1750(unsigned long now) {
+    switch (bh1750Ch.state) {
+    case ACQ_TRIGGER:
+    case ACQ_WAIT:
+        if (bh1750.measurementReady()) bh1750Ch.state = ACQ_FETCH;
+        break;
+    case ACQ_FETCH:
+        pending.light = bh1750.readLightLevel();
+        bh1750Ch.state = ACQ_VALIDATE;
+        break;
+    case ACQ_VALIDATE:
+        if (Channels::inRange(CH_LIGHT, pending.light)) {
+            latest.light = pending.light;
+            latest.bh1750Valid = true;
+            window[CH_LIGHT].add(pending.light);
+            bh1750Ch.sampledAt = now;
+            bh1750Ch.hasValue = true;
+        } else {
+            latest.bh1750Valid = false;
+            Serial.println("[Sensor] BH1750: Read error");
+        }
+        bh1750Ch.state = ACQ_WAIT;
+        break;
+    }
+}
+
+/**
+ * Soil moisture: gather SOIL_SAMPLES samples from the background ADC
+ * sampler, then median-plus-mean filter them. Repeats every
+ * SOIL_READ_INTERVAL.
+ */
+static void pollSoil(unsigned long now) {
+    switch (soilCh.state) {
+    case ACQ_TRIGGER:
+        if (!due(now, soilCh.nextStep)) break;
+        soilCount = 0;
+        soilCh.nextStep = now + SOIL_READ_INTERVAL;
+        soilCh.state = ACQ_WAIT;
+        // fall through: start collecting now
+    case ACQ_WAIT:
+        soilCount += SoilSampler::collect(soilBlock + soilCount, SOIL_SAMPLES - soilCount);
+        if (soilCount >= SOIL_SAMPLES) soilCh.state = ACQ_FETCH;
+        break;
+    case ACQ_FETCH: {
+        AdcFilterResult f = AdcFilter::apply(soilBlock, soilCount);
+        pending.soilRaw = (int)(f.value + 0.5f);
+        pending.soilMoisture = soilPercent(f.value);
+        pending.soilNoise = f.noise;
+        soilCh.state = ACQ_VALIDATE;
+        break;
+    }
+    case ACQ_VALIDATE:
+        latest.soilRaw = pending.soilRaw;
+        latest.soilMoisture = pending.soilMoisture;
+        latest.soilNoise = pending.soilNoise;
+        latest.soilValid = Channels::inRange(CH_SOIL_RAW, pending.soilRaw);
+        if (latest.soilValid) {
+            window[CH_SOIL_RAW].add(pending.soilRaw);
+            // -1 (outside calibration) would drag the mean down
+            if (pending.soilMoisture >= 0) window[CH_SOIL_MOISTURE].add(pending.soilMoisture);
+        }
+        soilCh.sampledAt = now;
+        soilCh.hasValue = true;
+        soilCh.state = ACQ_TRIGGER;
+        break;
+    }
+}
+
+/**
+ * Age of a channel's value in ms, and whether it is still usable.
+ */
+static bool fresh(const Channel& ch, unsigned long now, uint32_t& age) {
+    if (!ch.hasValue) {
+        age = 0;
+        return false;
+    }
+    age = now - ch.sampledAt;
+    return age <= SENSOR_MAX_AGE;
+}
+
 bool SensorManager::init() {
     // Initialize I2C bus 0: SCD30 on GPIO 21 (SDA) / 22 (SCL)
     Wire.begin(I2C_SDA, I2C_SCL);
@@ -82,72 +255,83 @@ bool SensorManager::init() {
         Serial.println("FAILED (check wiring, addr 0x23)");
     }
 
-    // Initialize soil moisture pin
-    Serial.print("[Sensor] Soil moisture init... ");
-    pinMode(SOIL_PIN, INPUT);
-    analogSetAttenuation(ADC_11db);  // Full 0-3.3V range
-    Serial.println("OK (GPIO34)");
+    // Start background soil moisture sampling
+    bool dma = SoilSampler::begin();
+    soilAirMv = SoilSampler::toMillivolts(SOIL_AIR_VALUE);
+    soilWaterMv = SoilSampler::toMillivolts(SOIL_WATER_VALUE);
+    Serial.printf("[Sensor] Soil moisture init... OK (GPIO%d, %s)\n",
+                  SOIL_PIN, dma ? "DMA" : "analogRead");
     anySensor = true;
 
     return anySensor;
 }
 
-SensorData SensorManager::read() {
-    SensorData data = {};
-
-    // Read SCD30
-    if (scd30Initialized && scd30.dataAvailable()) {
-        data.co2 = scd30.getCO2();
-        data.temperature = scd30.getTemperature();
-        data.humidity = scd30.getHumidity();
-        data.scd30Valid = true;
+void SensorManager::poll() {
+    unsigned long now = millis();
+    if (scd30Initialized) pollSCD30(now);
+    if (bh1750Initialized) pollBH1750(now);
+    pollSoil(now);
+}
 
-        // Sanity checks
-        if (data.co2 < 0 || data.co2 > 10000) data.scd30Valid = false;
-        if (data.temperature < -40 || data.temperature > 80) data.scd30Valid = false;
-        if (data.humidity < 0 || data.humidity > 100) data.scd30Valid = false;
+SensorData SensorManager::read(WindowSummary* summary) {
+    unsigned long now = millis();
+    SensorData data = latest;
+    fresh(scd30Ch, now, data.scd30Age);
+    fresh(bh1750Ch, now, data.bh1750Age);
+    fresh(soilCh, now, data.soilAge);
 
-        if (data.scd30Valid) {
-            Serial.printf("[Sensor] SCD30: %.1f ppm, %.2f C, %.1f %%RH\n",
-                          data.co2, data.temperature, data.humidity);
-        } else {
-            Serial.println("[Sensor] SCD30: Reading out of range");
-        }
+    // Each value is the mean of the window; a sensor with no valid
+    // sample in the window is invalid
+    data.scd30Valid = scd30Initialized && window[CH_CO2].count > 0;
+    if (data.scd30Valid) {
+        data.co2 = window[CH_CO2].mean;
+        data.temperature = window[CH_TEMPERATURE].mean;
+        data.humidity = window[CH_HUMIDITY].mean;
+        Serial.printf("[Sensor] SCD30: %.1f ppm, %.2f C, %.1f %%RH (mean of %u)\n",
+                      data.co2, data.temperature, data.humidity, (unsigned)window[CH_CO2].count);
     } else if (scd30Initialized) {
-        Serial.println("[Sensor] SCD30: Data not ready");
-        data.scd30Valid = false;
+        Serial.println("[Sensor] SCD30: No reading this interval");
     }
 
-    // Read BH1750
-    if (bh1750Initialized) {
-        float lux = bh1750.readLightLevel();
-        if (lux >= 0) {
-            data.light = lux;
-            data.bh1750Valid = true;
-            Serial.printf("[Sensor] BH1750: %.1f lux\n", data.light);
-        } else {
-            data.bh1750Valid = false;
-            Serial.println("[Sensor] BH1750: Read error");
-        }
+    data.bh1750Valid = bh1750Initialized && window[CH_LIGHT].count > 0;
+    if (data.bh1750Valid) {
+        data.light = window[CH_LIGHT].mean;
+        Serial.printf("[Sensor] BH1750: %.1f lux (mean of %u)\n",
+                      data.light, (unsigned)window[CH_LIGHT].count);
+    } else if (bh1750Initialized) {
+        Serial.println("[Sensor] BH1750: No reading this interval");
     }
 
-    // Read soil moisture
-    int rawValue = 0;
-    data.soilMoisture = readSoilMoisture(&rawValue);
-    data.soilRaw = rawValue;
-    data.soilValid = (rawValue > 0 && rawValue < 4095);
+    data.soilValid = window[CH_SOIL_RAW].count > 0;
+    if (data.soilValid) {
+        data.soilRaw = (int)(window[CH_SOIL_RAW].mean + 0.5f);
+        data.soilMoisture = window[CH_SOIL_MOISTURE].count > 0 ? window[CH_SOIL_MOISTURE].mean : -1.0f;
+    }
+    Serial.printf("[Sensor] Soil: %.1f%% (raw: %d, noise: %.1f, mean of %u)\n",
+                  data.soilMoisture, data.soilRaw, data.soilNoise, (unsigned)window[CH_SOIL_RAW].count);
 
-    Serial.printf("[Sensor] Soil: %.1f%% (raw: %d)\n", data.soilMoisture, data.soilRaw);
+    if (summary) {
+        for (uint8_t i = 0; i < CH_COUNT; i++) summary->channels[i] = window[i];
+        summary->durationMs = now - windowStart;
+    }
+    for (uint8_t i = 0; i < CH_COUNT; i++) window[i].reset();
+    windowStart = now;
 
     return data;
 }
 
 bool SensorManager::isSCD30Ready() {
-    return scd30Initialized && scd30.dataAvailable();
+    uint32_t age;
+    return scd30Initialized && fresh(scd30Ch, millis(), age);
 }
 
 bool SensorManager::isBH1750Ready() {
-    return bh1750Initialized;
+    uint32_t age;
+    return bh1750Initialized && fresh(bh1750Ch, millis(), age);
+}
+
+float SensorManager::getSoilNoise() {
+    return latest.soilNoise;
 }
 
 String SensorManager::getStatusJSON() {
@@ -0,0 +1,91 @@
+/**
+ * soil_sampler.cpp - Background ADC sampling for the soil sensor
+ *
+ * Uses the I2S ADC mode (legacy driver in ESP-IDF 4.4, the version
+ * under Arduino core 2.x). Samples are 16 bits wide with the ADC
+ * channel in the top 4 bits and the 12-bit value below.
+ */
+
+#include "soil_sampler.h"
+#include "config.h"
+#include <driver/i2s.h>
+#include <driver/adc.h>
+#include <esp_adc_cal.h>
+
+#define SOIL_I2S_PORT    I2S_NUM_0
+#define SOIL_DMA_BUFFERS 4
+#define SOIL_DMA_LENGTH  256            // Samples per DMA buffer
+
+static bool dmaRunning = false;
+static esp_adc_cal_characteristics_t adcChars;
+
+bool SoilSampler::begin() {
+    pinMode(SOIL_PIN, INPUT);
+    adc1_channel_t channel = (adc1_channel_t)digitalPinToAnalogChannel(SOIL_PIN);
+
+    // Full 0-3.3V range
+    adc1_config_width(ADC_WIDTH_BIT_12);
+    adc1_config_channel_atten(channel, ADC_ATTEN_DB_11);
+    analogSetPinAttenuation(SOIL_PIN, ADC_11db);
+
+    esp_adc_cal_value_t cal = esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11,
+                                                       ADC_WIDTH_BIT_12, 1100, &adcChars);
+    Serial.printf("[Soil] ADC calibration: %s\n",
+                  cal == ESP_ADC_CAL_VAL_EFUSE_TP ? "eFuse two-point" :
+                  cal == ESP_ADC_CAL_VAL_EFUSE_VREF ? "eFuse Vref" : "default Vref");
+
+    i2s_config_t i2sConfig = {};
+    i2sConfig.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN);
+    i2sConfig.sample_rate = SOIL_ADC_SAMPLE_RATE;
+    i2sConfig.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+    i2sConfig.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+    i2sConfig.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+    i2sConfig.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1;
+    i2sConfig.dma_buf_count = SOIL_DMA_BUFFERS;
+    i2sConfig.dma_buf_len = SOIL_DMA_LENGTH;
+    i2sConfig.use_apll = false;
+
+    if (i2s_driver_install(SOIL_I2S_PORT, &i2sConfig, 0, nullptr) != ESP_OK) {
+        Serial.println("[Soil] I2S driver failed, using analogRead()");
+        return false;
+    }
+    if (i2s_set_adc_mode(ADC_UNIT_1, channel) != ESP_OK || i2s_adc_enable(SOIL_I2S_PORT) != ESP_OK) {
+        i2s_driver_uninstall(SOIL_I2S_PORT);
+        Serial.println("[Soil] ADC DMA mode failed, using analogRead()");
+        return false;
+    }
+
+    dmaRunning = true;
+    Serial.printf("[Soil] ADC DMA sampling at %d Hz\n", SOIL_ADC_SAMPLE_RATE);
+    return true;
+}
+
+size_t SoilSampler::collect(uint16_t* samples, size_t maxCount) {
+    if (!dmaRunning) {
+        // Fallback: a few direct conversions per call (~10 us each)
+        size_t n = min(maxCount, (size_t)32);
+        for (size_t i = 0; i < n; i++) samples[i] = analogRead(SOIL_PIN);
+        return n;
+    }
+
+    size_t bytesRead = 0;
+    i2s_read(SOIL_I2S_PORT, samples, maxCount * sizeof(uint16_t), &bytesRead, 0);
+    size_t n = bytesRead / sizeof(uint16_t);
+    for (size_t i = 0; i < n; i++) samples[i] &= 0x0FFF;
+    return n;
+}
+
+float SoilSampler::toMillivolts(float raw) {
+    if (raw <= 0) return esp_adc_cal_raw_to_voltage(0, &adcChars);
+    if (raw >= 4095) return esp_adc_cal_raw_to_voltage(4095, &adcChars);
+
+    // The calibration curve is defined on whole ADC steps; interpolate
+    uint32_t step = (uint32_t)raw;
+    float lo = esp_adc_cal_raw_to_voltage(step, &adcChars);
+    float hi = esp_adc_cal_raw_to_voltage(step + 1, &adcChars);
+    return lo + (raw - step) * (hi - lo);
+}
+
+bool SoilSampler::isDMA() {
+    return dmaRunning;
+}
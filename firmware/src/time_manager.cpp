@@ -8,79 +8,95 @@
 #include "time_manager.h"
 #include "config.h"
 #include <time.h>
+#include <atomic>
 
-static bool timeSynced = false;
+// Any clock reading before this (2023-11-14) means NTP has not synced
+#define MIN_VALID_EPOCH 1700000000UL
+
+// Set by the network task's maintain(), read by the sensor and
+// storage tasks to stamp readings: bootEpoch is stored before
+// timeSynced, so a task that sees the sync also sees the epoch
+static std::atomic<bool> timeSynced(false);
+static std::atomic<unsigned long> bootEpoch(0);
+static std::atomic<unsigned long> firstSyncTime(0);
 static unsigned long lastSyncTime = 0;
 static unsigned long bootTime = 0;
 
 void TimeManager::init() {
     bootTime = millis();
 
-    // Configure timezone and NTP servers
+    // Configure timezone and NTP servers. SNTP syncs in the
+    // background; maintain() notices when the clock is set.
     configTime(NTP_GMT_OFFSET, NTP_DST_OFFSET, NTP_SERVER_1, NTP_SERVER_2);
+    Serial.println("[Time] NTP sync started");
+}
 
-    Serial.print("[Time] Syncing with NTP");
-
-    // Wait for time sync (max 10 seconds)
-    struct tm timeinfo;
-    int attempts = 0;
-    while (!getLocalTime(&timeinfo) && attempts < 20) {
-        delay(500);
-        Serial.print(".");
-        attempts++;
-    }
+void TimeManager::maintain() {
+    if (!timeSynced) {
+        unsigned long now = getEpoch();
+        if (now < MIN_VALID_EPOCH) return;
 
-    if (getLocalTime(&timeinfo)) {
-        timeSynced = true;
         lastSyncTime = millis();
-        Serial.println(" Synced!");
-        Serial.printf("[Time] Current time: %s\n", getISO8601().c_str());
-    } else {
-        Serial.println(" FAILED! Timestamps will use millis().");
+        firstSyncTime = lastSyncTime - bootTime;
+        bootEpoch = now - millis() / 1000;
+        timeSynced = true;
+        Serial.printf("[Time] Synced after %lu ms: %s\n", firstSyncTime.load(), getISO8601().c_str());
+        return;
     }
-}
 
-void TimeManager::maintain() {
     // Re-sync periodically
     if (millis() - lastSyncTime > NTP_SYNC_INTERVAL) {
         configTime(NTP_GMT_OFFSET, NTP_DST_OFFSET, NTP_SERVER_1, NTP_SERVER_2);
         lastSyncTime = millis();
-
-        struct tm timeinfo;
-        if (getLocalTime(&timeinfo)) {
-            timeSynced = true;
-            Serial.printf("[Time] Re-synced: %s\n", getISO8601().c_str());
-        }
+        Serial.printf("[Time] Re-synced: %s\n", getISO8601().c_str());
     }
 }
 
-String TimeManager::getISO8601() {
-    struct tm timeinfo;
-    if (!getLocalTime(&timeinfo)) {
-        // Fallback: return millis-based timestamp
-        return "1970-01-01T00:00:00+00:00";
-    }
-
-    char buffer[30];
+/**
+ * Format broken-down local time as ISO 8601 with UTC offset.
+ */
+static size_t formatLocalTime(const struct tm& timeinfo, char* buffer, size_t size) {
     // Determine current UTC offset (handles DST automatically)
     int totalOffset = NTP_GMT_OFFSET + (timeinfo.tm_isdst > 0 ? NTP_DST_OFFSET : 0);
     int offsetHours = totalOffset / 3600;
     int offsetMinutes = (totalOffset % 3600) / 60;
 
-    snprintf(buffer, sizeof(buffer),
-             "%04d-%02d-%02dT%02d:%02d:%02d+%02d:%02d",
-             timeinfo.tm_year + 1900,
-             timeinfo.tm_mon + 1,
-             timeinfo.tm_mday,
-             timeinfo.tm_hour,
-             timeinfo.tm_min,
-             timeinfo.tm_sec,
-             offsetHours,
-             abs(offsetMinutes));
+    int n = snprintf(buffer, size,
+                     "%04d-%02d-%02dT%02d:%02d:%02d+%02d:%02d",
+                     timeinfo.tm_year + 1900,
+                     timeinfo.tm_mon + 1,
+                     timeinfo.tm_mday,
+                     timeinfo.tm_hour,
+                     timeinfo.tm_min,
+                     timeinfo.tm_sec,
+                     offsetHours,
+                     abs(offsetMinutes));
+    return (n > 0 && (size_t)n < size) ? n : 0;
+}
 
+String TimeManager::getISO8601() {
+    struct tm timeinfo;
+    if (!getLocalTime(&timeinfo, 0)) {
+        // Fallback: return millis-based timestamp
+        return "1970-01-01T00:00:00+00:00";
+    }
+    char buffer[ISO8601_BUFFER_SIZE];
+    formatLocalTime(timeinfo, buffer, sizeof(buffer));
     return String(buffer);
 }
 
+size_t TimeManager::formatISO8601(char* buffer, size_t size, unsigned long epoch, bool valid) {
+    if (!valid) {
+        // Fallback when the clock was never set
+        int n = snprintf(buffer, size, "1970-01-01T00:00:00+00:00");
+        return (n > 0 && (size_t)n < size) ? n : 0;
+    }
+    time_t t = epoch;
+    struct tm timeinfo;
+    localtime_r(&t, &timeinfo);
+    return formatLocalTime(timeinfo, buffer, size);
+}
+
 unsigned long TimeManager::getEpoch() {
     time_t now;
     time(&now);
@@ -91,6 +107,14 @@ bool TimeManager::isSynced() {
     return timeSynced;
 }
 
+unsigned long TimeManager::getBootEpoch() {
+    return bootEpoch;
+}
+
+unsigned long TimeManager::getFirstSyncTime() {
+    return firstSyncTime;
+}
+
 unsigned long TimeManager::getUptime() {
     return (millis() - bootTime) / 1000;
 }
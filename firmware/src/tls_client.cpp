@@ -0,0 +1,312 @@
+/**
+ * tls_client.cpp - TLS client with session resumption
+ *
+ * mbedTLS on top of a plain WiFiClient socket. The configuration
+ * (CA chain, RNG) is set up once and the SSL context is reset rather
+ * than rebuilt between connections.
+ *
+ * The handshake is run one step at a time so the free heap can be
+ * sampled between steps; the lowest value gives the peak it used.
+ */
+
+#include "tls_client.h"
+#include "config.h"
+#include "checksum.h"
+#include <esp_attr.h>
+#include <mbedtls/error.h>
+
+#define TLS_WRITE_TIMEOUT    5000       // Give up on a stalled write (ms)
+#define TLS_SESSION_MAGIC    0x544C5353 // "TLSS"
+#define TLS_SESSION_MAX_SIZE 2048       // Serialized session incl. peer cert
+
+/**
+ * Serialized session in RTC memory. Not cleared by a software reset
+ * or deep sleep; the magic and CRC reject it after a power cycle.
+ */
+struct SavedSession {
+    uint32_t magic;
+    uint32_t length;
+    uint32_t crc;
+    uint8_t data[TLS_SESSION_MAX_SIZE];
+};
+
+static RTC_NOINIT_ATTR SavedSession rtcSession;
+
+TLSClient::TLSClient() {
+    mbedtls_ssl_init(&ssl);
+    mbedtls_ssl_config_init(&conf);
+    mbedtls_ssl_session_init(&session);
+    mbedtls_ctr_drbg_init(&drbg);
+    mbedtls_entropy_init(&entropy);
+    mbedtls_x509_crt_init(&ca);
+    mbedtls_net_init(&net);
+}
+
+TLSClient::~TLSClient() {
+    stop();
+    mbedtls_ssl_free(&ssl);
+    mbedtls_ssl_config_free(&conf);
+    mbedtls_ssl_session_free(&session);
+    mbedtls_ctr_drbg_free(&drbg);
+    mbedtls_entropy_free(&entropy);
+    mbedtls_x509_crt_free(&ca);
+}
+
+void TLSClient::setCACert(const char* rootCA) {
+    caCert = rootCA;
+}
+
+void TLSClient::fail(const char* what, int ret) {
+    char msg[80];
+    mbedtls_strerror(ret, msg, sizeof(msg));
+    Serial.printf("[TLS] %s failed: -0x%04X %s\n", what, -ret, msg);
+}
+
+bool TLSClient::configure() {
+    if (configured) return true;
+    if (!caCert) {
+        Serial.println("[TLS] No CA certificate set");
+        return false;
+    }
+
+    int ret = mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy, nullptr, 0);
+    if (ret != 0) { fail("RNG seed", ret); return false; }
+
+    ret = mbedtls_x509_crt_parse(&ca, (const unsigned char*)caCert, strlen(caCert) + 1);
+    if (ret != 0) { fail("CA parse", ret); return false; }
+
+    ret = mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT,
+                                      MBEDTLS_SSL_TRANSPORT_STREAM,
+                                      MBEDTLS_SSL_PRESET_DEFAULT);
+    if (ret != 0) { fail("Config", ret); return false; }
+
+    mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ca_chain(&conf, &ca, nullptr);
+    mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &drbg);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+
+    ret = mbedtls_ssl_setup(&ssl, &conf);
+    if (ret != 0) { fail("Setup", ret); return false; }
+
+    restoreSession();
+    configured = true;
+    return true;
+}
+
+/**
+ * Keep the negotiated session for the next connect, in RAM and RTC.
+ */
+void TLSClient::saveSession() {
+    mbedtls_ssl_session_free(&session);
+    mbedtls_ssl_session_init(&session);
+    haveSession = mbedtls_ssl_get_session(&ssl, &session) == 0;
+    if (!haveSession) return;
+
+    size_t length = 0;
+    if (mbedtls_ssl_session_save(&session, rtcSession.data, sizeof(rtcSession.data), &length) != 0) {
+        rtcSession.magic = 0;       // Too big for RTC; keep it in RAM only
+        return;
+    }
+    rtcSession.length = length;
+    rtcSession.crc = Checksum::crc32(rtcSession.data, length);
+    rtcSession.magic = TLS_SESSION_MAGIC;
+}
+
+/**
+ * Load a session left in RTC memory by the previous boot.
+ */
+void TLSClient::restoreSession() {
+    if (rtcSession.magic != TLS_SESSION_MAGIC) return;
+    if (rtcSession.length > sizeof(rtcSession.data) ||
+        rtcSession.crc != Checksum::crc32(rtcSession.data, rtcSession.length)) {
+        rtcSession.magic = 0;
+        return;
+    }
+
+    haveSession = mbedtls_ssl_session_load(&session, rtcSession.data, rtcSession.length) == 0;
+    if (haveSession) {
+        Serial.println("[TLS] Restored session from RTC memory");
+    } else {
+        rtcSession.magic = 0;
+    }
+}
+
+void TLSClient::clearSession() {
+    mbedtls_ssl_session_free(&session);
+    mbedtls_ssl_session_init(&session);
+    haveSession = false;
+    rtcSession.magic = 0;
+}
+
+bool TLSClient::handshake(const char* host) {
+    int ret = mbedtls_ssl_session_reset(&ssl);
+    if (ret != 0) { fail("Reset", ret); return false; }
+
+    ret = mbedtls_ssl_set_hostname(&ssl, host);
+    if (ret != 0) { fail("Hostname", ret); return false; }
+
+    net.fd = tcp.fd();
+    mbedtls_net_set_nonblock(&net);
+    mbedtls_ssl_set_bio(&ssl, &net, mbedtls_net_send, mbedtls_net_recv, nullptr);
+
+    bool offered = haveSession && mbedtls_ssl_set_session(&ssl, &session) == 0;
+
+    uint32_t heapBefore = ESP.getFreeHeap();
+    uint32_t heapMin = heapBefore;
+    unsigned long start = millis();
+
+    while (ssl.state != MBEDTLS_SSL_HANDSHAKE_OVER) {
+        ret = mbedtls_ssl_handshake_step(&ssl);
+        heapMin = min(heapMin, ESP.getFreeHeap());
+
+        if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+            if (millis() - start > TLS_HANDSHAKE_TIMEOUT) {
+                Serial.println("[TLS] Handshake timed out");
+                return false;
+            }
+            delay(1);
+        } else if (ret != 0) {
+            fail("Handshake", ret);
+            // Don't offer the same session again in case it caused this
+            if (offered) clearSession();
+            return false;
+        }
+    }
+
+    // On resumption the master secret is carried over from the session
+    bool resumed = offered &&
+                   memcmp(ssl.session->master, session.master, sizeof(session.master)) == 0;
+
+    stats.heapPeak = heapBefore - heapMin;
+    stats.resumed = resumed;
+    if (resumed) stats.resumedHandshakes++; else stats.fullHandshakes++;
+
+    saveSession();
+    return true;
+}
+
+int TLSClient::connect(const char* host, uint16_t port) {
+    stop();
+    if (!configure()) return 0;
+
+    unsigned long start = millis();
+    if (!tcp.connect(host, port, TLS_HANDSHAKE_TIMEOUT)) {
+        Serial.printf("[TLS] TCP connect to %s:%u failed\n", host, port);
+        return 0;
+    }
+
+    if (!handshake(host)) {
+        tcp.stop();
+        return 0;
+    }
+
+    stats.handshakeMs = millis() - start;
+    Serial.printf("[TLS] %s handshake in %lu ms (heap peak %lu bytes)\n",
+                  stats.resumed ? "Resumed" : "Full", stats.handshakeMs, stats.heapPeak);
+
+    open = true;
+    peeked = -1;
+    return 1;
+}
+
+int TLSClient::connect(IPAddress ip, uint16_t port) {
+    return connect(ip.toString().c_str(), port);
+}
+
+size_t TLSClient::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t TLSClient::write(const uint8_t* buf, size_t size) {
+    if (!open) return 0;
+
+    size_t sent = 0;
+    unsigned long start = millis();
+    while (sent < size) {
+        int ret = mbedtls_ssl_write(&ssl, buf + sent, size - sent);
+        if (ret > 0) {
+            sent += ret;
+            start = millis();
+        } else if (ret == MBEDTLS_ERR_SSL_WANT_WRITE || ret == MBEDTLS_ERR_SSL_WANT_READ) {
+            if (millis() - start > TLS_WRITE_TIMEOUT) break;
+            delay(1);
+        } else {
+            fail("Write", ret);
+            stop();
+            break;
+        }
+    }
+    return sent;
+}
+
+int TLSClient::available() {
+    if (!open) return 0;
+    int pending = peeked >= 0 ? 1 : 0;
+
+    int avail = mbedtls_ssl_get_bytes_avail(&ssl);
+    if (avail > 0) return avail + pending;
+
+    // Pull in the next record, if one has arrived
+    int ret = mbedtls_ssl_read(&ssl, nullptr, 0);
+    if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        if (ret != MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) fail("Read", ret);
+        stop();
+        return pending;
+    }
+    return mbedtls_ssl_get_bytes_avail(&ssl) + pending;
+}
+
+int TLSClient::read() {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+int TLSClient::read(uint8_t* buf, size_t size) {
+    if (size == 0) return 0;
+
+    int count = 0;
+    if (peeked >= 0) {
+        buf[count++] = (uint8_t)peeked;
+        peeked = -1;
+        if (size == 1) return 1;
+    }
+    if (!open) return count ? count : -1;
+
+    int ret = mbedtls_ssl_read(&ssl, buf + count, size - count);
+    if (ret > 0) return count + ret;
+    if (ret == 0 || (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE)) {
+        if (ret != 0 && ret != MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) fail("Read", ret);
+        stop();
+    }
+    return count ? count : -1;
+}
+
+int TLSClient::peek() {
+    if (peeked < 0) {
+        uint8_t b;
+        if (open && mbedtls_ssl_read(&ssl, &b, 1) == 1) peeked = b;
+    }
+    return peeked;
+}
+
+void TLSClient::flush() {
+}
+
+void TLSClient::stop() {
+    if (open) {
+        mbedtls_ssl_close_notify(&ssl);
+        open = false;
+    }
+    // The socket belongs to the WiFiClient, which closes it
+    net.fd = -1;
+    tcp.stop();
+}
+
+uint8_t TLSClient::connected() {
+    if (open && peeked < 0 && mbedtls_ssl_get_bytes_avail(&ssl) == 0) {
+        available();                // Notices a closed connection
+    }
+    return open || peeked >= 0;
+}
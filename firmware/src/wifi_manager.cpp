@@ -1,84 +1,183 @@
 /**
  * wifi_manager.cpp - WiFi connection handler
  * 
- * Handles initial connection, automatic reconnection,
- * and connection status monitoring.
+ * Event-driven and non-blocking: WiFi events record link up/down,
+ * and maintain() advances a small state machine
+ * (connecting -> connected -> waiting to retry) without delays.
+ * Failed attempts back off exponentially with random jitter.
+ * 
+ * The BSSID and channel of the last good access point are cached in
+ * NVS, so a reconnect can skip the full channel scan. If a cached
+ * attempt fails the cache is dropped and the next attempt scans.
  */
 
 #include "wifi_manager.h"
 #include "config.h"
 #include <WiFi.h>
+#include <Preferences.h>
+#include <atomic>
+
+enum WiFiState {
+    WIFI_CONNECTING,    // begin() called, waiting for an IP
+    WIFI_CONNECTED,
+    WIFI_WAITING        // Backing off before the next attempt
+};
+
+static WiFiState state = WIFI_CONNECTING;
+static unsigned long attemptStart = 0;
+static unsigned long retryDelay = 0;
+static int failedAttempts = 0;
+
+// Updated from the WiFi event task
+static std::atomic<bool> linkUp(false);
+static std::atomic<unsigned long> linkDownSince(0);
+
+// Access point cache (channel 0 = nothing cached)
+static uint8_t cachedBssid[6];
+static int32_t cachedChannel = 0;
+static bool attemptUsedCache = false;
+
+// Instrumentation
+static unsigned long lastConnectTime = 0;
+static unsigned long reconnectCount = 0;
+static bool everConnected = false;
+
+static void onWiFiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+    if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+        linkUp = true;
+    } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+        if (linkUp) linkDownSince = millis();
+        linkUp = false;
+    }
+}
 
-static unsigned long lastReconnectAttempt = 0;
-static int reconnectCount = 0;
+static void loadCache() {
+    Preferences prefs;
+    prefs.begin("wifi", true);
+    cachedChannel = prefs.getInt("channel", 0);
+    if (prefs.getBytes("bssid", cachedBssid, sizeof(cachedBssid)) != sizeof(cachedBssid)) {
+        cachedChannel = 0;
+    }
+    prefs.end();
+}
 
-void WiFiManager::init() {
-    WiFi.mode(WIFI_STA);
-    WiFi.setAutoReconnect(true);
-    WiFi.persistent(true);
+static void saveCache() {
+    const uint8_t* bssid = WiFi.BSSID();
+    int32_t channel = WiFi.channel();
+    if (!bssid || (channel == cachedChannel && memcmp(bssid, cachedBssid, sizeof(cachedBssid)) == 0)) {
+        return;
+    }
 
-    Serial.printf("[WiFi] Connecting to %s", WIFI_SSID);
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    memcpy(cachedBssid, bssid, sizeof(cachedBssid));
+    cachedChannel = channel;
+
+    Preferences prefs;
+    prefs.begin("wifi", false);
+    prefs.putBytes("bssid", cachedBssid, sizeof(cachedBssid));
+    prefs.putInt("channel", cachedChannel);
+    prefs.end();
+    Serial.printf("[WiFi] Cached AP %02X:%02X:%02X:%02X:%02X:%02X on channel %ld\n",
+                  cachedBssid[0], cachedBssid[1], cachedBssid[2],
+                  cachedBssid[3], cachedBssid[4], cachedBssid[5], (long)cachedChannel);
+}
 
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < WIFI_MAX_RETRIES) {
-        delay(1000);
-        Serial.print(".");
-        attempts++;
-    }
+static void clearCache() {
+    cachedChannel = 0;
+    Preferences prefs;
+    prefs.begin("wifi", false);
+    prefs.clear();
+    prefs.end();
+}
 
-    if (WiFi.status() == WL_CONNECTED) {
-        Serial.println(" Connected!");
-        Serial.printf("[WiFi] IP: %s\n", WiFi.localIP().toString().c_str());
-        Serial.printf("[WiFi] RSSI: %d dBm\n", WiFi.RSSI());
-        Serial.printf("[WiFi] MAC: %s\n", WiFi.macAddress().c_str());
-        reconnectCount = 0;
+static void startAttempt() {
+    attemptUsedCache = cachedChannel > 0;
+    if (attemptUsedCache) {
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD, cachedChannel, cachedBssid);
     } else {
-        Serial.println(" FAILED!");
-        Serial.printf("[WiFi] Could not connect after %d attempts. Rebooting...\n", WIFI_MAX_RETRIES);
-        delay(2000);
-        ESP.restart();
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
     }
+    attemptStart = millis();
+    state = WIFI_CONNECTING;
 }
 
-bool WiFiManager::maintain() {
-    if (WiFi.status() == WL_CONNECTED) {
-        reconnectCount = 0;
-        return true;
+static void onConnected() {
+    state = WIFI_CONNECTED;
+    failedAttempts = 0;
+    lastConnectTime = millis() - linkDownSince;
+    if (everConnected) reconnectCount++;
+    everConnected = true;
+
+    Serial.printf("[WiFi] Connected in %lu ms (%s). IP: %s, RSSI: %d dBm\n",
+                  lastConnectTime, attemptUsedCache ? "cached AP" : "scan",
+                  WiFi.localIP().toString().c_str(), WiFi.RSSI());
+    saveCache();
+}
+
+static void onAttemptFailed() {
+    failedAttempts++;
+    if (attemptUsedCache) {
+        Serial.println("[WiFi] Cached AP not reachable, next attempt scans");
+        clearCache();
     }
 
-    unsigned long now = millis();
-    if (now - lastReconnectAttempt < WIFI_RETRY_DELAY) {
-        return false;
+    if (failedAttempts >= WIFI_MAX_RETRIES) {
+        Serial.println("[WiFi] Max retries reached. Rebooting...");
+        delay(2000);
+        ESP.restart();
     }
 
-    lastReconnectAttempt = now;
-    reconnectCount++;
+    // Exponential backoff, randomized between 50% and 100%
+    unsigned long backoff = WIFI_RETRY_DELAY;
+    for (int i = 1; i < failedAttempts && backoff < WIFI_BACKOFF_MAX; i++) backoff *= 2;
+    backoff = min(backoff, (unsigned long)WIFI_BACKOFF_MAX);
+    retryDelay = backoff / 2 + random(backoff / 2 + 1);
 
-    Serial.printf("[WiFi] Connection lost. Reconnect attempt %d/%d\n", 
-                  reconnectCount, WIFI_MAX_RETRIES);
+    Serial.printf("[WiFi] Attempt %d/%d failed, retrying in %lu ms\n",
+                  failedAttempts, WIFI_MAX_RETRIES, retryDelay);
+    attemptStart = millis();
+    state = WIFI_WAITING;
+}
 
-    WiFi.disconnect();
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+void WiFiManager::init() {
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false);   // Reconnects are driven by maintain()
+    WiFi.persistent(false);         // Credentials come from config.h
+    WiFi.onEvent(onWiFiEvent);
 
-    // Wait briefly for connection
-    unsigned long start = millis();
-    while (WiFi.status() != WL_CONNECTED && millis() - start < WIFI_TIMEOUT_MS) {
-        delay(100);
-    }
+    loadCache();
+    linkDownSince = millis();
 
-    if (WiFi.status() == WL_CONNECTED) {
-        Serial.printf("[WiFi] Reconnected. IP: %s\n", WiFi.localIP().toString().c_str());
-        reconnectCount = 0;
-        return true;
-    }
+    Serial.printf("[WiFi] Connecting to %s (%s)\n", WIFI_SSID, cachedChannel ? "cached AP" : "scan");
+    Serial.printf("[WiFi] MAC: %s\n", WiFi.macAddress().c_str());
+    startAttempt();
+}
 
-    if (reconnectCount >= WIFI_MAX_RETRIES) {
-        Serial.println("[WiFi] Max retries reached. Rebooting...");
-        delay(2000);
-        ESP.restart();
-    }
+bool WiFiManager::maintain() {
+    switch (state) {
+    case WIFI_CONNECTED:
+        if (linkUp) return true;
+        Serial.println("[WiFi] Connection lost. Reconnecting...");
+        failedAttempts = 0;
+        startAttempt();
+        return false;
 
+    case WIFI_CONNECTING:
+        if (linkUp) {
+            onConnected();
+            return true;
+        }
+        if (millis() - attemptStart >= WIFI_TIMEOUT_MS) {
+            WiFi.disconnect();
+            onAttemptFailed();
+        }
+        return false;
+
+    case WIFI_WAITING:
+        if (millis() - attemptStart >= retryDelay) {
+            startAttempt();
+        }
+        return false;
+    }
     return false;
 }
 
@@ -97,3 +196,11 @@ String WiFiManager::getIP() {
 String WiFiManager::getMAC() {
     return WiFi.macAddress();
 }
+
+unsigned long WiFiManager::getLastConnectTime() {
+    return lastConnectTime;
+}
+
+unsigned long WiFiManager::getReconnectCount() {
+    return reconnectCount;
+}
@@ -0,0 +1,122 @@
+/**
+ * test_main.cpp - Soil ADC filter on sample traces
+ *
+ * Runs on the host (pio test -e native), from the project directory.
+ * Traces are blocks of 12-bit ADC samples in traces/, one sample per
+ * line ('#' lines are comments); a block recorded on the board can be
+ * dropped in next to them. The current traces are synthetic, with a
+ * known level and noise.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include "adc_filter.h"
+
+#define TRACE_DIR   "test/test_adc_filter/traces/"
+#define MAX_SAMPLES 2048
+
+static uint16_t samples[MAX_SAMPLES];
+
+/**
+ * Read a trace into 'samples'. Returns the number of samples.
+ */
+static size_t loadTrace(const char* name) {
+    char path[128];
+    snprintf(path, sizeof(path), TRACE_DIR "%s", name);
+    FILE* file = fopen(path, "r");
+    TEST_ASSERT_NOT_NULL_MESSAGE(file, path);
+
+    size_t count = 0;
+    char line[128];
+    while (fgets(line, sizeof(line), file) && count < MAX_SAMPLES) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        samples[count++] = (uint16_t)atoi(line);
+    }
+    fclose(file);
+    TEST_ASSERT_GREATER_THAN(0, count);
+    return count;
+}
+
+static float plainMean(size_t count) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < count; i++) sum += samples[i];
+    return (float)sum / count;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_empty_block(void) {
+    AdcFilterResult result = AdcFilter::apply(samples, 0);
+    TEST_ASSERT_EQUAL(0, result.count);
+    TEST_ASSERT_FLOAT_WITHIN(0.0f, 0.0f, result.value);
+}
+
+static void test_single_sample(void) {
+    samples[0] = 1234;
+    AdcFilterResult result = AdcFilter::apply(samples, 1);
+    TEST_ASSERT_EQUAL(1, result.count);
+    TEST_ASSERT_EQUAL(1234, result.median);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1234.0f, result.value);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, result.noise);
+}
+
+static void test_constant_block_has_no_noise(void) {
+    for (size_t i = 0; i < 100; i++) samples[i] = 2000;
+    AdcFilterResult result = AdcFilter::apply(samples, 100);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 2000.0f, result.value);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, result.noise);
+}
+
+static void test_resolution_below_one_step(void) {
+    // Dithered between two codes: the mean lands between them
+    for (size_t i = 0; i < 400; i++) samples[i] = (i % 2) ? 2001 : 2000;
+    AdcFilterResult result = AdcFilter::apply(samples, 400);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 2000.5f, result.value);
+}
+
+static void test_wet_clean_trace(void) {
+    size_t count = loadTrace("wet_clean.csv");
+    AdcFilterResult result = AdcFilter::apply(samples, count);
+    TEST_ASSERT_EQUAL(count, result.count);
+    TEST_ASSERT_FLOAT_WITHIN(1.5f, 2150.0f, result.value);
+    TEST_ASSERT_INT_WITHIN(2, 2150, result.median);
+    TEST_ASSERT_FLOAT_WITHIN(2.0f, 6.0f, result.noise);
+}
+
+static void test_wet_spikes_trace(void) {
+    size_t count = loadTrace("wet_spikes.csv");
+    float mean = plainMean(count);
+    AdcFilterResult result = AdcFilter::apply(samples, count);
+
+    // The glitches pull a plain mean far off; the filter ignores them
+    TEST_ASSERT_TRUE(fabsf(mean - 2150.0f) > 20.0f);
+    TEST_ASSERT_FLOAT_WITHIN(1.5f, 2150.0f, result.value);
+    TEST_ASSERT_INT_WITHIN(2, 2150, result.median);
+    TEST_ASSERT_FLOAT_WITHIN(2.0f, 6.0f, result.noise);
+}
+
+static void test_dry_noisy_trace(void) {
+    size_t count = loadTrace("dry_noisy.csv");
+    AdcFilterResult result = AdcFilter::apply(samples, count);
+    TEST_ASSERT_FLOAT_WITHIN(3.0f, 3100.0f, result.value);
+    TEST_ASSERT_FLOAT_WITHIN(3.0f, 12.0f, result.noise);
+}
+
+void setup() {
+    delay(100);
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_block);
+    RUN_TEST(test_single_sample);
+    RUN_TEST(test_constant_block_has_no_noise);
+    RUN_TEST(test_resolution_below_one_step);
+    RUN_TEST(test_wet_clean_trace);
+    RUN_TEST(test_wet_spikes_trace);
+    RUN_TEST(test_dry_noisy_trace);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,119 @@
+/**
+ * test_main.cpp - Heap allocation counts and traced call sites
+ *
+ * Runs on the host. env:native counts allocations; the call site
+ * tests need ALLOC_TRACE and are ignored without it:
+ *   pio test -e native_trace -f test_alloc_counter
+ * Each site below allocates a distinctive number of bytes, so it can
+ * be told apart from the allocations of the test runner.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <stdlib.h>
+#include "config.h"
+#include "alloc_counter.h"
+
+static void* volatile kept;         // Keeps the allocations from being optimized out
+
+static __attribute__((noinline)) void allocateLarge() {
+    kept = malloc(200003);
+    free(kept);
+}
+
+static __attribute__((noinline)) void allocateMedium() {
+    for (int i = 0; i < 3; i++) {
+        kept = malloc(40001);
+        free(kept);
+    }
+}
+
+static __attribute__((noinline)) void allocateSmall() {
+    for (int i = 0; i < 7; i++) {
+        kept = calloc(1009, 1);
+        free(kept);
+    }
+}
+
+/**
+ * Position of the site with exactly 'count' allocations of 'bytes'
+ * in total, or -1.
+ */
+static int findSite(const AllocSite* sites, unsigned int found, unsigned long count, unsigned long bytes) {
+    for (unsigned int i = 0; i < found; i++) {
+        if (sites[i].count == count && sites[i].bytes == bytes) return i;
+    }
+    return -1;
+}
+
+void setUp(void) {
+    if (!AllocCounter::enabled()) TEST_IGNORE_MESSAGE("built without ALLOC_COUNTER");
+}
+
+void tearDown(void) {}
+
+static void test_counts_each_call(void) {
+    unsigned long count = AllocCounter::count();
+    unsigned long bytes = AllocCounter::bytes();
+
+    kept = malloc(100);
+    kept = realloc(kept, 300);
+    free(kept);
+    kept = calloc(4, 25);
+    free(kept);
+
+    TEST_ASSERT_EQUAL(3, AllocCounter::count() - count);
+    TEST_ASSERT_EQUAL(500, AllocCounter::bytes() - bytes);
+}
+
+static void test_top_sites_largest_first(void) {
+    if (!AllocCounter::tracing()) TEST_IGNORE_MESSAGE("built without ALLOC_TRACE");
+
+    allocateSmall();
+    allocateLarge();
+    allocateMedium();
+
+    AllocSite sites[ALLOC_TRACE_SITES + 1];
+    unsigned int found = AllocCounter::topSites(sites, ALLOC_TRACE_SITES + 1);
+    TEST_ASSERT_GREATER_OR_EQUAL(3, found);
+    for (unsigned int i = 1; i < found; i++) {
+        TEST_ASSERT_TRUE(sites[i - 1].bytes >= sites[i].bytes);
+    }
+
+    int large = findSite(sites, found, 1, 200003);
+    int medium = findSite(sites, found, 3, 3 * 40001);
+    int small = findSite(sites, found, 7, 7 * 1009);
+    TEST_ASSERT_TRUE(large >= 0 && medium >= 0 && small >= 0);
+    TEST_ASSERT_TRUE(large < medium);
+    TEST_ASSERT_TRUE(medium < small);
+    TEST_ASSERT_NOT_EQUAL(0, sites[large].address);
+}
+
+static void test_top_sites_truncated(void) {
+    if (!AllocCounter::tracing()) TEST_IGNORE_MESSAGE("built without ALLOC_TRACE");
+
+    allocateLarge();
+    AllocSite all[ALLOC_TRACE_SITES + 1];
+    unsigned int found = AllocCounter::topSites(all, ALLOC_TRACE_SITES + 1);
+
+    // Only the largest sites, in the same order
+    AllocSite top[2];
+    TEST_ASSERT_EQUAL(2, AllocCounter::topSites(top, 2));
+    TEST_ASSERT_GREATER_OR_EQUAL(2, found);
+    for (unsigned int i = 0; i < 2; i++) {
+        TEST_ASSERT_EQUAL(all[i].bytes, top[i].bytes);
+        TEST_ASSERT_EQUAL(all[i].address, top[i].address);
+    }
+    TEST_ASSERT_EQUAL(0, AllocCounter::topSites(top, 0));
+}
+
+void setup() {
+    delay(100);
+    UNITY_BEGIN();
+    RUN_TEST(test_counts_each_call);
+    RUN_TEST(test_top_sites_largest_first);
+    RUN_TEST(test_top_sites_truncated);
+    exit(UNITY_END());
+}
+
+void loop() {}
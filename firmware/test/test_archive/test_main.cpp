@@ -0,0 +1,166 @@
+/**
+ * test_main.cpp - Daily archive on a directory-backed filesystem
+ *
+ * Runs on the host (pio test -e native); the archive lives in
+ * test_sdcard/archive under the project directory. Days are local
+ * dates, so the tests run in UTC.
+ */
+
+#include <Arduino.h>
+#include <FS.h>
+#include <unity.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+#include "config.h"
+#include "archive.h"
+
+#define TEST_ROOT   "test_sdcard/archive"
+#define ARCHIVE_DIR "/archive"
+#define DAY1        1767225600UL        // 2026-01-01 00:00 UTC
+#define DAY2        (DAY1 + 86400)
+
+static fs::FS testFs(TEST_ROOT);
+static uint32_t readingNumber = 0;
+static unsigned int found = 0;
+
+static ReadingRecord makeRecord(uint32_t epoch) {
+    ReadingRecord record = {};
+    record.version = RECORD_VERSION;
+    record.flags = RECORD_FLAG_TIME;
+    record.epoch = epoch;
+    record.reading = ++readingNumber;
+    RecordCodec::seal(record);
+    return record;
+}
+
+static void appendDay(uint32_t day, unsigned int count) {
+    for (unsigned int i = 0; i < count; i++) {
+        TEST_ASSERT_TRUE(Archive::append(makeRecord(day + 3600 + i * 60)));
+    }
+}
+
+static bool countReading(const ReadingRecord& record) {
+    (void)record;
+    found++;
+    return true;
+}
+
+static unsigned int countRange(uint32_t start, uint32_t end) {
+    found = 0;
+    Archive::query(start, end, countReading, 100000);
+    return found;
+}
+
+static std::vector<uint8_t> readFile(const char* path) {
+    std::vector<uint8_t> data;
+    File f = testFs.open(path, FILE_READ);
+    if (!f) return data;
+    data.resize(f.size());
+    f.read(data.data(), data.size());
+    f.close();
+    return data;
+}
+
+void setUp(void) {
+    system("rm -rf " TEST_ROOT " && mkdir -p " TEST_ROOT "/archive");
+    TEST_ASSERT_TRUE(Archive::begin(testFs, ARCHIVE_DIR));
+}
+
+void tearDown(void) {}
+
+static void test_day_change_seals_block(void) {
+    appendDay(DAY1, 10);
+    TEST_ASSERT_EQUAL(10, Archive::openCount());
+    appendDay(DAY2, 3);
+
+    TEST_ASSERT_EQUAL(3, Archive::openCount());
+    TEST_ASSERT_TRUE(testFs.exists(ARCHIVE_DIR "/2026-01-01.arc"));
+    TEST_ASSERT_TRUE(testFs.exists(ARCHIVE_DIR "/2026-01-01.idx"));
+    TEST_ASSERT_EQUAL(10, countRange(DAY1, DAY2 - 1));
+    TEST_ASSERT_EQUAL(13, countRange(DAY1, DAY2 + 86399));
+}
+
+static void test_full_block_sealed(void) {
+    appendDay(DAY1, ARCHIVE_BLOCK_RECORDS + 5);
+    TEST_ASSERT_EQUAL(5, Archive::openCount());
+    TEST_ASSERT_EQUAL(ARCHIVE_BLOCK_RECORDS + 5, countRange(DAY1, DAY2 - 1));
+}
+
+static void test_reopen_keeps_open_block(void) {
+    appendDay(DAY1, 10);
+    TEST_ASSERT_TRUE(Archive::begin(testFs, ARCHIVE_DIR));
+    TEST_ASSERT_EQUAL(10, Archive::openCount());
+    appendDay(DAY2, 1);
+    TEST_ASSERT_EQUAL(10, countRange(DAY1, DAY2 - 1));
+}
+
+static void test_reset_after_seal_not_written_twice(void) {
+    appendDay(DAY1, 10);
+    std::vector<uint8_t> openBlock = readFile(ARCHIVE_DIR "/open.rec");
+    TEST_ASSERT_EQUAL(10 * sizeof(ReadingRecord), openBlock.size());
+
+    // Seal day 1, then put its open.rec back as if the reset came
+    // before the file was removed
+    appendDay(DAY2, 1);
+    size_t sealedSize = readFile(ARCHIVE_DIR "/2026-01-01.arc").size();
+    File f = testFs.open(ARCHIVE_DIR "/open.rec", FILE_WRITE);
+    f.write(openBlock.data(), openBlock.size());
+    f.close();
+
+    TEST_ASSERT_TRUE(Archive::begin(testFs, ARCHIVE_DIR));
+    TEST_ASSERT_EQUAL(10, Archive::openCount());
+    appendDay(DAY2, 1);
+    TEST_ASSERT_EQUAL(sealedSize, readFile(ARCHIVE_DIR "/2026-01-01.arc").size());
+    TEST_ASSERT_EQUAL(10, countRange(DAY1, DAY2 - 1));
+}
+
+static void test_undated_readings_removed_first(void) {
+    for (int i = 0; i < 5; i++) {
+        ReadingRecord record = makeRecord(600 + i * 60);       // Uptime only
+        record.flags = RECORD_FLAG_UPTIME;
+        RecordCodec::seal(record);
+        TEST_ASSERT_TRUE(Archive::append(record));
+    }
+    TEST_ASSERT_EQUAL(0, countRange(0, DAY2 + 86399));
+
+    // Not while it is the block being written
+    TEST_ASSERT_FALSE(Archive::removeOldestDay());
+    appendDay(DAY1, 3);
+    appendDay(DAY2, 3);
+    TEST_ASSERT_TRUE(testFs.exists(ARCHIVE_DIR "/unknown.arc"));
+
+    unsigned long before = Archive::bytes();
+    TEST_ASSERT_TRUE(Archive::removeOldestDay());
+    TEST_ASSERT_FALSE(testFs.exists(ARCHIVE_DIR "/unknown.arc"));
+    TEST_ASSERT_TRUE(testFs.exists(ARCHIVE_DIR "/2026-01-01.arc"));
+    TEST_ASSERT_LESS_THAN(before, Archive::bytes());
+
+    // Then the dated days, oldest first
+    TEST_ASSERT_TRUE(Archive::removeOldestDay());
+    TEST_ASSERT_FALSE(testFs.exists(ARCHIVE_DIR "/2026-01-01.arc"));
+    TEST_ASSERT_EQUAL(3, countRange(DAY1, DAY2 + 86399));
+}
+
+static void test_directory_too_long_rejected(void) {
+    // A longer directory would leave no room for the day file names
+    TEST_ASSERT_FALSE(Archive::begin(testFs, "/data/a-directory-name-too-long"));
+    TEST_ASSERT_FALSE(Archive::append(makeRecord(DAY1)));
+}
+
+void setup() {
+    delay(100);
+    setenv("TZ", "UTC0", 1);
+    tzset();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_day_change_seals_block);
+    RUN_TEST(test_full_block_sealed);
+    RUN_TEST(test_reopen_keeps_open_block);
+    RUN_TEST(test_reset_after_seal_not_written_twice);
+    RUN_TEST(test_undated_readings_removed_first);
+    RUN_TEST(test_directory_too_long_rejected);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,152 @@
+/**
+ * test_main.cpp - Archive block encoding and decoding
+ *
+ * Runs on the host (pio test -e native).
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <string.h>
+#include "config.h"
+#include "archive_codec.h"
+
+#define BASE_EPOCH  1767225600UL        // 2026-01-01
+
+static ReadingRecord records[ARCHIVE_BLOCK_RECORDS];
+static ReadingRecord decoded[ARCHIVE_BLOCK_RECORDS];
+static uint8_t packed[ARCHIVE_MAX_BYTES(ARCHIVE_BLOCK_RECORDS)];
+
+/**
+ * A reading every 60 s with slowly drifting values, as logged.
+ */
+static ReadingRecord steadyRecord(uint32_t n) {
+    ReadingRecord r = {};
+    r.version = RECORD_VERSION;
+    r.flags = RECORD_FLAG_TIME | RECORD_FLAG_SCD30 | RECORD_FLAG_BH1750 | RECORD_FLAG_SOIL;
+    r.boot = 12;
+    r.epoch = BASE_EPOCH + n * 60;
+    r.reading = 1000 + n;
+    r.co2 = 4500 + n % 7;
+    r.temperature = 2150 - (int16_t)(n % 5);
+    r.humidity = 650 + n % 3;
+    r.light = 124500 + n * 10;
+    r.soilMoisture = 425;
+    r.soilRaw = 2150 + n % 4;
+    RecordCodec::seal(r);
+    return r;
+}
+
+static void assertRoundTrip(uint16_t count) {
+    ArchiveBlockHeader header;
+    size_t length = ArchiveCodec::encode(records, count, packed, sizeof(packed), header);
+    TEST_ASSERT_GREATER_THAN(0, length);
+    TEST_ASSERT_LESS_OR_EQUAL(ARCHIVE_MAX_BYTES(count), length);
+    TEST_ASSERT_TRUE(ArchiveCodec::isHeader(header));
+    TEST_ASSERT_EQUAL(count, header.count);
+    TEST_ASSERT_EQUAL(length, header.length);
+    TEST_ASSERT_EQUAL(records[0].epoch, header.firstEpoch);
+    TEST_ASSERT_EQUAL(records[count - 1].epoch, header.lastEpoch);
+
+    memset(decoded, 0, sizeof(decoded));
+    TEST_ASSERT_EQUAL(count, ArchiveCodec::decode(header, packed, decoded, ARCHIVE_BLOCK_RECORDS));
+    for (uint16_t i = 0; i < count; i++) {
+        TEST_ASSERT_TRUE(RecordCodec::isValid(decoded[i]));
+        TEST_ASSERT_EQUAL_MEMORY(&records[i], &decoded[i], sizeof(ReadingRecord));
+    }
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_steady_block_round_trip(void) {
+    for (uint32_t i = 0; i < ARCHIVE_BLOCK_RECORDS; i++) records[i] = steadyRecord(i);
+    assertRoundTrip(ARCHIVE_BLOCK_RECORDS);
+}
+
+static void test_steady_block_compresses(void) {
+    for (uint32_t i = 0; i < ARCHIVE_BLOCK_RECORDS; i++) records[i] = steadyRecord(i);
+    ArchiveBlockHeader header;
+    size_t length = ArchiveCodec::encode(records, ARCHIVE_BLOCK_RECORDS, packed, sizeof(packed), header);
+
+    // Under a quarter of the 32 bytes per reading in the buffer log
+    TEST_ASSERT_LESS_THAN(ARCHIVE_BLOCK_RECORDS * sizeof(ReadingRecord) / 4, length);
+}
+
+static void test_single_record_round_trip(void) {
+    records[0] = steadyRecord(0);
+    assertRoundTrip(1);
+}
+
+static void test_every_bucket_round_trips(void) {
+    // Deltas of 0, 7-bit, 9-bit, 12-bit and 32-bit size, both signs,
+    // field extremes and sign changes of the signed fields
+    static const int32_t steps[] = { 0, 1, -1, 63, -64, 64, -65, 255, -256, 256, -257,
+                                     2047, -2048, 2048, -2049, 100000, -100000 };
+    const size_t stepCount = sizeof(steps) / sizeof(steps[0]);
+    ReadingRecord r = steadyRecord(0);
+    for (uint32_t i = 0; i < ARCHIVE_BLOCK_RECORDS; i++) {
+        int32_t step = steps[i % stepCount];
+        r.epoch += 60 + step;
+        r.reading += 1 + step;
+        r.boot = (i % 9 == 0) ? 0xFFFF : (uint16_t)(12 + i);
+        r.flags = (uint8_t)(i * 37);
+        r.co2 += step;
+        r.temperature = (i % 2) ? INT16_MIN + i : INT16_MAX - i;
+        r.humidity += (uint16_t)step;
+        r.light = (i % 11 == 0) ? 0xFFFFFFFFu : r.light + step;
+        r.soilMoisture = (int16_t)-r.soilMoisture + (int16_t)step;
+        r.soilRaw = (uint16_t)(i * 641);
+        RecordCodec::seal(r);
+        records[i] = r;
+    }
+    assertRoundTrip(ARCHIVE_BLOCK_RECORDS);
+}
+
+static void test_corrupted_block_rejected(void) {
+    for (uint32_t i = 0; i < ARCHIVE_BLOCK_RECORDS; i++) records[i] = steadyRecord(i);
+    ArchiveBlockHeader header;
+    size_t length = ArchiveCodec::encode(records, ARCHIVE_BLOCK_RECORDS, packed, sizeof(packed), header);
+
+    packed[length / 2] ^= 0x10;
+    TEST_ASSERT_EQUAL(0, ArchiveCodec::decode(header, packed, decoded, ARCHIVE_BLOCK_RECORDS));
+    packed[length / 2] ^= 0x10;
+
+    ArchiveBlockHeader bad = header;
+    bad.lastEpoch++;
+    TEST_ASSERT_EQUAL(0, ArchiveCodec::decode(bad, packed, decoded, ARCHIVE_BLOCK_RECORDS));
+
+    bad = header;
+    bad.magic ^= 1;
+    TEST_ASSERT_FALSE(ArchiveCodec::isHeader(bad));
+    TEST_ASSERT_EQUAL(ARCHIVE_BLOCK_RECORDS,
+                      ArchiveCodec::decode(header, packed, decoded, ARCHIVE_BLOCK_RECORDS));
+}
+
+static void test_small_buffers(void) {
+    for (uint32_t i = 0; i < ARCHIVE_BLOCK_RECORDS; i++) records[i] = steadyRecord(i);
+    ArchiveBlockHeader header;
+    size_t length = ArchiveCodec::encode(records, ARCHIVE_BLOCK_RECORDS, packed, sizeof(packed), header);
+
+    // Output that does not fit is refused, not truncated
+    TEST_ASSERT_EQUAL(0, ArchiveCodec::encode(records, ARCHIVE_BLOCK_RECORDS, packed, length - 1, header));
+
+    // A block with more records than the caller has room for
+    length = ArchiveCodec::encode(records, ARCHIVE_BLOCK_RECORDS, packed, sizeof(packed), header);
+    TEST_ASSERT_GREATER_THAN(0, length);
+    TEST_ASSERT_EQUAL(0, ArchiveCodec::decode(header, packed, decoded, ARCHIVE_BLOCK_RECORDS - 1));
+}
+
+void setup() {
+    delay(100);
+    UNITY_BEGIN();
+    RUN_TEST(test_steady_block_round_trip);
+    RUN_TEST(test_steady_block_compresses);
+    RUN_TEST(test_single_record_round_trip);
+    RUN_TEST(test_every_bucket_round_trips);
+    RUN_TEST(test_corrupted_block_rejected);
+    RUN_TEST(test_small_buffers);
+    exit(UNITY_END());
+}
+
+void loop() {}
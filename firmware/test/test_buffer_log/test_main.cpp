@@ -0,0 +1,176 @@
+/**
+ * test_main.cpp - Buffer log on a directory-backed filesystem
+ *
+ * Runs on the host (pio test -e native); the log lives in
+ * test_sdcard/buffer_log under the project directory.
+ */
+
+#include <Arduino.h>
+#include <FS.h>
+#include <unity.h>
+#include "config.h"
+#include "buffer_log.h"
+
+#define TEST_ROOT   "test_sdcard/buffer_log"
+#define LOG_DIR     "/buffer"
+#define BASE_EPOCH  1767225600UL        // 2026-01-01
+
+static fs::FS testFs(TEST_ROOT);
+
+static ReadingRecord makeRecord(uint32_t n) {
+    ReadingRecord record = {};
+    record.version = RECORD_VERSION;
+    record.flags = RECORD_FLAG_TIME;
+    record.epoch = BASE_EPOCH + n * 60;
+    record.reading = n;
+    RecordCodec::seal(record);
+    return record;
+}
+
+static void appendRange(uint32_t from, uint32_t count) {
+    for (uint32_t n = from; n < from + count; n++) {
+        TEST_ASSERT_TRUE(BufferLog::append(makeRecord(n)));
+    }
+}
+
+static bool segmentExists(uint32_t seg) {
+    char path[SD_PATH_MAX];
+    snprintf(path, sizeof(path), LOG_DIR "/%08lu.rec", (unsigned long)seg);
+    return testFs.exists(path);
+}
+
+static uint32_t nextExpected = 0;
+
+static bool expectInOrder(const ReadingRecord& record) {
+    if (record.reading != nextExpected) return false;
+    nextExpected++;
+    return true;
+}
+
+void setUp(void) {
+    system("rm -rf " TEST_ROOT " && mkdir -p " TEST_ROOT);
+    TEST_ASSERT_TRUE(BufferLog::begin(testFs, LOG_DIR));
+}
+
+void tearDown(void) {}
+
+static void test_empty_log(void) {
+    ReadingRecord record;
+    TEST_ASSERT_EQUAL(0, BufferLog::count());
+    TEST_ASSERT_FALSE(BufferLog::peek(record));
+    TEST_ASSERT_FALSE(BufferLog::pop());
+    TEST_ASSERT_EQUAL(0, BufferLog::oldestEpoch());
+}
+
+static void test_fifo_across_segments(void) {
+    const uint32_t total = 3 * SD_SEGMENT_RECORDS + 17;
+    appendRange(0, total);
+    TEST_ASSERT_EQUAL(total, BufferLog::count());
+    TEST_ASSERT_EQUAL(total * sizeof(ReadingRecord), BufferLog::bytes());
+    TEST_ASSERT_EQUAL(BASE_EPOCH, BufferLog::oldestEpoch());
+    TEST_ASSERT_EQUAL(BASE_EPOCH + (total - 1) * 60, BufferLog::newestEpoch());
+
+    for (uint32_t n = 0; n < total; n++) {
+        ReadingRecord record;
+        TEST_ASSERT_TRUE(BufferLog::peek(record));
+        TEST_ASSERT_EQUAL(n, record.reading);
+        TEST_ASSERT_TRUE(BufferLog::pop());
+    }
+    TEST_ASSERT_EQUAL(0, BufferLog::count());
+}
+
+static void test_peek_batch_skips_and_spans_segments(void) {
+    appendRange(0, 2 * SD_SEGMENT_RECORDS);
+
+    ReadingRecord records[SD_FLUSH_MAX_BATCH];
+    unsigned long skip = SD_SEGMENT_RECORDS - 5;
+    TEST_ASSERT_EQUAL(SD_FLUSH_MAX_BATCH, BufferLog::peekBatch(records, SD_FLUSH_MAX_BATCH, skip));
+    for (unsigned int i = 0; i < SD_FLUSH_MAX_BATCH; i++) {
+        TEST_ASSERT_EQUAL(skip + i, records[i].reading);
+    }
+
+    // Nothing removed; past the end returns the rest
+    TEST_ASSERT_EQUAL(2 * SD_SEGMENT_RECORDS, BufferLog::count());
+    TEST_ASSERT_EQUAL(3, BufferLog::peekBatch(records, SD_FLUSH_MAX_BATCH, 2 * SD_SEGMENT_RECORDS - 3));
+    TEST_ASSERT_EQUAL(0, BufferLog::peekBatch(records, SD_FLUSH_MAX_BATCH, 2 * SD_SEGMENT_RECORDS));
+}
+
+static void test_consumed_segments_are_deleted(void) {
+    appendRange(0, 2 * SD_SEGMENT_RECORDS + 1);
+    TEST_ASSERT_TRUE(segmentExists(1));
+
+    TEST_ASSERT_EQUAL(SD_SEGMENT_RECORDS - 1, BufferLog::popBatch(SD_SEGMENT_RECORDS - 1));
+    TEST_ASSERT_TRUE(segmentExists(1));
+    TEST_ASSERT_EQUAL(1, BufferLog::popBatch(1));
+    TEST_ASSERT_FALSE(segmentExists(1));
+    TEST_ASSERT_TRUE(segmentExists(2));
+    TEST_ASSERT_EQUAL(SD_SEGMENT_RECORDS + 1, BufferLog::count());
+}
+
+static void test_drain_stops_at_callback_failure(void) {
+    appendRange(0, 100);
+    nextExpected = 0;
+    TEST_ASSERT_EQUAL(60, BufferLog::drain(expectInOrder, 60));
+    TEST_ASSERT_EQUAL(40, BufferLog::count());
+
+    // A failed callback leaves the reading in the log
+    nextExpected = 0;
+    TEST_ASSERT_EQUAL(0, BufferLog::drain(expectInOrder, 100));
+    TEST_ASSERT_EQUAL(40, BufferLog::count());
+
+    nextExpected = 60;
+    TEST_ASSERT_EQUAL(40, BufferLog::drain(expectInOrder, 100));
+    TEST_ASSERT_EQUAL(0, BufferLog::count());
+}
+
+static void test_reopen_restores_cursor(void) {
+    appendRange(0, SD_SEGMENT_RECORDS + 40);
+    TEST_ASSERT_EQUAL(SD_SEGMENT_RECORDS + 10, BufferLog::popBatch(SD_SEGMENT_RECORDS + 10));
+
+    TEST_ASSERT_TRUE(BufferLog::begin(testFs, LOG_DIR));
+    TEST_ASSERT_EQUAL(30, BufferLog::count());
+    ReadingRecord record;
+    TEST_ASSERT_TRUE(BufferLog::peek(record));
+    TEST_ASSERT_EQUAL(SD_SEGMENT_RECORDS + 10, record.reading);
+    TEST_ASSERT_EQUAL(record.epoch, BufferLog::oldestEpoch());
+}
+
+/**
+ * Dequeue cost must not depend on the backlog: one metadata save,
+ * no file rewrite.
+ */
+static void test_pop_cost_is_independent_of_backlog(void) {
+    appendRange(0, 10);
+    unsigned long before = BufferLog::bytesWritten();
+    TEST_ASSERT_TRUE(BufferLog::pop());
+    unsigned long small = BufferLog::bytesWritten() - before;
+
+    appendRange(10, 10 * SD_SEGMENT_RECORDS);
+    before = BufferLog::bytesWritten();
+    TEST_ASSERT_TRUE(BufferLog::pop());
+    unsigned long large = BufferLog::bytesWritten() - before;
+
+    TEST_ASSERT_EQUAL(small, large);
+    TEST_ASSERT_LESS_OR_EQUAL(64, large);
+}
+
+static void test_directory_too_long_rejected(void) {
+    // A longer directory would leave no room for the segment names
+    TEST_ASSERT_FALSE(BufferLog::begin(testFs, "/data/a-directory-name-too-long"));
+    TEST_ASSERT_FALSE(BufferLog::append(makeRecord(0)));
+}
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_log);
+    RUN_TEST(test_fifo_across_segments);
+    RUN_TEST(test_peek_batch_skips_and_spans_segments);
+    RUN_TEST(test_consumed_segments_are_deleted);
+    RUN_TEST(test_drain_stops_at_callback_failure);
+    RUN_TEST(test_reopen_restores_cursor);
+    RUN_TEST(test_pop_cost_is_independent_of_backlog);
+    RUN_TEST(test_directory_too_long_rejected);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,138 @@
+/**
+ * test_main.cpp - Latency histogram buckets and percentiles
+ *
+ * Runs on the host (pio test -e native). The buckets are reached
+ * through Latency::record() and take(): a value recorded twice next to
+ * a much larger one is reported as p50, i.e. as its bucket's upper
+ * edge.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "latency.h"
+
+#define STAGE       STAGE_SD_WRITE
+#define LARGE_US    (1UL << 30)
+
+/**
+ * Upper edge of the bucket 'us' is counted into.
+ */
+static uint32_t bucketTopOf(uint32_t us) {
+    Latency::record(STAGE, us);
+    Latency::record(STAGE, us);
+    Latency::record(STAGE, LARGE_US);
+    return Latency::take(STAGE).p50;
+}
+
+void setUp(void) {
+    Latency::take(STAGE);
+}
+
+void tearDown(void) {}
+
+static void test_empty_stage(void) {
+    LatencySummary summary = Latency::take(STAGE);
+    TEST_ASSERT_EQUAL(0, summary.count);
+    TEST_ASSERT_EQUAL(0, summary.p50);
+    TEST_ASSERT_EQUAL(0, summary.p99);
+    TEST_ASSERT_EQUAL(0, summary.max);
+}
+
+static void test_small_values_exact(void) {
+    for (uint32_t us = 0; us < 8; us++) {
+        TEST_ASSERT_EQUAL(us, bucketTopOf(us));
+    }
+}
+
+static void test_bucket_edges(void) {
+    // 100 us: octave 64-127, third quarter (96-111)
+    TEST_ASSERT_EQUAL(111, bucketTopOf(96));
+    TEST_ASSERT_EQUAL(111, bucketTopOf(100));
+    TEST_ASSERT_EQUAL(111, bucketTopOf(111));
+    TEST_ASSERT_EQUAL(127, bucketTopOf(112));
+    TEST_ASSERT_EQUAL(159, bucketTopOf(128));
+    TEST_ASSERT_EQUAL(9, bucketTopOf(8));
+    TEST_ASSERT_EQUAL(9, bucketTopOf(9));
+    TEST_ASSERT_EQUAL(11, bucketTopOf(10));
+}
+
+static void test_upper_edge_within_25_percent(void) {
+    for (uint32_t us = 1; us < (1UL << 24); us += (us < 65536) ? 1 : 997) {
+        uint32_t top = bucketTopOf(us);
+        char message[32];
+        snprintf(message, sizeof(message), "us %lu", (unsigned long)us);
+        TEST_ASSERT_TRUE_MESSAGE(top >= us, message);
+        TEST_ASSERT_TRUE_MESSAGE(top < us + us / 4 + 1, message);
+    }
+}
+
+static void test_top_capped_at_max(void) {
+    Latency::record(STAGE, 100);
+    Latency::record(STAGE, 1000);
+    LatencySummary summary = Latency::take(STAGE);
+    TEST_ASSERT_EQUAL(2, summary.count);
+    TEST_ASSERT_EQUAL(111, summary.p50);
+    TEST_ASSERT_EQUAL(1000, summary.p99);     // Bucket edge 1023, max 1000
+    TEST_ASSERT_EQUAL(1000, summary.max);
+}
+
+static void test_nearest_rank(void) {
+    // 98 of 100 runs fast: p99 is rank 99, one of the slow ones
+    for (int i = 0; i < 98; i++) Latency::record(STAGE, 10);
+    Latency::record(STAGE, 5000);
+    Latency::record(STAGE, 5000);
+    LatencySummary summary = Latency::take(STAGE);
+    TEST_ASSERT_EQUAL(100, summary.count);
+    TEST_ASSERT_EQUAL(11, summary.p50);
+    TEST_ASSERT_EQUAL(5000, summary.p99);
+
+    // 99 of 100: rank 99 is still fast
+    for (int i = 0; i < 99; i++) Latency::record(STAGE, 10);
+    Latency::record(STAGE, 5000);
+    summary = Latency::take(STAGE);
+    TEST_ASSERT_EQUAL(11, summary.p99);
+    TEST_ASSERT_EQUAL(5000, summary.max);
+
+    // Odd count: p50 is the middle value
+    Latency::record(STAGE, 10);
+    Latency::record(STAGE, 100);
+    Latency::record(STAGE, 1000);
+    TEST_ASSERT_EQUAL(111, Latency::take(STAGE).p50);
+}
+
+static void test_overflow_bucket(void) {
+    // From 16.8 s on there is one bucket; it reports the maximum
+    Latency::record(STAGE, 20000000);
+    Latency::record(STAGE, 20000000);
+    Latency::record(STAGE, 3000000000UL);
+    LatencySummary summary = Latency::take(STAGE);
+    TEST_ASSERT_EQUAL(3, summary.count);
+    TEST_ASSERT_EQUAL(3000000000UL, summary.max);
+    TEST_ASSERT_EQUAL(3000000000UL, summary.p50);
+    TEST_ASSERT_EQUAL(3000000000UL, summary.p99);
+}
+
+static void test_take_clears(void) {
+    Latency::record(STAGE, 50);
+    Latency::record(STAGE_WIFI, 70);
+    TEST_ASSERT_EQUAL(1, Latency::take(STAGE).count);
+    TEST_ASSERT_EQUAL(0, Latency::take(STAGE).count);
+    TEST_ASSERT_EQUAL(0, Latency::take(STAGE).max);
+    TEST_ASSERT_EQUAL(70, Latency::take(STAGE_WIFI).max);
+}
+
+void setup() {
+    delay(100);
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_stage);
+    RUN_TEST(test_small_values_exact);
+    RUN_TEST(test_bucket_edges);
+    RUN_TEST(test_upper_edge_within_25_percent);
+    RUN_TEST(test_top_capped_at_max);
+    RUN_TEST(test_nearest_rank);
+    RUN_TEST(test_overflow_bucket);
+    RUN_TEST(test_take_clears);
+    exit(UNITY_END());
+}
+
+void loop() {}
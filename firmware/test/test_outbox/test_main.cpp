@@ -0,0 +1,288 @@
+/**
+ * test_main.cpp - Outbox and QoS 1 framing against a lossy broker
+ *
+ * Runs on the host (pio test -e native). A minimal broker on
+ * localhost:1883 (MQTT_BROKER/MQTT_PORT of the host build) answers
+ * CONNECT and SUBSCRIBE, records every QoS 1 PUBLISH and can drop
+ * PUBACKs or the connection. The SD card is test_sdcard/outbox/sdcard.
+ * The tests are skipped if another broker already holds the port.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "config.h"
+#include "mqtt_manager.h"
+#include "outbox.h"
+#include "payload.h"
+#include "sd_manager.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define TEST_ROOT   "test_sdcard/outbox"
+#define BASE_EPOCH  1767225600UL        // 2026-01-01
+#define READINGS    40
+#define DRAIN_LIMIT (3 * MQTT_ACK_TIMEOUT)
+
+// What the broker received, guarded by brokerLock
+struct BrokerLog {
+    std::vector<uint16_t> publishIds;       // QoS 1 PUBLISHes on the data topic, in order
+    std::vector<uint16_t> subscribeIds;
+    std::set<std::string> delivered;        // msg_ids received
+    unsigned int readingsReceived = 0;      // Including duplicates
+};
+
+static std::mutex brokerLock;
+static BrokerLog received;
+static std::atomic<int> pubacksToDrop(0);
+static std::atomic<int> disconnectsLeft(0); // Close instead of acking the next data message(s)
+static int listenFd = -1;
+
+static uint32_t readingNumber = 0;
+
+static bool readFully(int fd, uint8_t* buf, size_t size) {
+    size_t got = 0;
+    while (got < size) {
+        ssize_t n = recv(fd, buf + got, size - got, 0);
+        if (n <= 0) return false;
+        got += n;
+    }
+    return true;
+}
+
+static void recordMessageIds(const std::string& payload) {
+    static const std::string key = "\"msg_id\":\"";
+    for (size_t at = payload.find(key); at != std::string::npos; at = payload.find(key, at)) {
+        at += key.size();
+        received.delivered.insert(payload.substr(at, payload.find('"', at) - at));
+        received.readingsReceived++;
+    }
+}
+
+/**
+ * Serve one client connection until it closes (or is closed).
+ */
+static void serveClient(int fd) {
+    std::vector<uint8_t> body;
+    for (;;) {
+        uint8_t type;
+        if (!readFully(fd, &type, 1)) break;
+        uint32_t length = 0, multiplier = 1;
+        uint8_t digit;
+        do {
+            if (!readFully(fd, &digit, 1)) return;
+            length += (digit & 0x7F) * multiplier;
+            multiplier <<= 7;
+        } while (digit & 0x80);
+        body.resize(length);
+        if (length && !readFully(fd, body.data(), length)) break;
+
+        switch (type & 0xF0) {
+        case 0x10: {                        // CONNECT
+            const uint8_t connack[] = { 0x20, 0x02, 0x00, 0x00 };
+            send(fd, connack, sizeof(connack), MSG_NOSIGNAL);
+            break;
+        }
+        case 0x80: {                        // SUBSCRIBE
+            std::lock_guard<std::mutex> guard(brokerLock);
+            received.subscribeIds.push_back((body[0] << 8) | body[1]);
+            const uint8_t suback[] = { 0x90, 0x03, body[0], body[1], MQTT_QOS };
+            send(fd, suback, sizeof(suback), MSG_NOSIGNAL);
+            break;
+        }
+        case 0xC0: {                        // PINGREQ
+            const uint8_t pingresp[] = { 0xD0, 0x00 };
+            send(fd, pingresp, sizeof(pingresp), MSG_NOSIGNAL);
+            break;
+        }
+        case 0xE0:                          // DISCONNECT
+            return;
+        case 0x30: {                        // PUBLISH
+            if (((type >> 1) & 0x03) != 1) break;
+            size_t topicLen = (body[0] << 8) | body[1];
+            std::string topic((const char*)body.data() + 2, topicLen);
+            uint16_t packetId = (body[2 + topicLen] << 8) | body[3 + topicLen];
+            if (topic == MQTT_TOPIC_DATA) {
+                std::lock_guard<std::mutex> guard(brokerLock);
+                received.publishIds.push_back(packetId);
+                recordMessageIds(std::string((const char*)body.data() + 4 + topicLen,
+                                             length - 4 - topicLen));
+                if (disconnectsLeft > 0) {
+                    disconnectsLeft--;
+                    return;
+                }
+                if (pubacksToDrop > 0) {
+                    pubacksToDrop--;
+                    break;
+                }
+            }
+            const uint8_t puback[] = { 0x40, 0x02, (uint8_t)(packetId >> 8), (uint8_t)(packetId & 0xFF) };
+            send(fd, puback, sizeof(puback), MSG_NOSIGNAL);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+static void runBroker() {
+    for (;;) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) return;
+        serveClient(fd);
+        close(fd);
+    }
+}
+
+static bool startBroker() {
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(MQTT_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenFd, 1) != 0) {
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    std::thread(runBroker).detach();
+    return true;
+}
+
+static ReadingRecord nextRecord() {
+    readingNumber++;
+    SensorData data = {};
+    data.co2 = 450.0f;
+    data.temperature = 21.5f;
+    data.scd30Valid = true;
+    return RecordCodec::encode(data, BASE_EPOCH + readingNumber * 60, RECORD_FLAG_TIME, 1, readingNumber);
+}
+
+static unsigned int sendBatch(ReadingRecord* records, unsigned int count, uint16_t& packetId) {
+    static char batch[MQTT_BATCH_BYTES];
+    unsigned int taken = 0;
+    size_t length = Payload::writeBatch(batch, sizeof(batch), records, count, taken);
+    packetId = length ? MQTTManager::publishBatch(batch, length) : 0;
+    if (length && !packetId) return 0;
+    return taken;
+}
+
+static bool connectBroker() {
+    unsigned long start = millis();
+    while (!MQTTManager::maintain()) {
+        if (millis() - start >= 5000) return false;
+        delay(10);
+    }
+    return true;
+}
+
+/**
+ * Copy of the broker's log (assertions must not hold the lock).
+ */
+static BrokerLog brokerLog() {
+    std::lock_guard<std::mutex> guard(brokerLock);
+    return received;
+}
+
+/**
+ * Run the outbox until the SD buffer is empty or DRAIN_LIMIT passes.
+ */
+static void drain() {
+    unsigned long start = millis();
+    while (SDManager::getBufferCount() > 0 && millis() - start < DRAIN_LIMIT) {
+        MQTTManager::maintain();
+        Outbox::service(sendBatch);
+        delay(1);
+    }
+}
+
+static void bufferReadings(unsigned int count) {
+    for (unsigned int i = 0; i < count; i++) {
+        TEST_ASSERT_TRUE(SDManager::writeReading(nextRecord()));
+    }
+}
+
+void setUp(void) {
+    if (listenFd < 0) TEST_IGNORE_MESSAGE("MQTT_PORT in use, is a broker running?");
+    std::lock_guard<std::mutex> guard(brokerLock);
+    received = BrokerLog();
+    pubacksToDrop = 0;
+    disconnectsLeft = 0;
+}
+
+void tearDown(void) {}
+
+static void test_packet_ids_unique_on_connection(void) {
+    TEST_ASSERT_TRUE(connectBroker());
+    bufferReadings(READINGS);
+    drain();
+    TEST_ASSERT_EQUAL(0, SDManager::getBufferCount());
+
+    // The command SUBSCRIBE takes its ID from the same counter as the
+    // publishes, so none of them reuses it
+    BrokerLog log = brokerLog();
+    TEST_ASSERT_FALSE(log.subscribeIds.empty());
+    TEST_ASSERT_FALSE(log.publishIds.empty());
+    std::set<uint16_t> ids(log.subscribeIds.begin(), log.subscribeIds.end());
+    for (uint16_t id : log.publishIds) {
+        TEST_ASSERT_NOT_EQUAL(0, id);
+        TEST_ASSERT_TRUE_MESSAGE(ids.insert(id).second, "packet ID reused");
+    }
+}
+
+static void test_dropped_pubacks_are_resent(void) {
+    TEST_ASSERT_TRUE(connectBroker());
+    pubacksToDrop = MQTT_INFLIGHT_WINDOW;
+    bufferReadings(READINGS);
+    drain();
+
+    // The unacknowledged window went out again after MQTT_ACK_TIMEOUT
+    BrokerLog log = brokerLog();
+    TEST_ASSERT_EQUAL(0, pubacksToDrop.load());
+    TEST_ASSERT_EQUAL(0, SDManager::getBufferCount());
+    TEST_ASSERT_EQUAL(0, Outbox::pending());
+    TEST_ASSERT_EQUAL(READINGS, log.delivered.size());
+    TEST_ASSERT_GREATER_THAN(READINGS, log.readingsReceived);
+}
+
+static void test_connection_drop_resends_window(void) {
+    TEST_ASSERT_TRUE(connectBroker());
+    disconnectsLeft = 1;
+    bufferReadings(READINGS);
+    drain();
+
+    BrokerLog log = brokerLog();
+    TEST_ASSERT_EQUAL(0, disconnectsLeft.load());
+    TEST_ASSERT_EQUAL(0, SDManager::getBufferCount());
+    TEST_ASSERT_EQUAL(READINGS, log.delivered.size());
+    TEST_ASSERT_EQUAL(1, log.subscribeIds.size());  // Reconnected once
+}
+
+void setup() {
+    delay(100);
+    system("rm -rf " TEST_ROOT " && mkdir -p " TEST_ROOT);
+    chdir(TEST_ROOT);       // NATIVE_SD_DIR is relative
+
+    startBroker();
+    SDManager::init();
+    MQTTManager::setAckCallback(Outbox::onAck);
+    MQTTManager::init();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_packet_ids_unique_on_connection);
+    RUN_TEST(test_dropped_pubacks_are_resent);
+    RUN_TEST(test_connection_drop_resends_window);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,160 @@
+/**
+ * test_main.cpp - Payload writer output and heap use
+ *
+ * Runs on the host (pio test -e native). The long run repeats the
+ * publish path's formatting (one reading, a batch and the interval
+ * statistics per cycle, buffers from the pool) and checks that it
+ * never touches the heap, so weeks of uptime cannot fragment it.
+ * env:native counts allocations (ALLOC_COUNTER, malloc wrapped).
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <string.h>
+#include "config.h"
+#include "alloc_counter.h"
+#include "buffer_pool.h"
+#include "payload.h"
+#include "reading_record.h"
+#include "sensor_manager.h"
+
+#define BASE_EPOCH  1773577800UL        // 2026-03-15 12:30 UTC
+#define LONG_RUN    100000              // Cycles: about 70 days at one reading a minute
+
+static char buffer[MQTT_BATCH_BYTES];
+
+static SensorData sensorData() {
+    SensorData data = {};
+    data.co2 = 485.2f;
+    data.temperature = 22.15f;
+    data.humidity = 65.3f;
+    data.light = 12450.0f;
+    data.soilMoisture = 42.5f;
+    data.soilRaw = 2150;
+    data.scd30Valid = true;
+    data.bh1750Valid = true;
+    data.soilValid = true;
+    return data;
+}
+
+static ReadingRecord makeRecord(uint32_t reading) {
+    return RecordCodec::encode(sensorData(), BASE_EPOCH + reading * 60, RECORD_FLAG_TIME, 12, reading);
+}
+
+static void assertContains(const char* text, const char* expected) {
+    TEST_ASSERT_NOT_NULL_MESSAGE(strstr(text, expected), expected);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_reading_fields(void) {
+    size_t length = Payload::writeReading(buffer, sizeof(buffer), makeRecord(142));
+    TEST_ASSERT_GREATER_THAN(0, length);
+    TEST_ASSERT_EQUAL(length, strlen(buffer));
+    TEST_ASSERT_EQUAL('{', buffer[0]);
+    TEST_ASSERT_EQUAL('}', buffer[length - 1]);
+    assertContains(buffer, "\"device\":\"" DEVICE_ID "\"");
+    assertContains(buffer, "-0012-00142\"");
+    assertContains(buffer, "\"reading\":142");
+    assertContains(buffer, "\"sensors\":{\"co2\":485.2,\"temperature\":22.15,\"humidity\":65.3,"
+                           "\"light\":12450.0,\"soil_moisture\":42.5,\"soil_raw\":2150}");
+    assertContains(buffer, "\"valid\":{\"scd30\":true,\"bh1750\":true,\"soil\":true}}");
+}
+
+static void test_reading_without_sensors(void) {
+    SensorData data = sensorData();
+    data.scd30Valid = false;
+    data.soilValid = false;
+    ReadingRecord record = RecordCodec::encode(data, BASE_EPOCH, RECORD_FLAG_TIME, 12, 1);
+
+    TEST_ASSERT_GREATER_THAN(0, Payload::writeReading(buffer, sizeof(buffer), record));
+    assertContains(buffer, "\"sensors\":{\"light\":12450.0}");
+    assertContains(buffer, "\"valid\":{\"scd30\":false,\"bh1750\":true,\"soil\":false}");
+}
+
+static void test_reading_does_not_fit(void) {
+    size_t length = Payload::writeReading(buffer, sizeof(buffer), makeRecord(1));
+    TEST_ASSERT_EQUAL(0, Payload::writeReading(buffer, length, makeRecord(1)));
+    TEST_ASSERT_EQUAL(length, Payload::writeReading(buffer, length + 1, makeRecord(1)));
+}
+
+static void test_batch_stops_when_full(void) {
+    ReadingRecord records[SD_FLUSH_MAX_BATCH];
+    for (unsigned int i = 0; i < SD_FLUSH_MAX_BATCH; i++) records[i] = makeRecord(i);
+    size_t one = Payload::writeReading(buffer, sizeof(buffer), records[0]);
+
+    // Room for three readings, their commas and the brackets
+    unsigned int taken = 0;
+    size_t length = Payload::writeBatch(buffer, 3 * one + 4 + 1, records, SD_FLUSH_MAX_BATCH, taken);
+    TEST_ASSERT_EQUAL(3, taken);
+    TEST_ASSERT_EQUAL(3 * one + 4, length);
+    TEST_ASSERT_EQUAL('[', buffer[0]);
+    TEST_ASSERT_EQUAL(']', buffer[length - 1]);
+    assertContains(buffer, "\"reading\":2");
+}
+
+static void test_batch_skips_corrupted(void) {
+    ReadingRecord records[3] = { makeRecord(1), makeRecord(2), makeRecord(3) };
+    records[1].co2 ^= 1;                // CRC no longer matches
+
+    unsigned int taken = 0;
+    TEST_ASSERT_GREATER_THAN(0, Payload::writeBatch(buffer, sizeof(buffer), records, 3, taken));
+    TEST_ASSERT_EQUAL(3, taken);
+    assertContains(buffer, "\"reading\":1,");
+    assertContains(buffer, "\"reading\":3,");
+    TEST_ASSERT_NULL(strstr(buffer, "\"reading\":2,"));
+}
+
+static void test_long_run_allocates_nothing(void) {
+    if (!AllocCounter::enabled()) TEST_IGNORE_MESSAGE("built without ALLOC_COUNTER");
+
+    WindowSummary summary = {};
+    for (unsigned int c = 0; c < CH_COUNT; c++) {
+        summary.channels[c].reset();
+        summary.channels[c].add(20.0f);
+        summary.channels[c].add(22.0f);
+    }
+    summary.durationMs = 60000;
+    ReadingRecord records[SD_FLUSH_BATCH];
+
+    unsigned long allocsBefore = AllocCounter::count();
+    unsigned long missesBefore = BufferPool::misses();
+    for (uint32_t cycle = 0; cycle < LONG_RUN; cycle++) {
+        ReadingRecord record = makeRecord(cycle);
+        records[cycle % SD_FLUSH_BATCH] = record;
+
+        PoolBuffer payload(MQTT_BUFFER_SIZE);
+        TEST_ASSERT_TRUE(payload);
+        TEST_ASSERT_GREATER_THAN(0, Payload::writeReading(payload.data(), payload.size(), record));
+        TEST_ASSERT_GREATER_THAN(0, Payload::writeStats(payload.data(), payload.size(), record, summary));
+
+        if (cycle % SD_FLUSH_BATCH == SD_FLUSH_BATCH - 1) {
+            PoolBuffer batch(MQTT_BATCH_BYTES);
+            unsigned int taken = 0;
+            TEST_ASSERT_TRUE(batch);
+            TEST_ASSERT_GREATER_THAN(0, Payload::writeBatch(batch.data(), batch.size(), records,
+                                                            SD_FLUSH_BATCH, taken));
+            TEST_ASSERT_EQUAL(SD_FLUSH_BATCH, taken);
+        }
+    }
+
+    TEST_ASSERT_EQUAL(0, AllocCounter::count() - allocsBefore);
+    TEST_ASSERT_EQUAL(0, BufferPool::misses() - missesBefore);
+    TEST_ASSERT_EQUAL(0, BufferPool::inUse());
+}
+
+void setup() {
+    delay(100);
+    UNITY_BEGIN();
+    RUN_TEST(test_reading_fields);
+    RUN_TEST(test_reading_without_sensors);
+    RUN_TEST(test_reading_does_not_fit);
+    RUN_TEST(test_batch_stops_when_full);
+    RUN_TEST(test_batch_skips_corrupted);
+    RUN_TEST(test_long_run_allocates_nothing);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,203 @@
+/**
+ * test_main.cpp - Power loss at every byte of a buffer log workload
+ *
+ * The workload runs on a log whose head and tail are a few readings
+ * from a segment boundary, so it appends into a new segment, retires
+ * the head segment and saves the cursor many times. It is repeated
+ * with the power cut after each byte it writes (fs::FS write budget);
+ * the log is then reopened with power back and must:
+ *
+ *   - deliver only intact readings, oldest first, without gaps
+ *   - still hold every reading appended and not consumed before the cut
+ *   - keep appending in step (a torn record must not misalign the tail)
+ *
+ * Readings consumed just before the cut may be delivered again.
+ */
+
+#include <Arduino.h>
+#include <FS.h>
+#include <unity.h>
+#include "config.h"
+#include "buffer_log.h"
+
+#define TEST_ROOT   "test_sdcard/power_loss"
+#define WORK_DIR    TEST_ROOT "/card"
+#define SNAPSHOT    TEST_ROOT "/snapshot"
+#define LOG_DIR     "/buffer"
+#define BASE_EPOCH  1767225600UL        // 2026-01-01
+#define PREFILL     (SD_SEGMENT_RECORDS - 6)
+#define PRECONSUMED (SD_SEGMENT_RECORDS - 10)
+#define MARKER      0xFFFFFFUL          // Reading appended after recovery
+
+static fs::FS card(WORK_DIR);
+
+// What the workload got done before the cut
+static uint32_t appended = 0;           // Readings appended (append() true)
+static uint32_t consumed = 0;           // Readings removed from the head
+
+static ReadingRecord makeRecord(uint32_t n) {
+    ReadingRecord record = {};
+    record.version = RECORD_VERSION;
+    record.flags = RECORD_FLAG_TIME;
+    record.epoch = BASE_EPOCH + n * 60;
+    record.reading = n;
+    RecordCodec::seal(record);
+    return record;
+}
+
+static bool powered() {
+    return card.writeBudget() != 0;
+}
+
+static bool append() {
+    if (!BufferLog::append(makeRecord(appended))) return false;
+    appended++;
+    return powered();
+}
+
+static bool countConsumed(const ReadingRecord& record) {
+    (void)record;
+    return true;
+}
+
+/**
+ * The steps under test. Stops once the power is cut; counts only
+ * what completed before.
+ */
+static void workload() {
+    for (int i = 0; i < 8; i++) {               // Into a new tail segment
+        if (!append()) return;
+    }
+    if (!BufferLog::pop()) return;
+    consumed++;
+    if (!powered()) return;
+
+    unsigned int removed = BufferLog::popBatch(7);     // Retires segment 1
+    consumed += removed;
+    if (!powered()) return;
+
+    for (int i = 0; i < 3; i++) {
+        if (!append()) return;
+    }
+    consumed += BufferLog::drain(countConsumed, 4);
+    if (!powered()) return;
+    append();
+}
+
+/**
+ * Readings left after a cut. 'firstKept': oldest reading that must
+ * still be there.
+ */
+static void checkRecovered(uint32_t firstKept, const char* label) {
+    TEST_ASSERT_TRUE_MESSAGE(BufferLog::begin(card, LOG_DIR), label);
+    TEST_ASSERT_TRUE_MESSAGE(BufferLog::append(makeRecord(MARKER)), label);
+
+    static ReadingRecord records[2 * SD_SEGMENT_RECORDS];
+    unsigned long count = BufferLog::count();
+    TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(2 * SD_SEGMENT_RECORDS, count, label);
+    unsigned int read = BufferLog::peekBatch(records, count);
+    TEST_ASSERT_EQUAL_MESSAGE(count, read, label);
+
+    // Torn records are skipped when read; everything else is in order
+    uint32_t expected = 0;
+    bool first = true;
+    for (unsigned int i = 0; i < read; i++) {
+        if (!RecordCodec::isValid(records[i])) continue;
+        uint32_t n = records[i].reading;
+        if (n == MARKER) {
+            TEST_ASSERT_EQUAL_MESSAGE(read - 1, i, label);
+            break;
+        }
+        if (first) {
+            TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(firstKept, n, label);
+            first = false;
+        } else {
+            TEST_ASSERT_EQUAL_MESSAGE(expected, n, label);
+        }
+        expected = n + 1;
+    }
+    TEST_ASSERT_TRUE_MESSAGE(RecordCodec::isValid(records[read - 1]), label);
+    TEST_ASSERT_EQUAL_MESSAGE(MARKER, records[read - 1].reading, label);
+    if (appended > firstKept) {
+        TEST_ASSERT_FALSE_MESSAGE(first, label);
+        TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(appended, expected, label);
+    }
+}
+
+/**
+ * Log with PREFILL readings of which PRECONSUMED are consumed,
+ * saved as the snapshot every run starts from.
+ */
+static void makeSnapshot() {
+    system("rm -rf " TEST_ROOT " && mkdir -p " WORK_DIR);
+    TEST_ASSERT_TRUE(BufferLog::begin(card, LOG_DIR));
+    for (appended = 0; appended < PREFILL; appended++) {
+        TEST_ASSERT_TRUE(BufferLog::append(makeRecord(appended)));
+    }
+    TEST_ASSERT_EQUAL(PRECONSUMED, BufferLog::popBatch(PRECONSUMED));
+    system("cp -r " WORK_DIR " " SNAPSHOT);
+}
+
+static void restoreSnapshot() {
+    system("rm -rf " WORK_DIR " && cp -r " SNAPSHOT " " WORK_DIR);
+    appended = PREFILL;
+    consumed = PRECONSUMED;
+}
+
+void setUp(void) {
+    card.setWriteBudget(-1);
+}
+
+void tearDown(void) {
+    card.setWriteBudget(-1);
+}
+
+static void test_cut_at_every_byte(void) {
+    makeSnapshot();
+
+    // Bytes the whole workload writes
+    restoreSnapshot();
+    TEST_ASSERT_TRUE(BufferLog::begin(card, LOG_DIR));
+    unsigned long start = BufferLog::bytesWritten();
+    workload();
+    long total = BufferLog::bytesWritten() - start;
+    TEST_ASSERT_GREATER_THAN(0, total);
+    checkRecovered(consumed, "no cut");
+
+    for (long cut = 0; cut <= total; cut++) {
+        char label[48];
+        snprintf(label, sizeof(label), "power cut after %ld of %ld bytes", cut, total);
+
+        restoreSnapshot();
+        TEST_ASSERT_TRUE_MESSAGE(BufferLog::begin(card, LOG_DIR), label);
+        card.setWriteBudget(cut);
+        workload();
+        card.setWriteBudget(-1);
+        checkRecovered(consumed, label);
+    }
+}
+
+/**
+ * Both cursor slots unreadable: the cursor is rebuilt from the
+ * segments present and nothing unconsumed is lost.
+ */
+static void test_both_cursor_slots_lost(void) {
+    makeSnapshot();
+    restoreSnapshot();
+    for (int slot = 0; slot < 2; slot++) {
+        File f = card.open(slot ? LOG_DIR "/meta.1" : LOG_DIR "/meta.0", FILE_WRITE);
+        f.write((const uint8_t*)"garbage", 7);
+        f.close();
+    }
+    appended = PREFILL;
+    checkRecovered(consumed, "cursor lost");
+}
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_cut_at_every_byte);
+    RUN_TEST(test_both_cursor_slots_lost);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,145 @@
+/**
+ * test_main.cpp - Binary reading record encode/decode round trip
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "reading_record.h"
+
+#define EPOCH 1773577800UL              // 2026-03-15 12:30:00 UTC
+
+static SensorData sample() {
+    SensorData data = {};
+    data.co2 = 487.3f;
+    data.temperature = -5.25f;
+    data.humidity = 61.4f;
+    data.light = 12345.6f;
+    data.soilMoisture = 42.7f;
+    data.soilRaw = 2150;
+    data.scd30Valid = true;
+    data.bh1750Valid = true;
+    data.soilValid = true;
+    return data;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_round_trip_keeps_values(void) {
+    SensorData in = sample();
+    ReadingRecord record = RecordCodec::encode(in, EPOCH, RECORD_FLAG_TIME, 12, 142);
+
+    TEST_ASSERT_TRUE(RecordCodec::isValid(record));
+    TEST_ASSERT_EQUAL(RECORD_VERSION, record.version);
+    TEST_ASSERT_EQUAL(EPOCH, record.epoch);
+    TEST_ASSERT_EQUAL(12, record.boot);
+    TEST_ASSERT_EQUAL(142, record.reading);
+    TEST_ASSERT_EQUAL(RECORD_FLAG_SCD30 | RECORD_FLAG_BH1750 | RECORD_FLAG_SOIL | RECORD_FLAG_TIME,
+                      record.flags);
+
+    // Exact at the precision of each field
+    TEST_ASSERT_EQUAL(4873, record.co2);
+    TEST_ASSERT_EQUAL(-525, record.temperature);
+    TEST_ASSERT_EQUAL(614, record.humidity);
+    TEST_ASSERT_EQUAL(123456, record.light);
+    TEST_ASSERT_EQUAL(427, record.soilMoisture);
+    TEST_ASSERT_EQUAL(2150, record.soilRaw);
+
+    SensorData out = RecordCodec::decode(record);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, in.co2, out.co2);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, in.temperature, out.temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, in.humidity, out.humidity);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, in.light, out.light);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, in.soilMoisture, out.soilMoisture);
+    TEST_ASSERT_EQUAL(in.soilRaw, out.soilRaw);
+    TEST_ASSERT_TRUE(out.scd30Valid && out.bh1750Valid && out.soilValid);
+
+    // Encoding the decoded values gives the same record
+    ReadingRecord again = RecordCodec::encode(out, EPOCH, RECORD_FLAG_TIME, 12, 142);
+    TEST_ASSERT_EQUAL_MEMORY(&record, &again, sizeof(record));
+}
+
+static void test_out_of_range_sensor_is_invalid(void) {
+    SensorData data = sample();
+    data.humidity = 120.0f;             // One SCD30 channel out of range
+    data.bh1750Valid = false;
+    data.soilRaw = 4095;                // Wiring fault
+    ReadingRecord record = RecordCodec::encode(data, EPOCH, RECORD_FLAG_TIME, 1, 1);
+
+    TEST_ASSERT_EQUAL(RECORD_FLAG_TIME, record.flags);
+    SensorData out = RecordCodec::decode(record);
+    TEST_ASSERT_FALSE(out.scd30Valid || out.bh1750Valid || out.soilValid);
+}
+
+static void test_fields_saturate(void) {
+    SensorData data = sample();
+    data.temperature = 500.0f;          // Beyond int16 at x100
+    data.light = -10.0f;
+    ReadingRecord record = RecordCodec::encode(data, EPOCH, 0, 1, 1);
+
+    TEST_ASSERT_EQUAL(INT16_MAX, record.temperature);
+    TEST_ASSERT_EQUAL(0, record.light);
+    TEST_ASSERT_EQUAL(0, record.flags & (RECORD_FLAG_TIME | RECORD_FLAG_UPTIME));
+    TEST_ASSERT_TRUE(RecordCodec::isValid(record));
+}
+
+static void test_any_corrupted_byte_is_detected(void) {
+    ReadingRecord record = RecordCodec::encode(sample(), EPOCH, RECORD_FLAG_TIME, 3, 7);
+    for (size_t i = 0; i < sizeof(record); i++) {
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            ReadingRecord damaged = record;
+            ((uint8_t*)&damaged)[i] ^= 1 << bit;
+            TEST_ASSERT_FALSE(RecordCodec::isValid(damaged));
+        }
+    }
+
+    ReadingRecord zeroed = {};
+    TEST_ASSERT_FALSE(RecordCodec::isValid(zeroed));
+}
+
+static void test_resolve_uptime(void) {
+    ReadingRecord record = RecordCodec::encode(sample(), 95, RECORD_FLAG_UPTIME, 4, 2);
+
+    // Another boot, or no clock yet: unchanged
+    TEST_ASSERT_FALSE(RecordCodec::resolveUptime(record, 5, EPOCH));
+    TEST_ASSERT_FALSE(RecordCodec::resolveUptime(record, 4, 0));
+    TEST_ASSERT_EQUAL(95, record.epoch);
+
+    TEST_ASSERT_TRUE(RecordCodec::resolveUptime(record, 4, EPOCH));
+    TEST_ASSERT_EQUAL(EPOCH + 95, record.epoch);
+    TEST_ASSERT_EQUAL(RECORD_FLAG_TIME, record.flags & (RECORD_FLAG_TIME | RECORD_FLAG_UPTIME));
+    TEST_ASSERT_TRUE(RecordCodec::isValid(record));
+
+    // Only once
+    TEST_ASSERT_FALSE(RecordCodec::resolveUptime(record, 4, EPOCH));
+}
+
+static void test_from_json(void) {
+    const char* line =
+        "{\"device\":\"LEPAA-GH-01\",\"msg_id\":\"A1B2C3D4-12-142\","
+        "\"timestamp\":\"2026-03-15T14:30:00+02:00\",\"reading\":142,"
+        "\"sensors\":{\"co2\":487.3,\"temperature\":-5.25,\"humidity\":61.4,"
+        "\"light\":12345.6,\"soil_moisture\":42.7,\"soil_raw\":2150},"
+        "\"valid\":{\"scd30\":true,\"bh1750\":true,\"soil\":true}}";
+
+    ReadingRecord record;
+    TEST_ASSERT_TRUE(RecordCodec::fromJSON(line, record));
+    ReadingRecord expected = RecordCodec::encode(sample(), EPOCH, RECORD_FLAG_TIME, 12, 142);
+    TEST_ASSERT_EQUAL_MEMORY(&expected, &record, sizeof(record));
+
+    TEST_ASSERT_FALSE(RecordCodec::fromJSON("{\"device\":\"x\"}", record));
+    TEST_ASSERT_FALSE(RecordCodec::fromJSON("not json", record));
+}
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_keeps_values);
+    RUN_TEST(test_out_of_range_sensor_is_invalid);
+    RUN_TEST(test_fields_saturate);
+    RUN_TEST(test_any_corrupted_byte_is_detected);
+    RUN_TEST(test_resolve_uptime);
+    RUN_TEST(test_from_json);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,143 @@
+/**
+ * test_main.cpp - Channel table validation and fixed-point conversion
+ *
+ * Runs on the host (pio test -e native). The range checks are compared
+ * with the inline checks SensorManager::read() made before the table
+ * (kept below as legacyValid()); the one intended difference is NaN,
+ * which those checks let through.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <math.h>
+#include "sensor_channels.h"
+
+// Range checks as SensorManager::read() wrote them before the table
+static bool legacyValid(ChannelId ch, float v) {
+    switch (ch) {
+    case CH_CO2:           return !(v < 0 || v > 10000);
+    case CH_TEMPERATURE:   return !(v < -40 || v > 80);
+    case CH_HUMIDITY:      return !(v < 0 || v > 100);
+    case CH_LIGHT:         return v >= 0;
+    case CH_SOIL_RAW:      return v > 0 && v < 4095;
+    default:               return true;
+    }
+}
+
+static void fill(float values[CH_COUNT], float v) {
+    for (int i = 0; i < CH_COUNT; i++) values[i] = v;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_table_matches_legacy_checks(void) {
+    static const ChannelId checked[] = { CH_CO2, CH_TEMPERATURE, CH_HUMIDITY, CH_SOIL_RAW };
+    static const float probes[] = { -1000.0f, -40.5f, -40.0f, -1.0f, -0.01f, 0.0f, 0.5f, 1.0f,
+                                    22.15f, 79.99f, 80.0f, 80.01f, 99.9f, 100.0f, 100.1f,
+                                    4094.0f, 4094.5f, 4095.0f, 9999.9f, 10000.0f, 10000.1f };
+
+    for (ChannelId ch : checked) {
+        for (float v : probes) {
+            if (ch == CH_SOIL_RAW && v != floorf(v)) continue;     // ADC codes are integers
+            char message[48];
+            snprintf(message, sizeof(message), "channel %d, value %g", ch, v);
+            TEST_ASSERT_EQUAL_MESSAGE(legacyValid(ch, v), Channels::inRange(ch, v), message);
+        }
+    }
+}
+
+static void test_light_upper_bound(void) {
+    // The legacy check had no upper bound; the BH1750 tops out at 65535 lx
+    TEST_ASSERT_TRUE(Channels::inRange(CH_LIGHT, 0.0f));
+    TEST_ASSERT_TRUE(Channels::inRange(CH_LIGHT, 65535.0f));
+    TEST_ASSERT_FALSE(Channels::inRange(CH_LIGHT, 65536.0f));
+    TEST_ASSERT_FALSE(Channels::inRange(CH_LIGHT, -0.5f));
+}
+
+static void test_nan_is_never_valid(void) {
+    float values[CH_COUNT];
+    int32_t fixed[CH_COUNT];
+    fill(values, NAN);
+    TEST_ASSERT_EQUAL(0, Channels::convert(values, fixed));
+    for (int i = 0; i < CH_COUNT; i++) {
+        TEST_ASSERT_FALSE(Channels::inRange((ChannelId)i, NAN));
+        TEST_ASSERT_EQUAL(0, fixed[i]);
+    }
+}
+
+static void test_mask_matches_in_range(void) {
+    static const float probes[] = { -50.0f, -1.0f, 0.0f, 0.5f, 50.0f, 90.0f, 101.0f, 4094.0f,
+                                    5000.0f, 70000.0f, INFINITY, -INFINITY };
+    float values[CH_COUNT];
+    int32_t fixed[CH_COUNT];
+    for (float v : probes) {
+        fill(values, v);
+        uint32_t mask = Channels::convert(values, fixed);
+        for (int i = 0; i < CH_COUNT; i++) {
+            TEST_ASSERT_EQUAL(Channels::inRange((ChannelId)i, v), (mask >> i) & 1);
+        }
+    }
+}
+
+static void test_conversion_rounds(void) {
+    float values[CH_COUNT] = { 485.25f, 22.15f, 65.349f, 12450.06f, 42.55f, 2150.0f };
+    int32_t fixed[CH_COUNT];
+    uint32_t mask = Channels::convert(values, fixed);
+
+    TEST_ASSERT_EQUAL((1u << CH_COUNT) - 1, mask);
+    TEST_ASSERT_EQUAL(4853, fixed[CH_CO2]);
+    TEST_ASSERT_EQUAL(2215, fixed[CH_TEMPERATURE]);
+    TEST_ASSERT_EQUAL(653, fixed[CH_HUMIDITY]);
+    TEST_ASSERT_EQUAL(124501, fixed[CH_LIGHT]);
+    TEST_ASSERT_EQUAL(426, fixed[CH_SOIL_MOISTURE]);   // Fractional percent kept, not truncated
+    TEST_ASSERT_EQUAL(2150, fixed[CH_SOIL_RAW]);
+}
+
+static void test_negative_values_round_away_from_zero(void) {
+    float values[CH_COUNT];
+    int32_t fixed[CH_COUNT];
+    fill(values, 0.0f);
+    values[CH_TEMPERATURE] = -12.345f;
+    values[CH_SOIL_MOISTURE] = -0.96f;
+    Channels::convert(values, fixed);
+    TEST_ASSERT_EQUAL(-1235, fixed[CH_TEMPERATURE]);
+    TEST_ASSERT_EQUAL(-10, fixed[CH_SOIL_MOISTURE]);
+}
+
+static void test_thresholds_round(void) {
+    static_assert(Channels::toFixed(CH_TEMPERATURE, 0.29) == 29, "0.29 * 100 truncates to 28");
+    TEST_ASSERT_EQUAL(29, Channels::toFixed(CH_TEMPERATURE, 0.29));
+    TEST_ASSERT_EQUAL(20, Channels::toFixed(CH_TEMPERATURE, 0.2));
+    TEST_ASSERT_EQUAL(100, Channels::toFixed(CH_CO2, 10.0));
+    TEST_ASSERT_EQUAL(-29, Channels::toFixed(CH_TEMPERATURE, -0.29));
+}
+
+static void test_out_of_range_saturates(void) {
+    float values[CH_COUNT];
+    int32_t fixed[CH_COUNT];
+    fill(values, 1e12f);
+    TEST_ASSERT_EQUAL(0, Channels::convert(values, fixed));
+    for (int i = 0; i < CH_COUNT; i++) TEST_ASSERT_TRUE(fixed[i] > 2147483000);
+
+    fill(values, -INFINITY);
+    Channels::convert(values, fixed);
+    for (int i = 0; i < CH_COUNT; i++) TEST_ASSERT_TRUE(fixed[i] < -2147483000);
+}
+
+void setup() {
+    delay(100);
+    UNITY_BEGIN();
+    RUN_TEST(test_table_matches_legacy_checks);
+    RUN_TEST(test_light_upper_bound);
+    RUN_TEST(test_nan_is_never_valid);
+    RUN_TEST(test_mask_matches_in_range);
+    RUN_TEST(test_conversion_rounds);
+    RUN_TEST(test_negative_values_round_away_from_zero);
+    RUN_TEST(test_thresholds_round);
+    RUN_TEST(test_out_of_range_saturates);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""
+bench.py - Compare benchmark results between firmware versions
+
+Builds with BENCHMARK save their results as <FIRMWARE_VERSION>.json
+(see include/bench.h). This tool lines up the cases of two result
+files and flags those that got slower, allocate more or write more
+bytes per operation, or drain fewer readings per second.
+
+Usage:
+    python bench.py show sdcard/bench/1.1.0.json
+    python bench.py compare sdcard/bench/1.0.0.json sdcard/bench/1.1.0.json
+    python bench.py compare old.json new.json --threshold 10
+
+Exits with 1 if compare finds a regression, so it can gate a CI job.
+
+HAMK Lepaa Thesis Project
+Victor Betiku, 2026
+"""
+
+import argparse
+import json
+import sys
+
+# Compared per case: (field, unit)
+METRICS = [("p50_us", "us"), ("p99_us", "us"), ("allocs_per_op", "allocs"),
+           ("bytes_per_op", "bytes")]
+
+# Compared for cases that measure throughput (lower is worse)
+RATE_METRICS = [("readings_per_s", "readings/s")]
+
+# Latency changes smaller than this are timer noise (us)
+MIN_LATENCY_CHANGE = 5
+
+# Any extra allocation per operation is a regression (heap on the
+# ESP32 fragments), regardless of the threshold
+MIN_ALLOC_CHANGE = 0.5
+
+
+def load(path):
+    with open(path) as f:
+        results = json.load(f)
+    cases = {}
+    for case in results["cases"]:
+        cases[(case["name"], case.get("backlog"))] = case
+    return results, cases
+
+
+def case_label(key):
+    name, backlog = key
+    return name if backlog is None else "%s@%d" % (name, backlog)
+
+
+def cmd_show(args):
+    results, cases = load(args.input)
+    print("firmware %s on %s, %s" % (results["firmware"], results["platform"], results["timestamp"]))
+    print("%-22s %6s %9s %9s %9s %9s %8s %8s" %
+          ("case", "n", "p50 us", "p90 us", "p99 us", "max us", "allocs", "bytes"))
+    for key, case in cases.items():
+        print("%-22s %6d %9d %9d %9d %9d %8.2f %8.1f" %
+              (case_label(key), case["n"], case["p50_us"], case["p90_us"], case["p99_us"],
+               case["max_us"], case["allocs_per_op"], case["bytes_per_op"]))
+
+
+def is_regression(field, old, new, threshold):
+    if field == "readings_per_s":
+        return old > 0 and (old - new) * 100.0 / old > threshold
+    if new <= old:
+        return False
+    if field.endswith("_us") and new - old < MIN_LATENCY_CHANGE:
+        return False
+    if field == "allocs_per_op":
+        return new - old >= MIN_ALLOC_CHANGE
+    if old == 0:
+        return True
+    return (new - old) * 100.0 / old > threshold
+
+
+def cmd_compare(args):
+    old_results, old_cases = load(args.old)
+    new_results, new_cases = load(args.new)
+    if old_results["platform"] != new_results["platform"]:
+        print("warning: comparing %s results with %s" % (old_results["platform"], new_results["platform"]),
+              file=sys.stderr)
+    print("%s -> %s (threshold %.0f%%)" % (old_results["firmware"], new_results["firmware"], args.threshold))
+
+    regressions = 0
+    for key, new in new_cases.items():
+        old = old_cases.get(key)
+        if old is None:
+            print("%-22s new case" % case_label(key))
+            continue
+        changes = []
+        for field, unit in METRICS + RATE_METRICS:
+            if field not in old or field not in new:
+                continue
+            a, b = old[field], new[field]
+            change = "%+.0f%%" % ((b - a) * 100.0 / a) if a else ("+%g" % b if b else "0")
+            flag = ""
+            if is_regression(field, a, b, args.threshold):
+                flag = " !"
+                regressions += 1
+            changes.append("%s %g->%g %s (%s)%s" % (field, a, b, unit, change, flag))
+        print("%-22s %s" % (case_label(key), ", ".join(changes)))
+
+    for key in old_cases:
+        if key not in new_cases:
+            print("%-22s missing" % case_label(key))
+
+    print("%d regression(s)" % regressions)
+    sys.exit(1 if regressions else 0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark result tool")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("show", help="results file as a table")
+    p.add_argument("input")
+    p.set_defaults(func=cmd_show)
+
+    p = sub.add_parser("compare", help="changes from OLD to NEW; exit 1 on regression")
+    p.add_argument("old")
+    p.add_argument("new")
+    p.add_argument("--threshold", type=float, default=20.0,
+                   help="percent increase counted as a regression (default 20)")
+    p.set_defaults(func=cmd_compare)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
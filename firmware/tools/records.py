@@ -0,0 +1,538 @@
+#!/usr/bin/env python3
+"""
+records.py - Decode and convert SD card reading records
+
+The firmware buffers readings on the SD card as fixed 32-byte binary
+records (see include/reading_record.h) and archives them in
+compressed blocks (see include/archive_codec.h). This tool turns
+either back into the JSON published over MQTT, converts JSONL
+archives written by older firmware, and measures how well the
+archive format compresses a set of files.
+
+Usage:
+    python records.py decode /data/archive/2026-03-15.arc > day.jsonl
+    python records.py convert 2026-03-15.jsonl 2026-03-15.arc
+    python records.py bench /data/archive/*.arc
+    python records.py query /data/archive 2026-03-03T02:00 2026-03-03T04:00
+
+HAMK Lepaa Thesis Project
+Victor Betiku, 2026
+"""
+
+import argparse
+import json
+import os
+import struct
+import sys
+import time
+import zlib
+from datetime import datetime, timedelta, timezone
+
+RECORD_VERSION = 1
+RECORD = struct.Struct("<BBHIIIhHIhHI")
+assert RECORD.size == 32
+
+FLAG_SCD30 = 0x01
+FLAG_BH1750 = 0x02
+FLAG_SOIL = 0x04
+FLAG_TIME = 0x08
+FLAG_UPTIME = 0x10  # epoch is seconds since boot (NTP not synced yet)
+
+BLOCK_MAGIC = 0x4B4C4241  # "ABLK"
+BLOCK_HEADER = struct.Struct("<IHHIII")
+BLOCK_RECORDS = 64        # ARCHIVE_BLOCK_RECORDS in config.h
+INDEX_ENTRY = struct.Struct("<IIII")  # first epoch, last epoch, offset, CRC
+
+# Archive columns in block order: (record field index, delta-of-delta, signed 16-bit)
+COLUMNS = [(3, True, False), (4, True, False), (2, False, False), (1, False, False),
+           (5, False, False), (6, False, True), (7, False, False), (8, False, False),
+           (9, False, True), (10, False, False)]
+
+# Gorilla buckets: (prefix, prefix bits, value bits)
+BUCKETS = [(0b10, 2, 7), (0b110, 3, 9), (0b1110, 4, 12)]
+
+DEVICE_ID = "LEPAA-GH-01"
+GMT_OFFSET = 7200   # NTP_GMT_OFFSET in config.h
+DST_OFFSET = 3600   # NTP_DST_OFFSET in config.h
+
+
+def is_dst(utc):
+    """EU summer time: last Sunday of March to last Sunday of October, 01:00 UTC."""
+    def last_sunday(month):
+        d = datetime(utc.year, month, 31 if month in (3, 10) else 30, 1, tzinfo=timezone.utc)
+        return d - timedelta(days=(d.weekday() + 1) % 7)
+    return last_sunday(3) <= utc < last_sunday(10)
+
+
+def local_time(epoch):
+    utc = datetime.fromtimestamp(epoch, timezone.utc)
+    offset = GMT_OFFSET + (DST_OFFSET if is_dst(utc) else 0)
+    return utc.astimezone(timezone(timedelta(seconds=offset)))
+
+
+def format_timestamp(epoch, valid):
+    if not valid:
+        return "1970-01-01T00:00:00+00:00"
+    return local_time(epoch).isoformat()
+
+
+def parse_time(text):
+    """Unix time from an epoch or an ISO 8601 time (local time if no offset)."""
+    if text.isdigit():
+        return int(text)
+    ts = datetime.fromisoformat(text)
+    if ts.tzinfo is None:
+        guess = ts.replace(tzinfo=timezone(timedelta(seconds=GMT_OFFSET)))
+        ts = ts.replace(tzinfo=local_time(guess.timestamp()).tzinfo)
+    return int(ts.timestamp())
+
+
+def fixed(value, scale, lo, hi):
+    return max(lo, min(hi, int(round(value * scale))))
+
+
+def encode(reading):
+    """Pack a dict with the decoded field names into a 32-byte record."""
+    body = RECORD.pack(
+        RECORD_VERSION,
+        reading["flags"],
+        reading["boot"] & 0xFFFF,
+        reading["epoch"],
+        reading["reading"],
+        fixed(reading["co2"], 10, 0, 0x7FFFFFFF),
+        fixed(reading["temperature"], 100, -0x8000, 0x7FFF),
+        fixed(reading["humidity"], 10, 0, 0xFFFF),
+        fixed(reading["light"], 10, 0, 0x7FFFFFFF),
+        fixed(reading["soil_moisture"], 10, -0x8000, 0x7FFF),
+        max(0, min(0xFFFF, reading["soil_raw"])),
+        0,
+    )
+    crc = zlib.crc32(body[:28])
+    return body[:28] + struct.pack("<I", crc)
+
+
+def decode(raw):
+    """Unpack a 32-byte record. Returns None if torn or corrupted."""
+    if len(raw) != RECORD.size:
+        return None
+    (version, flags, boot, epoch, reading, co2, temperature, humidity,
+     light, soil_moisture, soil_raw, crc) = RECORD.unpack(raw)
+    if version != RECORD_VERSION or zlib.crc32(raw[:28]) != crc:
+        return None
+    return {
+        "flags": flags,
+        "boot": boot,
+        "epoch": epoch,
+        "reading": reading,
+        "co2": co2 / 10,
+        "temperature": temperature / 100,
+        "humidity": humidity / 10,
+        "light": light / 10,
+        "soil_moisture": soil_moisture / 10,
+        "soil_raw": soil_raw,
+    }
+
+
+def seal(fields):
+    """Pack record fields (CRC slot ignored) and add the CRC."""
+    body = RECORD.pack(*fields[:11], 0)[:28]
+    return body + struct.pack("<I", zlib.crc32(body))
+
+
+class BitWriter:
+    def __init__(self):
+        self.value, self.bits = 0, 0
+
+    def put(self, value, width):
+        self.value = (self.value << width) | (value & ((1 << width) - 1))
+        self.bits += width
+
+    def getvalue(self):
+        pad = -self.bits % 8
+        return (self.value << pad).to_bytes((self.bits + pad) // 8, "big")
+
+
+class BitReader:
+    def __init__(self, data):
+        self.value, self.left = int.from_bytes(data, "big"), len(data) * 8
+
+    def get(self, width):
+        self.left -= width
+        if self.left < 0:
+            raise ValueError("block data too short")
+        return (self.value >> self.left) & ((1 << width) - 1)
+
+
+def put_delta(w, delta):
+    d = delta - (1 << 32) if delta & 0x80000000 else delta
+    if d == 0:
+        w.put(0, 1)
+        return
+    for prefix, plen, vbits in BUCKETS:
+        if -(1 << (vbits - 1)) <= d < (1 << (vbits - 1)):
+            w.put(prefix, plen)
+            w.put(d, vbits)
+            return
+    w.put(0b1111, 4)
+    w.put(delta, 32)
+
+
+def read_delta(r):
+    if r.get(1) == 0:
+        return 0
+    for _, _, vbits in BUCKETS:
+        if r.get(1) == 0:
+            v = r.get(vbits)
+            return (v - (1 << vbits)) & 0xFFFFFFFF if v >> (vbits - 1) else v
+    return r.get(32)
+
+
+def encode_block(raws):
+    """Compress a list of 32-byte records into one archive block."""
+    rows = [RECORD.unpack(raw) for raw in raws]
+    w = BitWriter()
+    for index, double, _ in COLUMNS:
+        prev = prev_delta = 0
+        for row in rows:
+            value = row[index] & 0xFFFFFFFF
+            delta = (value - prev) & 0xFFFFFFFF
+            put_delta(w, (delta - prev_delta) & 0xFFFFFFFF if double else delta)
+            prev, prev_delta = value, delta
+    data = w.getvalue()
+    head = BLOCK_HEADER.pack(BLOCK_MAGIC, len(rows), len(data), rows[0][3], rows[-1][3], 0)[:16]
+    crc = zlib.crc32(data, zlib.crc32(head))
+    return head + struct.pack("<I", crc) + data
+
+
+def decode_block(head, data):
+    """Unpack one block into 32-byte records. Returns None if corrupted."""
+    magic, count, length, _, _, crc = BLOCK_HEADER.unpack(head)
+    if zlib.crc32(data, zlib.crc32(head[:16])) != crc:
+        return None
+    rows = [[RECORD_VERSION] + [0] * 11 for _ in range(count)]
+    r = BitReader(data)
+    for index, double, signed in COLUMNS:
+        prev = prev_delta = 0
+        for row in rows:
+            delta = read_delta(r)
+            if double:
+                delta = (delta + prev_delta) & 0xFFFFFFFF
+            prev, prev_delta = (prev + delta) & 0xFFFFFFFF, delta
+            if signed:
+                low = prev & 0xFFFF
+                row[index] = low - 0x10000 if low & 0x8000 else low
+            else:
+                row[index] = prev
+    return [seal(row) for row in rows]
+
+
+def read_records(path):
+    """Yield 32-byte records from a raw (.rec) or compressed (.arc) file."""
+    with open(path, "rb") as f:
+        yield from split_records(f.read(), path)
+
+
+def split_records(blob, name):
+    """Yield 32-byte records from file contents in either format.
+    Torn blocks are skipped by searching for the next block magic."""
+    if len(blob) < 4 or struct.unpack_from("<I", blob)[0] != BLOCK_MAGIC:
+        for pos in range(0, len(blob) - RECORD.size + 1, RECORD.size):
+            yield blob[pos:pos + RECORD.size]
+        return
+    magic_bytes = struct.pack("<I", BLOCK_MAGIC)
+    pos = 0
+    while pos + BLOCK_HEADER.size <= len(blob):
+        head = blob[pos:pos + BLOCK_HEADER.size]
+        magic, count, length = BLOCK_HEADER.unpack(head)[:3]
+        end = pos + BLOCK_HEADER.size + length
+        raws = None
+        if magic == BLOCK_MAGIC and count and end <= len(blob):
+            raws = decode_block(head, blob[pos + BLOCK_HEADER.size:end])
+        if raws is None:
+            print(f"{name}: skipped damaged block at offset {pos}", file=sys.stderr)
+            nxt = blob.find(magic_bytes, pos + 1)
+            pos = nxt if nxt >= 0 else len(blob)
+            continue
+        yield from raws
+        pos = end
+
+
+def encode_archive(raws):
+    """Compress records into a sequence of archive blocks."""
+    return b"".join(encode_block(raws[i:i + BLOCK_RECORDS])
+                    for i in range(0, len(raws), BLOCK_RECORDS))
+
+
+def to_json(rec, device, chip_id):
+    """Build the same JSON object the firmware publishes."""
+    out = {"device": device}
+    if chip_id is not None:
+        out["msg_id"] = "%08X-%04u-%05u" % (chip_id, rec["boot"], rec["reading"])
+    out["timestamp"] = format_timestamp(rec["epoch"], rec["flags"] & FLAG_TIME)
+    out["reading"] = rec["reading"]
+
+    sensors = {}
+    if rec["flags"] & FLAG_SCD30:
+        sensors["co2"] = round(rec["co2"], 1)
+        sensors["temperature"] = round(rec["temperature"], 2)
+        sensors["humidity"] = round(rec["humidity"], 1)
+    if rec["flags"] & FLAG_BH1750:
+        sensors["light"] = round(rec["light"], 1)
+    if rec["flags"] & FLAG_SOIL:
+        sensors["soil_moisture"] = round(rec["soil_moisture"], 1)
+        sensors["soil_raw"] = rec["soil_raw"]
+    out["sensors"] = sensors
+    out["valid"] = {
+        "scd30": bool(rec["flags"] & FLAG_SCD30),
+        "bh1750": bool(rec["flags"] & FLAG_BH1750),
+        "soil": bool(rec["flags"] & FLAG_SOIL),
+    }
+    return out
+
+
+def from_json(obj):
+    """Convert a published JSON reading to the decoded field dict."""
+    ts = datetime.fromisoformat(obj["timestamp"])
+    boot, reading = 0, obj.get("reading", 0)
+    if "msg_id" in obj:
+        _, boot, reading = obj["msg_id"].split("-")
+    valid = obj.get("valid", {})
+    sensors = obj.get("sensors", {})
+    flags = 0
+    flags |= FLAG_SCD30 if valid.get("scd30") else 0
+    flags |= FLAG_BH1750 if valid.get("bh1750") else 0
+    flags |= FLAG_SOIL if valid.get("soil") else 0
+    flags |= FLAG_TIME if ts.year > 1970 else 0
+    return {
+        "flags": flags,
+        "boot": int(boot),
+        "epoch": max(0, int(ts.timestamp())),
+        "reading": int(reading),
+        "co2": sensors.get("co2", 0.0),
+        "temperature": sensors.get("temperature", 0.0),
+        "humidity": sensors.get("humidity", 0.0),
+        "light": sensors.get("light", 0.0),
+        "soil_moisture": sensors.get("soil_moisture", 0.0),
+        "soil_raw": sensors.get("soil_raw", 0),
+    }
+
+
+def day_files(directory, start, end):
+    """Day files (.arc, then parts .1.arc, .2.arc, ...) covering local
+    dates start..end that exist."""
+    day = local_time(start).date()
+    last = local_time(end).date()
+    while day <= last:
+        path = os.path.join(directory, day.isoformat() + ".arc")
+        part = 0
+        while os.path.exists(path):
+            yield path
+            part += 1
+            path = os.path.join(directory, f"{day.isoformat()}.{part}.arc")
+        day += timedelta(days=1)
+
+
+def query_day(path, start, end, stats):
+    """Readings in range from one day file, using its .idx like the
+    firmware: read the index, seek to overlapping blocks, then hop
+    over blocks written after the last index entry."""
+    out = []
+    with open(path, "rb") as f:
+        size = os.fstat(f.fileno()).st_size
+
+        def block_at(offset):
+            f.seek(offset)
+            head = f.read(BLOCK_HEADER.size)
+            stats["bytes"] += len(head)
+            if len(head) < BLOCK_HEADER.size:
+                return None, None
+            magic, count, length, first, last, _ = BLOCK_HEADER.unpack(head)
+            if magic != BLOCK_MAGIC or not count or offset + BLOCK_HEADER.size + length > size:
+                return None, None
+            return head, (first, last, offset + BLOCK_HEADER.size + length)
+
+        def read_block(head, info):
+            data = f.read(info[2] - f.tell())
+            stats["bytes"] += len(data)
+            for raw in decode_block(head, data) or []:
+                rec = decode(raw)
+                if rec["flags"] & FLAG_TIME and start <= rec["epoch"] <= end:
+                    out.append(raw)
+
+        nxt, last_offset = 0, None
+        idx_path = path[:-4] + ".idx"
+        if os.path.exists(idx_path):
+            with open(idx_path, "rb") as idx:
+                index = idx.read()
+            stats["bytes"] += len(index)
+            for pos in range(0, len(index) - INDEX_ENTRY.size + 1, INDEX_ENTRY.size):
+                first, last, offset, crc = INDEX_ENTRY.unpack_from(index, pos)
+                if zlib.crc32(index[pos:pos + 12]) != crc:
+                    break
+                if last_offset is not None and offset <= last_offset:
+                    break
+                last_offset = offset
+                if last < start or first > end:
+                    continue
+                head, info = block_at(offset)
+                if head and info[0] == first:
+                    read_block(head, info)
+                    nxt = info[2]
+            if last_offset is not None and last_offset >= nxt:
+                head, info = block_at(last_offset)
+                if head:
+                    nxt = info[2]
+
+        while True:
+            head, info = block_at(nxt)
+            if not head:
+                break
+            if info[1] >= start and info[0] <= end:
+                read_block(head, info)
+            else:
+                f.seek(info[2])
+            nxt = info[2]
+    return out
+
+
+def load_readings(path):
+    """Valid 32-byte records from a .rec/.arc file or a JSONL archive."""
+    if path.endswith(".jsonl"):
+        raws = []
+        with open(path) as src:
+            for line in src:
+                line = line.strip()
+                if not line:
+                    continue
+                try:
+                    raws.append(encode(from_json(json.loads(line))))
+                except (ValueError, KeyError):
+                    pass
+        return raws
+    return [raw for raw in read_records(path) if decode(raw) is not None]
+
+
+def cmd_decode(args):
+    chip_id = int(args.chip_id, 16) if args.chip_id else None
+    bad = 0
+    for raw in read_records(args.input):
+        rec = decode(raw)
+        if rec is None:
+            bad += 1
+            continue
+        print(json.dumps(to_json(rec, args.device, chip_id)))
+    if bad:
+        print(f"Skipped {bad} corrupted records", file=sys.stderr)
+
+
+def cmd_convert(args):
+    raws = load_readings(args.input)
+    with open(args.output, "wb") as dst:
+        dst.write(encode_archive(raws) if args.output.endswith(".arc") else b"".join(raws))
+    print(f"Converted {len(raws)} readings", file=sys.stderr)
+
+
+def cmd_bench(args):
+    """Compare JSONL, raw record and compressed archive sizes, and time
+    compression and decompression of the archive format."""
+    totals = [0, 0, 0, 0]
+    print(f"{'file':<24} {'readings':>8} {'jsonl':>10} {'raw':>10} {'arc':>10} {'vs raw':>7} {'vs jsonl':>8}")
+    encode_s = decode_s = 0.0
+    for path in args.inputs:
+        raws = load_readings(path)
+        if not raws:
+            continue
+        jsonl = sum(len(json.dumps(to_json(decode(raw), args.device, 0), separators=(",", ":"))) + 1
+                    for raw in raws)
+
+        start = time.perf_counter()
+        arc = encode_archive(raws)
+        encode_s += time.perf_counter() - start
+        start = time.perf_counter()
+        back = list(split_records(arc, path))
+        decode_s += time.perf_counter() - start
+        if back != raws:
+            print(f"{path}: round trip mismatch", file=sys.stderr)
+            sys.exit(1)
+
+        row = [len(raws), jsonl, len(raws) * RECORD.size, len(arc)]
+        totals = [a + b for a, b in zip(totals, row)]
+        name = path.rsplit("/", 1)[-1]
+        print(f"{name:<24} {row[0]:>8} {row[1]:>10} {row[2]:>10} {row[3]:>10} "
+              f"{row[2] / row[3]:>6.1f}x {row[1] / row[3]:>7.1f}x")
+
+    if totals[0] == 0:
+        print("No readings found", file=sys.stderr)
+        return
+    print(f"{'total':<24} {totals[0]:>8} {totals[1]:>10} {totals[2]:>10} {totals[3]:>10} "
+          f"{totals[2] / totals[3]:>6.1f}x {totals[1] / totals[3]:>7.1f}x")
+    print(f"{totals[3] / totals[0]:.2f} bytes/reading; "
+          f"encode {totals[0] / encode_s:.0f} readings/s, decode {totals[0] / decode_s:.0f} readings/s (host Python)")
+
+
+def cmd_query(args):
+    start, end = parse_time(args.start), parse_time(args.end)
+    chip_id = int(args.chip_id, 16) if args.chip_id else None
+    files = list(day_files(args.dir, start, end))
+
+    stats = {"bytes": 0}
+    t0 = time.perf_counter()
+    raws = [raw for path in files for raw in query_day(path, start, end, stats)]
+    indexed_s = time.perf_counter() - t0
+
+    if not args.bench:
+        for raw in raws:
+            print(json.dumps(to_json(decode(raw), args.device, chip_id)))
+        return
+
+    # Baseline: decode every block of every day file in the range
+    t0 = time.perf_counter()
+    linear, linear_bytes = [], 0
+    for path in files:
+        linear_bytes += os.path.getsize(path)
+        linear += [raw for raw in read_records(path)
+                   if decode(raw) and decode(raw)["flags"] & FLAG_TIME and start <= decode(raw)["epoch"] <= end]
+    linear_s = time.perf_counter() - t0
+    if linear != raws:
+        print("Indexed and linear results differ", file=sys.stderr)
+        sys.exit(1)
+    print(f"{len(raws)} readings in {len(files)} day files")
+    print(f"indexed: {stats['bytes']:>10} bytes read {indexed_s * 1000:>9.2f} ms")
+    print(f"linear:  {linear_bytes:>10} bytes read {linear_s * 1000:>9.2f} ms")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="SD card reading record tool")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("decode", help=".rec/.arc file -> JSONL on stdout")
+    p.add_argument("input")
+    p.add_argument("--device", default=DEVICE_ID)
+    p.add_argument("--chip-id", help="low 32 bits of the ESP32 MAC (hex), adds msg_id")
+    p.set_defaults(func=cmd_decode)
+
+    p = sub.add_parser("convert", help="JSONL/.rec/.arc -> .arc (compressed) or .rec (raw)")
+    p.add_argument("input")
+    p.add_argument("output")
+    p.set_defaults(func=cmd_convert)
+
+    p = sub.add_parser("bench", help="compression ratio of the archive format")
+    p.add_argument("inputs", nargs="+")
+    p.add_argument("--device", default=DEVICE_ID)
+    p.set_defaults(func=cmd_bench)
+
+    p = sub.add_parser("query", help="archived readings in a time range -> JSONL on stdout")
+    p.add_argument("dir", help="archive directory (copy of /data/archive)")
+    p.add_argument("start", help="Unix time or ISO 8601 (local time if no offset)")
+    p.add_argument("end")
+    p.add_argument("--device", default=DEVICE_ID)
+    p.add_argument("--chip-id", help="low 32 bits of the ESP32 MAC (hex), adds msg_id")
+    p.add_argument("--bench", action="store_true", help="compare with a linear scan instead of printing")
+    p.set_defaults(func=cmd_query)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()